@@ -24,6 +24,105 @@ static const osMutexAttr_t display_mutex_attributes = {
   .name = "display_mutex",
 };
 
+#define DISPLAY_UPDATE_PERIOD_MS 20
+
+#define SCREENSHOT_WIDTH 256
+#define SCREENSHOT_HEIGHT 64
+#define SCREENSHOT_BUFFER_SIZE ((SCREENSHOT_WIDTH * SCREENSHOT_HEIGHT) / 8)
+#define SCREENSHOT_SLOT_COUNT 3
+
+/* Frame buffer snapshots waiting to be written by the screenshot task */
+static uint8_t screenshot_buffers[SCREENSHOT_SLOT_COUNT][SCREENSHOT_BUFFER_SIZE];
+
+/* Queue of snapshot buffers available for capture */
+static osMessageQueueId_t screenshot_free_queue = nullptr;
+static const osMessageQueueAttr_t screenshot_free_queue_attrs = {
+    .name = "screenshot_free_queue"
+};
+
+/* Queue of snapshot buffers waiting to be written */
+static osMessageQueueId_t screenshot_pending_queue = nullptr;
+static const osMessageQueueAttr_t screenshot_pending_queue_attrs = {
+    .name = "screenshot_pending_queue"
+};
+
+/* Next screenshot file index, or 0 if it needs to be found */
+static uint16_t screenshot_next_index = 0;
+
+/*
+ * Copy of the tone graph area as of the last time it was drawn,
+ * used to find out if it can be incrementally updated.
+ */
+static uint8_t tone_graph_strip[256];
+static uint32_t tone_graph_last = UINT32_MAX;
+static uint32_t tone_graph_last_overlay = 0;
+
+typedef enum : uint8_t {
+    DISPLAY_UPDATE_TONE_GRAPH = 0,
+    DISPLAY_UPDATE_EXPOSURE_TIMER,
+    DISPLAY_UPDATE_ADJUSTMENT_TIMER,
+    DISPLAY_UPDATE_TEST_STRIP_TIMER,
+    DISPLAY_UPDATE_MAX
+} display_update_type_t;
+
+typedef struct {
+    uint32_t tone_graph;
+    uint32_t overlay_marks;
+} display_tone_graph_model_t;
+
+typedef struct {
+    bool pending;
+    uint32_t sequence;
+    uint32_t update_generation;
+    union {
+        display_tone_graph_model_t tone_graph;
+        display_exposure_timer_t timer;
+    };
+} display_update_slot_t;
+
+/* Full screen that each partial update can be drawn on top of */
+static const display_screen_t display_update_base_screens[DISPLAY_UPDATE_MAX] = {
+    DISPLAY_SCREEN_MAIN_PRINTING,
+    DISPLAY_SCREEN_EXPOSURE_TIMER,
+    DISPLAY_SCREEN_ADJUSTMENT_EXPOSURE,
+    DISPLAY_SCREEN_TEST_STRIP
+};
+
+/* Newest pending model for each type of partial update */
+static display_update_slot_t display_update_slots[DISPLAY_UPDATE_MAX] = {0};
+
+/*
+ * Counter for each type of partial update that changes whenever that part
+ * of the screen is drawn directly. Pending updates posted before then are
+ * older than what is already showing, and are dropped.
+ */
+static volatile uint32_t display_update_generation[DISPLAY_UPDATE_MAX] = {0};
+static display_update_stats_t display_update_stats = {0};
+
+static osMutexId_t display_update_mutex;
+static const osMutexAttr_t display_update_mutex_attributes = {
+  .name = "display_update_mutex",
+};
+
+static osSemaphoreId_t display_update_semaphore = nullptr;
+static const osSemaphoreAttr_t display_update_semaphore_attributes = {
+    .name = "display_update_semaphore"
+};
+
+/*
+ * Sequence number given to each posted partial update, and the most
+ * recent full screen drawn along with the sequence number at the time
+ * it started rendering. Pending partial updates are only rendered on
+ * top of their own base screen, and only if they were posted after
+ * the full screen started rendering.
+ */
+static volatile uint32_t display_post_sequence = 0;
+static display_screen_t display_base_screen = DISPLAY_SCREEN_MAX;
+static uint32_t display_base_sequence = 0;
+
+/* Last time value drawn on the exposure timer screen */
+static display_exposure_timer_t display_last_exposure_timer = {0};
+
 static uint8_t display_contrast = 0x9F;
 static uint8_t display_brightness = 0x0F;
 
@@ -31,8 +130,26 @@ static constexpr u8g2_uint_t COUNTER_TIME_X = 217;
 static constexpr u8g2_uint_t COUNTER_TIME_Y = 8;
 
 static void display_set_freq(uint8_t value);
+static void screenshot_task_loop();
+static void screenshot_encode_pbm_row(uint8_t *row_buf, const uint8_t *frame_buf, uint16_t y);
+static uint16_t screenshot_find_next_index();
+static void screenshot_write_file(const uint8_t *frame_buf);
+static void display_redraw_tone_graph_impl(uint32_t tone_graph, uint32_t overlay_marks);
+static void display_draw_exposure_timer_impl(const display_exposure_timer_t *elements, const display_exposure_timer_t *prev_elements);
+static void display_redraw_adjustment_exposure_timer_impl(const display_exposure_timer_t *time_elements);
+static void display_redraw_test_strip_timer_impl(const display_exposure_timer_t *elements);
+static void display_task_loop();
+static void display_post_update(display_update_type_t update_type, const void *model, size_t model_size);
+static void display_cancel_update(display_update_type_t update_type);
+static void display_set_base_screen(display_screen_t screen, uint32_t post_sequence);
+static uint32_t display_render_begin();
+static void display_render_end(display_screen_t screen, uint32_t post_sequence);
 
 static void display_draw_tone_graph(uint32_t tone_graph, uint32_t overlay_marks);
+static void display_draw_tone_graph_element(uint8_t index, bool value, bool overlay);
+static void display_tone_graph_element_bounds(uint8_t index, u8g2_uint_t *x, u8g2_uint_t *w);
+static void display_tone_graph_capture(uint32_t tone_graph, uint32_t overlay_marks);
+static bool display_tone_graph_strip_matches();
 static void display_draw_tone_graph_placeholder();
 static void display_draw_split_tone_graph(uint32_t base_tone_graph, uint32_t adj_tone_graph, uint32_t overlay_marks);
 static void display_draw_paper_profile_num(uint8_t num);
@@ -68,6 +185,11 @@ HAL_StatusTypeDef display_init(const u8g2_display_handle_t *display_handle)
         log_e("xSemaphoreCreateMutex error");
     }
 
+    display_update_mutex = osMutexNew(&display_update_mutex_attributes);
+    if (!display_update_mutex) {
+        log_e("xSemaphoreCreateMutex error");
+    }
+
     return HAL_OK;
 }
 
@@ -85,6 +207,7 @@ void display_clear()
     osMutexAcquire(display_mutex, portMAX_DELAY);
 
     u8g2_ClearBuffer(&u8g2);
+    display_set_base_screen(DISPLAY_SCREEN_MAX, display_render_begin());
 
     osMutexRelease(display_mutex);
 }
@@ -135,75 +258,350 @@ uint8_t display_get_brightness()
     return display_brightness;
 }
 
-static FIL *screenshot_fp = NULL;
-static void display_save_screenshot_callback(const char *s)
+void task_display_run(void *argument)
+{
+    osSemaphoreId_t task_start_semaphore = argument;
+
+    /* Create the semaphore used to wake the task when updates are posted */
+    display_update_semaphore = osSemaphoreNew(1, 0, &display_update_semaphore_attributes);
+    if (!display_update_semaphore) {
+        return;
+    }
+
+    /* Release the startup semaphore */
+    if (osSemaphoreRelease(task_start_semaphore) != osOK) {
+        log_e("Unable to release task_start_semaphore");
+        return;
+    }
+
+    /* Start the main task loop */
+    display_task_loop();
+}
+
+[[noreturn]] void display_task_loop()
 {
-    if (screenshot_fp) {
-        FRESULT res = f_puts(s, screenshot_fp);
-        if (res < 0) {
-            log_e("Error writing screenshot data to file: %d", res);
-            screenshot_fp = NULL;
+    display_update_slot_t slots[DISPLAY_UPDATE_MAX];
+    uint32_t frame_ticks = osKernelGetTickCount();
+
+    for (;;) {
+        if (osSemaphoreAcquire(display_update_semaphore, portMAX_DELAY) != osOK) {
+            continue;
+        }
+
+        /* Cap the frame rate, letting newer updates replace pending ones */
+        osDelayUntil(frame_ticks + DISPLAY_UPDATE_PERIOD_MS);
+
+        /* Take everything that is pending */
+        osMutexAcquire(display_update_mutex, portMAX_DELAY);
+        memcpy(slots, display_update_slots, sizeof(slots));
+        for (uint8_t i = 0; i < DISPLAY_UPDATE_MAX; i++) {
+            display_update_slots[i].pending = false;
         }
+        osMutexRelease(display_update_mutex);
+
+        osMutexAcquire(display_mutex, portMAX_DELAY);
+        uint32_t rendered = 0;
+        uint32_t dropped = 0;
+        for (uint8_t i = 0; i < DISPLAY_UPDATE_MAX; i++) {
+            if (!slots[i].pending) { continue; }
+
+            /* Skip updates made stale by a full screen or direct redraw */
+            if ((int32_t)(slots[i].sequence - display_base_sequence) <= 0
+                || slots[i].update_generation != display_update_generation[i]
+                || display_base_screen != display_update_base_screens[i]) {
+                dropped++;
+                continue;
+            }
+
+            switch (i) {
+            case DISPLAY_UPDATE_TONE_GRAPH:
+                display_redraw_tone_graph_impl(slots[i].tone_graph.tone_graph, slots[i].tone_graph.overlay_marks);
+                break;
+            case DISPLAY_UPDATE_EXPOSURE_TIMER:
+                display_draw_exposure_timer_impl(&slots[i].timer, &display_last_exposure_timer);
+                break;
+            case DISPLAY_UPDATE_ADJUSTMENT_TIMER:
+                display_redraw_adjustment_exposure_timer_impl(&slots[i].timer);
+                break;
+            case DISPLAY_UPDATE_TEST_STRIP_TIMER:
+                display_redraw_test_strip_timer_impl(&slots[i].timer);
+                break;
+            default:
+                break;
+            }
+            rendered++;
+        }
+        osMutexRelease(display_mutex);
+
+        osMutexAcquire(display_update_mutex, portMAX_DELAY);
+        display_update_stats.rendered += rendered;
+        display_update_stats.dropped += dropped;
+        osMutexRelease(display_update_mutex);
+
+        frame_ticks = osKernelGetTickCount();
     }
 }
 
+void display_post_update(display_update_type_t update_type, const void *model, size_t model_size)
+{
+    display_update_slot_t *slot = &display_update_slots[update_type];
+
+    osMutexAcquire(display_update_mutex, portMAX_DELAY);
+
+    display_update_stats.submitted++;
+    if (slot->pending) {
+        /* The newer model replaces the one that was never rendered */
+        display_update_stats.dropped++;
+    }
+
+    memcpy(&slot->tone_graph, model, model_size);
+    slot->sequence = ++display_post_sequence;
+    slot->update_generation = display_update_generation[update_type];
+    slot->pending = true;
+
+    osMutexRelease(display_update_mutex);
+
+    osSemaphoreRelease(display_update_semaphore);
+}
+
+void display_cancel_update(display_update_type_t update_type)
+{
+    /* Must be called with display_mutex held, ahead of the direct redraw */
+    osMutexAcquire(display_update_mutex, portMAX_DELAY);
+    display_update_generation[update_type]++;
+    display_update_slots[update_type].pending = false;
+    osMutexRelease(display_update_mutex);
+}
+
+void display_post_tone_graph(uint32_t tone_graph, uint32_t overlay_marks)
+{
+    const display_tone_graph_model_t model = {
+        .tone_graph = tone_graph,
+        .overlay_marks = overlay_marks
+    };
+    display_post_update(DISPLAY_UPDATE_TONE_GRAPH, &model, sizeof(model));
+}
+
+void display_post_exposure_timer(const display_exposure_timer_t *elements)
+{
+    display_post_update(DISPLAY_UPDATE_EXPOSURE_TIMER, elements, sizeof(display_exposure_timer_t));
+}
+
+void display_post_adjustment_exposure_timer(const display_exposure_timer_t *time_elements)
+{
+    display_post_update(DISPLAY_UPDATE_ADJUSTMENT_TIMER, time_elements, sizeof(display_exposure_timer_t));
+}
+
+void display_post_test_strip_timer(const display_exposure_timer_t *elements)
+{
+    display_post_update(DISPLAY_UPDATE_TEST_STRIP_TIMER, elements, sizeof(display_exposure_timer_t));
+}
+
+void display_get_update_stats(display_update_stats_t *stats)
+{
+    if (!stats) { return; }
+
+    osMutexAcquire(display_update_mutex, portMAX_DELAY);
+    memcpy(stats, &display_update_stats, sizeof(display_update_stats_t));
+    osMutexRelease(display_update_mutex);
+}
+
 void display_save_screenshot()
 {
+    uint8_t slot;
+
+    if (!screenshot_pending_queue) {
+        log_w("Screenshot task not running");
+        return;
+    }
+
+    /* Grab a free buffer, dropping the capture if all are in use */
+    if (osMessageQueueGet(screenshot_free_queue, &slot, NULL, 0) != osOK) {
+        log_w("Screenshot dropped, no free buffers");
+        return;
+    }
+
+    /* Snapshot the current frame buffer */
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    memcpy(screenshot_buffers[slot], u8g2_GetBufferPtr(&u8g2), SCREENSHOT_BUFFER_SIZE);
+    osMutexRelease(display_mutex);
+
+    /* Hand the snapshot off to the writer task */
+    if (osMessageQueuePut(screenshot_pending_queue, &slot, 0, 0) != osOK) {
+        log_w("Unable to queue screenshot");
+        osMessageQueuePut(screenshot_free_queue, &slot, 0, 0);
+    }
+}
+
+void task_screenshot_run(void *argument)
+{
+    osSemaphoreId_t task_start_semaphore = argument;
+
+    /* Create the queues used to pass buffers to and from the writer */
+    screenshot_free_queue = osMessageQueueNew(SCREENSHOT_SLOT_COUNT, sizeof(uint8_t), &screenshot_free_queue_attrs);
+    if (!screenshot_free_queue) {
+        return;
+    }
+
+    screenshot_pending_queue = osMessageQueueNew(SCREENSHOT_SLOT_COUNT, sizeof(uint8_t), &screenshot_pending_queue_attrs);
+    if (!screenshot_pending_queue) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < SCREENSHOT_SLOT_COUNT; i++) {
+        osMessageQueuePut(screenshot_free_queue, &i, 0, 0);
+    }
+
+    /* Release the startup semaphore */
+    if (osSemaphoreRelease(task_start_semaphore) != osOK) {
+        log_e("Unable to release task_start_semaphore");
+        return;
+    }
 
+    /* Start the main task loop */
+    screenshot_task_loop();
+}
+
+[[noreturn]] void screenshot_task_loop()
+{
+    uint8_t slot;
+
+    for (;;) {
+        if (osMessageQueueGet(screenshot_pending_queue, &slot, NULL, portMAX_DELAY) == osOK) {
+            /* Write the snapshot, then return its buffer to the pool */
+            screenshot_write_file(screenshot_buffers[slot]);
+            osMessageQueuePut(screenshot_free_queue, &slot, 0, 0);
+        }
+    }
+}
+
+void screenshot_encode_pbm_row(uint8_t *row_buf, const uint8_t *frame_buf, uint16_t y)
+{
+    /*
+     * The frame buffer is arranged as rows of 8-pixel tall tiles,
+     * with each byte holding a vertical column of pixels. PBM wants
+     * horizontal rows of pixels, packed with the leftmost pixel
+     * in the most significant bit.
+     */
+    const uint8_t *src_row = frame_buf + ((y / 8) * SCREENSHOT_WIDTH);
+    const uint8_t src_mask = 1 << (y & 0x07);
+
+    memset(row_buf, 0, SCREENSHOT_WIDTH / 8);
+    for (uint16_t x = 0; x < SCREENSHOT_WIDTH; x++) {
+        if (src_row[x] & src_mask) {
+            row_buf[x / 8] |= 0x80 >> (x & 0x07);
+        }
+    }
+}
+
+uint16_t screenshot_find_next_index()
+{
     FRESULT res;
-    FIL fp;
     DIR dir;
     FILINFO fno;
-    bool file_open = false;
-    char filename[32];
     uint16_t highest_index = 0;
 
-    do {
-        res = f_opendir(&dir, "/");
-        if (res != FR_OK) {
-            log_e("Error opening screenshot directory: %d", res);
-            break;
-        }
+    res = f_opendir(&dir, "/");
+    if (res != FR_OK) {
+        log_e("Error opening screenshot directory: %d", res);
+        return 0;
+    }
 
-        /* Find the next image file index */
-        for (;;) {
-            res = f_readdir(&dir, &fno);
-            if (fno.fname[0] == 0) { break; }
-            if (!(fno.fattrib & AM_DIR)) {
-                /* Ignore any filename that isn't the expected length */
-                if (strlen(fno.fname) != 12) { continue; }
+    for (;;) {
+        res = f_readdir(&dir, &fno);
+        if (res != FR_OK || fno.fname[0] == 0) { break; }
+        if (!(fno.fattrib & AM_DIR)) {
+            /* Ignore any filename that isn't the expected length */
+            if (strlen(fno.fname) != 12) { continue; }
 
-                /* Ignore any filename without the expected prefix */
-                if (strncmp(fno.fname, "img-", 4) != 0) { continue; }
+            /* Ignore any filename without the expected prefix */
+            if (strncmp(fno.fname, "img-", 4) != 0) { continue; }
 
-                /* Ignore any filename without the expected suffix */
-                if (strncmp(fno.fname + 8, ".xbm", 4) != 0) { continue; }
+            /* Ignore any filename without a known suffix */
+            if (strncmp(fno.fname + 8, ".pbm", 4) != 0
+                && strncmp(fno.fname + 8, ".xbm", 4) != 0) { continue; }
 
-                int num = strtol(fno.fname + 4, NULL, 10);
-                if (num > highest_index) {
-                    highest_index = num;
-                }
+            int num = strtol(fno.fname + 4, NULL, 10);
+            if (num > highest_index) {
+                highest_index = num;
+            }
+        }
+    }
+    f_closedir(&dir);
+
+    if (res != FR_OK) {
+        return 0;
+    }
+    return highest_index + 1;
+}
+
+void screenshot_write_file(const uint8_t *frame_buf)
+{
+    FRESULT res;
+    FIL fp;
+    UINT bytes_written;
+    bool file_open = false;
+    char filename[32];
+    char header[16];
+    uint8_t row_buf[SCREENSHOT_WIDTH / 8];
+
+    do {
+        /*
+         * Only scan the directory if the next index isn't known,
+         * which is the case for the first capture or if the cached
+         * index turned out to be stale.
+         */
+        if (screenshot_next_index == 0) {
+            screenshot_next_index = screenshot_find_next_index();
+            if (screenshot_next_index == 0) {
+                break;
             }
         }
-        f_closedir(&dir);
-        if (res != FR_OK || highest_index >= 9998) {
+        if (screenshot_next_index > 9999) {
+            log_w("No more screenshot filenames available");
             break;
         }
 
         memset(&fp, 0, sizeof(FIL));
-        sprintf(filename, "img-%04d.xbm", (highest_index + 1));
+        sprintf(filename, "img-%04d.pbm", screenshot_next_index);
 
-        res = f_open(&fp, filename, FA_WRITE | FA_CREATE_ALWAYS);
+        res = f_open(&fp, filename, FA_WRITE | FA_CREATE_NEW);
+        if (res == FR_EXIST) {
+            /* Media was likely changed, so rescan and try again */
+            screenshot_next_index = screenshot_find_next_index();
+            if (screenshot_next_index == 0 || screenshot_next_index > 9999) {
+                break;
+            }
+            sprintf(filename, "img-%04d.pbm", screenshot_next_index);
+            res = f_open(&fp, filename, FA_WRITE | FA_CREATE_NEW);
+        }
         if (res != FR_OK) {
             log_e("Error opening screenshot file: %d", res);
+            screenshot_next_index = 0;
             break;
         }
         file_open = true;
+        screenshot_next_index++;
 
-        screenshot_fp = &fp;
-        u8g2_WriteBufferXBM(&u8g2, display_save_screenshot_callback);
-        screenshot_fp = NULL;
+        int header_len = sprintf(header, "P4\n%d %d\n", SCREENSHOT_WIDTH, SCREENSHOT_HEIGHT);
+        res = f_write(&fp, header, header_len, &bytes_written);
+        if (res != FR_OK || bytes_written != header_len) {
+            log_e("Error writing screenshot header: %d", res);
+            break;
+        }
+
+        /* Rows are small, so these writes just fill the file's sector buffer */
+        for (uint16_t y = 0; y < SCREENSHOT_HEIGHT; y++) {
+            screenshot_encode_pbm_row(row_buf, frame_buf, y);
+            res = f_write(&fp, row_buf, sizeof(row_buf), &bytes_written);
+            if (res != FR_OK || bytes_written != sizeof(row_buf)) {
+                break;
+            }
+        }
+        if (res != FR_OK || bytes_written != sizeof(row_buf)) {
+            log_e("Error writing screenshot data: %d", res);
+            break;
+        }
 
         log_d("Screenshot written to file: %s", filename);
     } while (0);
@@ -211,13 +609,34 @@ void display_save_screenshot()
     if (file_open) {
         f_close(&fp);
     }
+}
 
-    osMutexRelease(display_mutex);
+uint32_t display_render_begin()
+{
+    /* Updates posted after this point are newer than the screen being rendered */
+    return display_post_sequence;
+}
+
+void display_render_end(display_screen_t screen, uint32_t post_sequence)
+{
+    if (screen != DISPLAY_SCREEN_TONE_GRAPH
+        && screen != DISPLAY_SCREEN_EXPOSURE_TIMER_UPDATE
+        && screen != DISPLAY_SCREEN_ADJUSTMENT_TIMER
+        && screen != DISPLAY_SCREEN_TEST_STRIP_TIMER) {
+        display_set_base_screen(screen, post_sequence);
+    }
+}
+
+void display_set_base_screen(display_screen_t screen, uint32_t post_sequence)
+{
+    display_base_screen = screen;
+    display_base_sequence = post_sequence;
 }
 
 void display_draw_test_pattern(bool mode)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_ClearBuffer(&u8g2);
     u8g2_SetDrawColor(&u8g2, 1);
@@ -235,12 +654,15 @@ void display_draw_test_pattern(bool mode)
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_TEST_PATTERN, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_logo()
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_ClearBuffer(&u8g2);
     u8g2_SetBitmapMode(&u8g2, 1);
@@ -249,29 +671,117 @@ void display_draw_logo()
     u8g2_DrawXBM(&u8g2, 0, 0, asset.width, asset.height, asset.bits);
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_LOGO, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_redraw_tone_graph(uint32_t tone_graph, uint32_t overlay_marks)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    display_cancel_update(DISPLAY_UPDATE_TONE_GRAPH);
+    display_redraw_tone_graph_impl(tone_graph, overlay_marks);
+    osMutexRelease(display_mutex);
+}
 
-    /* Clear the tone graph area */
-    u8g2_SetDrawColor(&u8g2, 0);
-    u8g2_DrawBox(&u8g2, 0, 0, u8g2_GetDisplayWidth(&u8g2), 5);
-    u8g2_SetDrawColor(&u8g2, 1);
+void display_redraw_tone_graph_impl(uint32_t tone_graph, uint32_t overlay_marks)
+{
+    uint32_t post_sequence = display_render_begin();
 
-    /* Redraw the tone graph */
-    if (tone_graph == UINT32_MAX) {
-        display_draw_tone_graph_placeholder();
+    if (tone_graph != UINT32_MAX && tone_graph_last != UINT32_MAX
+        && display_tone_graph_strip_matches()) {
+        /*
+         * The tone graph area still contains exactly what was last drawn
+         * into it, so only the elements that have changed since then
+         * need to be redrawn and sent to the display.
+         */
+        const uint32_t changed = ((tone_graph ^ tone_graph_last)
+            | (overlay_marks ^ tone_graph_last_overlay)) & 0x0001FFFFUL;
+
+        if (changed) {
+            u8g2_uint_t min_x = u8g2_GetDisplayWidth(&u8g2);
+            u8g2_uint_t max_x = 0;
+
+            for (uint8_t i = 0; i < 17; i++) {
+                const uint32_t mask = 1UL << i;
+                if (!(changed & mask)) { continue; }
+
+                u8g2_uint_t x;
+                u8g2_uint_t w;
+                display_tone_graph_element_bounds(i, &x, &w);
+
+                u8g2_SetDrawColor(&u8g2, 0);
+                u8g2_DrawBox(&u8g2, x, 0, w, 5);
+                u8g2_SetDrawColor(&u8g2, 1);
+                display_draw_tone_graph_element(i, tone_graph & mask, overlay_marks & mask);
+
+                if (x < min_x) { min_x = x; }
+                if (x + w - 1 > max_x) { max_x = x + w - 1; }
+            }
+
+            display_tone_graph_capture(tone_graph, overlay_marks);
+
+            /* Update just the tiles covering the changed elements */
+            u8g2_UpdateDisplayArea(&u8g2, min_x / 8, 0, (max_x / 8) - (min_x / 8) + 1, 1);
+        }
     } else {
-        display_draw_tone_graph(tone_graph, overlay_marks);
+        /* Clear the tone graph area */
+        u8g2_SetDrawColor(&u8g2, 0);
+        u8g2_DrawBox(&u8g2, 0, 0, u8g2_GetDisplayWidth(&u8g2), 5);
+        u8g2_SetDrawColor(&u8g2, 1);
+
+        /* Redraw the tone graph */
+        if (tone_graph == UINT32_MAX) {
+            display_draw_tone_graph_placeholder();
+        } else {
+            display_draw_tone_graph(tone_graph, overlay_marks);
+        }
+
+        /* Update just the modified display area */
+        u8g2_UpdateDisplayArea(&u8g2, 0, 0, u8g2_GetDisplayWidth(&u8g2) / 8, 1);
     }
 
-    /* Update just the modified display area */
-    u8g2_UpdateDisplayArea(&u8g2, 0, 0, u8g2_GetDisplayWidth(&u8g2) / 8, 1);
+    display_render_end(DISPLAY_SCREEN_TONE_GRAPH, post_sequence);
+}
 
-    osMutexRelease(display_mutex);
+void display_tone_graph_capture(uint32_t tone_graph, uint32_t overlay_marks)
+{
+    /*
+     * The tone graph occupies the top 5 pixel rows of the first tile row,
+     * so a masked copy of that tile row is enough to later check whether
+     * anything else has since been drawn over it.
+     */
+    const uint8_t *buf = u8g2_GetBufferPtr(&u8g2);
+    for (size_t i = 0; i < sizeof(tone_graph_strip); i++) {
+        tone_graph_strip[i] = buf[i] & 0x1F;
+    }
+    tone_graph_last = tone_graph;
+    tone_graph_last_overlay = overlay_marks;
+}
+
+bool display_tone_graph_strip_matches()
+{
+    const uint8_t *buf = u8g2_GetBufferPtr(&u8g2);
+    for (size_t i = 0; i < sizeof(tone_graph_strip); i++) {
+        if ((buf[i] & 0x1F) != tone_graph_strip[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void display_tone_graph_element_bounds(uint8_t index, u8g2_uint_t *x, u8g2_uint_t *w)
+{
+    if (index == 0) {
+        *x = 0;
+        *w = 7;
+    } else if (index == 16) {
+        *x = 249;
+        *w = 7;
+    } else {
+        *x = 9 + (16 * (index - 1));
+        *w = 14;
+    }
 }
 
 void display_draw_tone_graph(uint32_t tone_graph, uint32_t overlay_marks)
@@ -287,30 +797,59 @@ void display_draw_tone_graph(uint32_t tone_graph, uint32_t overlay_marks)
      *  It is rendered in the opposite direction, with the under tones
      *  on the left side of the display.
      */
+    for (uint8_t i = 0; i < 17; i++) {
+        const uint32_t mask = 1UL << i;
+        display_draw_tone_graph_element(i, tone_graph & mask, overlay_marks & mask);
+    }
 
-    if (tone_graph & 0x00000001UL) {
-        if (overlay_marks & 0x00000001UL) {
-            u8g2_DrawLine(&u8g2, 2, 0, 6, 0);
-            u8g2_DrawLine(&u8g2, 1, 1, 2, 1);
-            u8g2_DrawLine(&u8g2, 0, 2, 1, 2);
-            u8g2_DrawLine(&u8g2, 1, 3, 2, 3);
-            u8g2_DrawLine(&u8g2, 2, 4, 6, 4);
-            u8g2_DrawLine(&u8g2, 6, 1, 6, 3);
-        } else {
-            u8g2_DrawPixel(&u8g2, 0, 2);
-            u8g2_DrawLine(&u8g2, 1, 1, 1, 3);
-            u8g2_DrawBox(&u8g2, 2, 0, 5, 5);
+    display_tone_graph_capture(tone_graph, overlay_marks);
+}
+
+void display_draw_tone_graph_element(uint8_t index, bool value, bool overlay)
+{
+    if (index == 0) {
+        if (value) {
+            if (overlay) {
+                u8g2_DrawLine(&u8g2, 2, 0, 6, 0);
+                u8g2_DrawLine(&u8g2, 1, 1, 2, 1);
+                u8g2_DrawLine(&u8g2, 0, 2, 1, 2);
+                u8g2_DrawLine(&u8g2, 1, 3, 2, 3);
+                u8g2_DrawLine(&u8g2, 2, 4, 6, 4);
+                u8g2_DrawLine(&u8g2, 6, 1, 6, 3);
+            } else {
+                u8g2_DrawPixel(&u8g2, 0, 2);
+                u8g2_DrawLine(&u8g2, 1, 1, 1, 3);
+                u8g2_DrawBox(&u8g2, 2, 0, 5, 5);
+            }
+        } else if (overlay) {
+            u8g2_DrawPixel(&u8g2, 2, 2);
+            u8g2_DrawBox(&u8g2, 3, 1, 3, 3);
         }
-    } else if (overlay_marks & 0x00000001UL) {
-        u8g2_DrawPixel(&u8g2, 2, 2);
-        u8g2_DrawBox(&u8g2, 3, 1, 3, 3);
-    }
+    } else if (index == 16) {
+        if (value) {
+            if (overlay) {
+                u8g2_DrawLine(&u8g2, 249, 0, 253, 0);
 
-    uint32_t mask = 0x00000002UL;
-    uint16_t x_offset = 9;
-    do {
-        if (tone_graph & mask) {
-            if (overlay_marks & mask) {
+                u8g2_DrawLine(&u8g2, 253, 1, 254, 1);
+                u8g2_DrawLine(&u8g2, 254, 2, 255, 2);
+                u8g2_DrawLine(&u8g2, 253, 3, 254, 3);
+
+                u8g2_DrawLine(&u8g2, 249, 4, 253, 4);
+                u8g2_DrawLine(&u8g2, 249, 1, 249, 3);
+
+            } else {
+                u8g2_DrawBox(&u8g2, 249, 0, 5, 5);
+                u8g2_DrawLine(&u8g2, 254, 1, 254, 3);
+                u8g2_DrawPixel(&u8g2, 255, 2);
+            }
+        } else if (overlay) {
+            u8g2_DrawPixel(&u8g2, 253, 2);
+            u8g2_DrawBox(&u8g2, 250, 1, 3, 3);
+        }
+    } else if (index < 16) {
+        const u8g2_uint_t x_offset = 9 + (16 * (index - 1));
+        if (value) {
+            if (overlay) {
                 u8g2_DrawFrame(&u8g2, x_offset, 0, 14, 5);
                 u8g2_DrawLine(&u8g2, x_offset + 1, 1, x_offset + 1, 3);
                 u8g2_DrawLine(&u8g2, x_offset + 2, 1, x_offset + 2, 3);
@@ -323,34 +862,11 @@ void display_draw_tone_graph(uint32_t tone_graph, uint32_t overlay_marks)
             } else {
                 u8g2_DrawBox(&u8g2, x_offset, 0, 14, 5);
             }
-        } else if (overlay_marks & mask) {
+        } else if (overlay) {
             u8g2_DrawLine(&u8g2, x_offset + 4, 1, x_offset + 9, 1);
             u8g2_DrawLine(&u8g2, x_offset + 3, 2, x_offset + 10, 2);
             u8g2_DrawLine(&u8g2, x_offset + 4, 3, x_offset + 9, 3);
         }
-        x_offset += 16;
-        mask = mask << 1UL;
-    } while (mask != 0x00010000UL);
-
-    if (tone_graph & 0x00010000UL) {
-        if (overlay_marks & 0x00010000UL) {
-            u8g2_DrawLine(&u8g2, 249, 0, 253, 0);
-
-            u8g2_DrawLine(&u8g2, 253, 1, 254, 1);
-            u8g2_DrawLine(&u8g2, 254, 2, 255, 2);
-            u8g2_DrawLine(&u8g2, 253, 3, 254, 3);
-
-            u8g2_DrawLine(&u8g2, 249, 4, 253, 4);
-            u8g2_DrawLine(&u8g2, 249, 1, 249, 3);
-
-        } else {
-            u8g2_DrawBox(&u8g2, 249, 0, 5, 5);
-            u8g2_DrawLine(&u8g2, 254, 1, 254, 3);
-            u8g2_DrawPixel(&u8g2, 255, 2);
-        }
-    } else if (overlay_marks & 0x00010000UL) {
-        u8g2_DrawPixel(&u8g2, 253, 2);
-        u8g2_DrawBox(&u8g2, 250, 1, 3, 3);
     }
 }
 
@@ -377,6 +893,8 @@ void display_draw_tone_graph_placeholder()
     u8g2_DrawPixel(&u8g2, 254, 3);
     u8g2_DrawLine(&u8g2, 249, 4, 253, 4);
     u8g2_DrawLine(&u8g2, 249, 1, 249, 3);
+
+    display_tone_graph_capture(UINT32_MAX, 0);
 }
 
 void display_draw_split_tone_graph(uint32_t base_tone_graph, uint32_t adj_tone_graph, uint32_t overlay_marks)
@@ -987,6 +1505,7 @@ void display_draw_counter_placeholder(u8g2_uint_t x, u8g2_uint_t y, display_digi
 void display_draw_main_elements_printing(const display_main_printing_elements_t *elements)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1013,6 +1532,8 @@ void display_draw_main_elements_printing(const display_main_printing_elements_t
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_MAIN_PRINTING, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
@@ -1020,6 +1541,7 @@ void display_draw_main_elements_densitometer(const display_main_densitometer_ele
 {
     asset_info_t asset;
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1065,12 +1587,15 @@ void display_draw_main_elements_densitometer(const display_main_densitometer_ele
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_MAIN_DENSITOMETER, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_main_elements_calibration(const display_main_calibration_elements_t *elements)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1101,12 +1626,15 @@ void display_draw_main_elements_calibration(const display_main_calibration_eleme
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_MAIN_CALIBRATION, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_stop_increment(uint8_t increment_den)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1135,12 +1663,15 @@ void display_draw_stop_increment(uint8_t increment_den)
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_STOP_INCREMENT, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_mode_text(const char *text)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1157,12 +1688,15 @@ void display_draw_mode_text(const char *text)
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_MODE_TEXT, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_exposure_adj(int value, uint32_t tone_graph)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1198,12 +1732,15 @@ void display_draw_exposure_adj(int value, uint32_t tone_graph)
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_EXPOSURE_ADJ, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_timer_adj(const display_exposure_timer_t *elements, uint32_t tone_graph)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1220,12 +1757,15 @@ void display_draw_timer_adj(const display_exposure_timer_t *elements, uint32_t t
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_TIMER_ADJ, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_pev_adj(int32_t value)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1266,10 +1806,19 @@ void display_draw_pev_adj(int32_t value)
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_PEV_ADJ, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_draw_exposure_timer(const display_exposure_timer_t *elements, const display_exposure_timer_t *prev_elements)
+{
+    osMutexAcquire(display_mutex, portMAX_DELAY);
+    display_draw_exposure_timer_impl(elements, prev_elements);
+    osMutexRelease(display_mutex);
+}
+
+void display_draw_exposure_timer_impl(const display_exposure_timer_t *elements, const display_exposure_timer_t *prev_elements)
 {
     bool clean_display = true;
     bool time_changed = true;
@@ -1285,7 +1834,7 @@ void display_draw_exposure_timer(const display_exposure_timer_t *elements, const
         }
     }
 
-    osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     if (clean_display) {
         u8g2_SetDrawColor(&u8g2, 0);
@@ -1319,12 +1868,15 @@ void display_draw_exposure_timer(const display_exposure_timer_t *elements, const
         }
     }
 
-    osMutexRelease(display_mutex);
+    memcpy(&display_last_exposure_timer, elements, sizeof(display_exposure_timer_t));
+
+    display_render_end(clean_display ? DISPLAY_SCREEN_EXPOSURE_TIMER : DISPLAY_SCREEN_EXPOSURE_TIMER_UPDATE, post_sequence);
 }
 
 void display_draw_adjustment_exposure_elements(const display_adjustment_exposure_elements_t *elements)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1407,12 +1959,21 @@ void display_draw_adjustment_exposure_elements(const display_adjustment_exposure
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_ADJUSTMENT_EXPOSURE, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_redraw_adjustment_exposure_timer(const display_exposure_timer_t *time_elements)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    display_redraw_adjustment_exposure_timer_impl(time_elements);
+    osMutexRelease(display_mutex);
+}
+
+void display_redraw_adjustment_exposure_timer_impl(const display_exposure_timer_t *time_elements)
+{
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_DrawBox(&u8g2, 96, 8,
@@ -1424,7 +1985,7 @@ void display_redraw_adjustment_exposure_timer(const display_exposure_timer_t *ti
 
     u8g2_UpdateDisplayArea(&u8g2, 12, 1, 20, 7);
 
-    osMutexRelease(display_mutex);
+    display_render_end(DISPLAY_SCREEN_ADJUSTMENT_TIMER, post_sequence);
 }
 
 void display_draw_test_strip_elements(const display_test_strip_elements_t *elements)
@@ -1432,6 +1993,7 @@ void display_draw_test_strip_elements(const display_test_strip_elements_t *eleme
     asset_info_t asset;
 
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1597,12 +2159,21 @@ void display_draw_test_strip_elements(const display_test_strip_elements_t *eleme
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_TEST_STRIP, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
 void display_redraw_test_strip_timer(const display_exposure_timer_t *elements)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    display_redraw_test_strip_timer_impl(elements);
+    osMutexRelease(display_mutex);
+}
+
+void display_redraw_test_strip_timer_impl(const display_exposure_timer_t *elements)
+{
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_DrawBox(&u8g2, 192, 8,
@@ -1616,12 +2187,13 @@ void display_redraw_test_strip_timer(const display_exposure_timer_t *elements)
 
     u8g2_UpdateDisplayArea(&u8g2, 24, 4, 8, 4);
 
-    osMutexRelease(display_mutex);
+    display_render_end(DISPLAY_SCREEN_TEST_STRIP_TIMER, post_sequence);
 }
 
 void display_draw_edit_adjustment_elements(const display_edit_adjustment_elements_t *elements)
 {
     osMutexAcquire(display_mutex, portMAX_DELAY);
+    uint32_t post_sequence = display_render_begin();
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
@@ -1726,6 +2298,8 @@ void display_draw_edit_adjustment_elements(const display_edit_adjustment_element
 
     u8g2_SendBuffer(&u8g2);
 
+    display_render_end(DISPLAY_SCREEN_EDIT_ADJUSTMENT, post_sequence);
+
     osMutexRelease(display_mutex);
 }
 
@@ -2266,6 +2840,9 @@ uint8_t u8x8_GetMenuEvent(u8x8_t *u8x8)
 
 void display_prepare_menu_font()
 {
+    /* Menus always redraw the whole screen, so they invalidate partial updates */
+    display_set_base_screen(DISPLAY_SCREEN_MAX, display_render_begin());
+
     u8g2_SetFont(&u8g2, u8g2_font_pressstart2p_8f);
     u8g2_SetFontMode(&u8g2, 0);
     u8g2_SetDrawColor(&u8g2, 1);
@@ -122,6 +122,34 @@ typedef struct {
     bool time_too_short;
 } display_adjustment_exposure_elements_t;
 
+typedef enum : uint8_t {
+    DISPLAY_SCREEN_TEST_PATTERN = 0,
+    DISPLAY_SCREEN_LOGO,
+    DISPLAY_SCREEN_TONE_GRAPH,
+    DISPLAY_SCREEN_MAIN_PRINTING,
+    DISPLAY_SCREEN_MAIN_DENSITOMETER,
+    DISPLAY_SCREEN_MAIN_CALIBRATION,
+    DISPLAY_SCREEN_STOP_INCREMENT,
+    DISPLAY_SCREEN_MODE_TEXT,
+    DISPLAY_SCREEN_EXPOSURE_ADJ,
+    DISPLAY_SCREEN_TIMER_ADJ,
+    DISPLAY_SCREEN_PEV_ADJ,
+    DISPLAY_SCREEN_EXPOSURE_TIMER,
+    DISPLAY_SCREEN_EXPOSURE_TIMER_UPDATE,
+    DISPLAY_SCREEN_ADJUSTMENT_EXPOSURE,
+    DISPLAY_SCREEN_ADJUSTMENT_TIMER,
+    DISPLAY_SCREEN_TEST_STRIP,
+    DISPLAY_SCREEN_TEST_STRIP_TIMER,
+    DISPLAY_SCREEN_EDIT_ADJUSTMENT,
+    DISPLAY_SCREEN_MAX
+} display_screen_t;
+
+typedef struct {
+    uint32_t submitted; /*!< Number of partial updates posted */
+    uint32_t rendered;  /*!< Number of partial updates drawn */
+    uint32_t dropped;   /*!< Number of updates replaced or made stale before drawing */
+} display_update_stats_t;
+
 typedef void (*display_input_value_callback_t)(uint8_t value, void *user_data);
 typedef uint8_t (*display_input_poll_callback_t)(uint8_t current_pos, uint8_t event_action, void *user_data);
 typedef uint16_t (*display_data_source_callback_t)(uint8_t event_action, void *user_data);
@@ -135,8 +163,39 @@ uint8_t display_get_contrast();
 void display_set_brightness(uint8_t value);
 uint8_t display_get_brightness();
 
+/**
+ * Capture the current display contents to a file on the USB stick.
+ *
+ * The frame buffer is copied into RAM and handed off to the
+ * screenshot task, so this function returns quickly. The image is
+ * written as a binary PBM file named "img-NNNN.pbm", using the next
+ * available index. If all capture buffers are in use, the capture
+ * is dropped.
+ */
 void display_save_screenshot();
 
+/**
+ * Start the screenshot writer task.
+ *
+ * @param argument The osSemaphoreId_t used to synchronize task startup.
+ */
+void task_screenshot_run(void *argument);
+
+/**
+ * Start the display update task.
+ *
+ * This task draws partial screen updates posted through the
+ * display_post_* functions, at a capped frame rate.
+ *
+ * @param argument The osSemaphoreId_t used to synchronize task startup.
+ */
+void task_display_run(void *argument);
+
+/**
+ * Get counters for the partial updates handled by the display task.
+ */
+void display_get_update_stats(display_update_stats_t *stats);
+
 void display_draw_test_pattern(bool mode);
 void display_draw_logo();
 
@@ -151,13 +210,34 @@ void display_draw_timer_adj(const display_exposure_timer_t *elements, uint32_t t
 void display_draw_pev_adj(int32_t value);
 void display_draw_exposure_timer(const display_exposure_timer_t *elements, const display_exposure_timer_t *prev_elements);
 
+/**
+ * Post an exposure timer update to the display task.
+ *
+ * This is the non-blocking equivalent of display_draw_exposure_timer()
+ * for an exposure timer screen that is already visible.
+ */
+void display_post_exposure_timer(const display_exposure_timer_t *elements);
+
 /**
  * Redraw the tone graph portion of the display.
  *
+ * Any tone graph update still pending from display_post_tone_graph()
+ * is discarded, so it cannot later overwrite what is drawn here.
+ *
  * Note: This will not clear any existing display contents.
  */
 void display_redraw_tone_graph(uint32_t tone_graph, uint32_t overlay_marks);
 
+/**
+ * Post a tone graph update to the display task.
+ *
+ * This is the non-blocking equivalent of display_redraw_tone_graph(),
+ * for use when updates may arrive faster than the display can be
+ * refreshed. Only the newest pending update is drawn, and it is
+ * discarded if a different screen has been drawn in the meantime.
+ */
+void display_post_tone_graph(uint32_t tone_graph, uint32_t overlay_marks);
+
 /**
  * Draw the complete set of burn/dodge display elements.
  */
@@ -168,6 +248,11 @@ void display_draw_adjustment_exposure_elements(const display_adjustment_exposure
  */
 void display_redraw_adjustment_exposure_timer(const display_exposure_timer_t *time_elements);
 
+/**
+ * Post a burn/dodge timer update to the display task.
+ */
+void display_post_adjustment_exposure_timer(const display_exposure_timer_t *time_elements);
+
 /**
  * Draw the complete set of test strip display elements.
  */
@@ -180,6 +265,11 @@ void display_draw_test_strip_elements(const display_test_strip_elements_t *eleme
  */
 void display_redraw_test_strip_timer(const display_exposure_timer_t *elements);
 
+/**
+ * Post a test strip timer update to the display task.
+ */
+void display_post_test_strip_timer(const display_exposure_timer_t *elements);
+
 void display_draw_edit_adjustment_elements(const display_edit_adjustment_elements_t *elements);
 
 uint8_t display_selection_list(const char *title, uint8_t start_pos, const char *list);
@@ -19,17 +19,42 @@
 #define MY_SPACE_BETWEEN_BUTTONS_IN_PIXEL 6
 #define MY_SPACE_BETWEEN_TEXT_AND_BUTTONS_IN_PIXEL 3
 
+/* Lists can have no more lines than can be indexed by the u8sl_t type */
+#define LIST_LAYOUT_MAX_LINES UINT8_MAX
+#define LIST_LAYOUT_WIDTH_UNKNOWN UINT16_MAX
+
 extern osMutexId_t display_mutex;
 
+/*
+ * Cached layout of the most recently drawn list, so that finding and
+ * measuring its lines does not require rescanning the string on every
+ * redraw. Line widths are measured lazily, the first time each line
+ * is drawn.
+ */
+typedef struct {
+    const char *list;
+    const uint8_t *font;
+    size_t length;
+    uint32_t hash;
+    uint8_t total;
+    uint16_t line_offsets[LIST_LAYOUT_MAX_LINES];
+    u8g2_uint_t line_widths[LIST_LAYOUT_MAX_LINES];
+} display_list_layout_t;
+
+static display_list_layout_t list_layout = {0};
+
 bool menu_event_timeout = false;
 
 /* Library function declarations */
-void u8g2_DrawSelectionList(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, const char *s);
 uint8_t u8g2_draw_button_line(u8g2_t *u8g2, u8g2_uint_t y, u8g2_uint_t w, uint8_t cursor, const char *s);
 
 static void display_DrawSelectionList(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, const char *s, u8g2_uint_t list_width);
 static u8g2_uint_t display_draw_selection_list_line(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, uint8_t idx, const char *s, u8g2_uint_t list_width);
+static void display_redraw_selection_list_lines(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, const char *s, uint8_t prev_pos);
 static void display_draw_selection_list_arrows(u8g2_t *u8g2, const u8sl_t *u8sl);
+static void display_list_layout_update(u8g2_t *u8g2, const char *s);
+static const char *display_list_layout_line(u8g2_t *u8g2, const char *s, uint8_t idx, u8g2_uint_t *width);
+static void display_draw_list_line(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, const char *s, u8g2_uint_t str_width, uint8_t border_size, uint8_t is_invert);
 
 uint16_t display_GetMenuEvent(u8x8_t *u8x8, display_menu_params_t params)
 {
@@ -194,7 +219,9 @@ void display_UserInterfaceStaticListDraw(u8g2_t *u8g2, const char *title, const
         u8sl.visible = display_lines;
     }
 
-    u8sl.total = u8x8_GetStringLineCnt(list);
+    display_list_layout_update(u8g2, list);
+
+    u8sl.total = list_layout.total;
     u8sl.first_pos = 0;
     u8sl.current_pos = -1;
 
@@ -221,35 +248,181 @@ void display_DrawSelectionList(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, const
 
 u8g2_uint_t display_draw_selection_list_line(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, uint8_t idx, const char *s, u8g2_uint_t list_width)
 {
-    u8g2_uint_t yy;
     uint8_t border_size = 0;
     uint8_t is_invert = 0;
+    u8g2_uint_t str_width;
 
     u8g2_uint_t line_height = u8g2_GetAscent(u8g2) - u8g2_GetDescent(u8g2)+MY_BORDER_SIZE;
 
-    /* calculate offset from display upper border */
-    yy = idx;
-    yy -= u8sl->first_pos;
-    yy *= line_height;
-    yy += y;
-
     /* check whether this is the current cursor line */
     if (idx == u8sl->current_pos) {
         border_size = MY_BORDER_SIZE;
         is_invert = 1;
     }
 
-    /* get the line from the array */
-    s = u8x8_GetStringLineStart(idx, s);
+    /* get the line, and its width, from the cached layout */
+    s = display_list_layout_line(u8g2, s, idx, &str_width);
 
     /* draw the line */
-    if (s == NULL) {
-        s = "";
-    }
-    u8g2_DrawUTF8Line(u8g2, MY_BORDER_SIZE, y, list_width-2*MY_BORDER_SIZE, s, border_size, is_invert);
+    display_draw_list_line(u8g2, MY_BORDER_SIZE, y, list_width-2*MY_BORDER_SIZE, s, str_width, border_size, is_invert);
     return line_height;
 }
 
+void display_redraw_selection_list_lines(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, const char *s, uint8_t prev_pos)
+{
+    /*
+     * Redraw only the lines for the previous and current cursor positions,
+     * for the case where the cursor has moved without scrolling the list.
+     * Each line is cleared to include its selection frame, which sits
+     * one pixel outside the text box.
+     */
+    const uint8_t lines[2] = { prev_pos, u8sl->current_pos };
+    const u8g2_uint_t display_width = u8g2_GetDisplayWidth(u8g2);
+    const u8g2_uint_t line_height = u8g2_GetAscent(u8g2) - u8g2_GetDescent(u8g2) + MY_BORDER_SIZE;
+    u8g2_uint_t top_min = u8g2_GetDisplayHeight(u8g2);
+    u8g2_uint_t bottom_max = 0;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if (i == 1 && lines[1] == lines[0]) { break; }
+        if (lines[i] < u8sl->first_pos || lines[i] >= u8sl->first_pos + u8sl->visible) { continue; }
+
+        u8g2_uint_t yy = y + ((lines[i] - u8sl->first_pos) * line_height);
+        u8g2_uint_t top = yy - u8g2_GetAscent(u8g2) - MY_BORDER_SIZE;
+        u8g2_uint_t bottom = yy - u8g2_GetDescent(u8g2);
+
+        u8g2_SetDrawColor(u8g2, 0);
+        u8g2_DrawBox(u8g2, 0, top, display_width, bottom - top + 1);
+        u8g2_SetDrawColor(u8g2, 1);
+
+        display_draw_selection_list_line(u8g2, u8sl, yy, lines[i], s, display_width);
+
+        if (top < top_min) { top_min = top; }
+        if (bottom > bottom_max) { bottom_max = bottom; }
+    }
+
+    if (bottom_max < top_min) { return; }
+
+    /* The arrows may sit inside a cleared line, so always restore them */
+    display_draw_selection_list_arrows(u8g2, u8sl);
+
+    u8g2_UpdateDisplayArea(u8g2, 0, top_min / 8, display_width / 8, (bottom_max / 8) - (top_min / 8) + 1);
+}
+
+void display_list_layout_update(u8g2_t *u8g2, const char *s)
+{
+    /* Hash the content, since callers often reuse the same buffer */
+    uint32_t hash = 2166136261UL;
+    size_t length = 0;
+    for (const char *p = s; *p != '\0'; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619UL;
+        length++;
+    }
+
+    if (list_layout.list == s && list_layout.font == u8g2->font
+        && list_layout.length == length && list_layout.hash == hash) {
+        return;
+    }
+
+    list_layout.list = s;
+    list_layout.font = u8g2->font;
+    list_layout.length = length;
+    list_layout.hash = hash;
+
+    list_layout.line_offsets[0] = 0;
+    list_layout.line_widths[0] = LIST_LAYOUT_WIDTH_UNKNOWN;
+    list_layout.total = 1;
+    for (size_t i = 0; i < length && i < UINT16_MAX; i++) {
+        if (s[i] == '\n') {
+            if (list_layout.total >= LIST_LAYOUT_MAX_LINES) { break; }
+            list_layout.line_offsets[list_layout.total] = i + 1;
+            list_layout.line_widths[list_layout.total] = LIST_LAYOUT_WIDTH_UNKNOWN;
+            list_layout.total++;
+        }
+    }
+}
+
+const char *display_list_layout_line(u8g2_t *u8g2, const char *s, uint8_t idx, u8g2_uint_t *width)
+{
+    if (s != list_layout.list || idx >= list_layout.total) {
+        *width = 0;
+        return "";
+    }
+
+    const char *line = s + list_layout.line_offsets[idx];
+
+    if (list_layout.line_widths[idx] == LIST_LAYOUT_WIDTH_UNKNOWN) {
+        u8g2_uint_t str_width = u8g2_GetUTF8Width(u8g2, line);
+#ifdef U8G2_BALANCED_STR_WIDTH_CALCULATION
+        /* subtract the first character offset added by the width calculation */
+        str_width -= u8g2_GetXOffsetUTF8(u8g2, line);
+#endif
+        list_layout.line_widths[idx] = str_width;
+    }
+
+    *width = list_layout.line_widths[idx];
+    return line;
+}
+
+void display_draw_list_line(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, const char *s, u8g2_uint_t str_width, uint8_t border_size, uint8_t is_invert)
+{
+    // Based off u8g2_DrawUTF8Line() with changes to take a
+    // precalculated string width.
+
+    u8g2_uint_t d;
+    u8g2_uint_t fx, fy, fw, fh;
+
+    /* only horizontal strings are supported, so force this here */
+    u8g2_SetFontDirection(u8g2, 0);
+
+    /* revert y position back to baseline ref */
+    y += u8g2->font_calc_vref(u8g2);
+
+    /* calculate delta d within the box */
+    d = 0;
+    if (str_width < w) {
+        d = w;
+        d -= str_width;
+        d /= 2;
+    } else {
+        w = str_width;
+    }
+
+    /* calculate text box */
+    fx = x;
+    fy = y - u8g2_GetAscent(u8g2);
+    fw = w;
+    fh = u8g2_GetAscent(u8g2) - u8g2_GetDescent(u8g2);
+
+    /* draw the box, if inverted */
+    u8g2_SetDrawColor(u8g2, 1);
+    if (is_invert) {
+        u8g2_DrawBox(u8g2, fx, fy, fw, fh);
+    }
+
+    /* draw the frame */
+    while (border_size > 0) {
+        fx--;
+        fy--;
+        fw += 2;
+        fh += 2;
+        u8g2_DrawFrame(u8g2, fx, fy, fw, fh);
+        border_size--;
+    }
+
+    if (is_invert) {
+        u8g2_SetDrawColor(u8g2, 0);
+    } else {
+        u8g2_SetDrawColor(u8g2, 1);
+    }
+
+    /* draw the text */
+    u8g2_DrawUTF8(u8g2, x + d, y, s);
+
+    /* revert draw color */
+    u8g2_SetDrawColor(u8g2, 1);
+}
+
 /* v = value, d = number of digits */
 const char *display_u16toa(uint16_t v, uint8_t d)
 {
@@ -827,7 +1000,9 @@ uint8_t display_UserInterfaceSelectionList(u8g2_t *u8g2, const char *title, uint
         u8sl.visible = display_lines;
     }
 
-    u8sl.total = u8x8_GetStringLineCnt(sl);
+    display_list_layout_update(u8g2, sl);
+
+    u8sl.total = list_layout.total;
     u8sl.first_pos = 0;
     u8sl.current_pos = start_pos;
 
@@ -840,17 +1015,28 @@ uint8_t display_UserInterfaceSelectionList(u8g2_t *u8g2, const char *title, uint
 
     u8g2_SetFontPosBaseline(u8g2);
 
+    bool full_redraw = true;
+    uint8_t prev_pos = u8sl.current_pos;
+    uint8_t prev_first_pos;
+
     for (;;) {
-        u8g2_ClearBuffer(u8g2);
-        yy = u8g2_GetAscent(u8g2);
-        if (title_lines > 0) {
-            yy += u8g2_DrawUTF8Lines(u8g2, 0, yy, u8g2_GetDisplayWidth(u8g2), line_height, title);
-            u8g2_DrawHLine(u8g2, 0, yy - line_height - u8g2_GetDescent(u8g2) + 1, u8g2_GetDisplayWidth(u8g2));
-            yy += 3;
+        if (full_redraw) {
+            u8g2_ClearBuffer(u8g2);
+            yy = u8g2_GetAscent(u8g2);
+            if (title_lines > 0) {
+                yy += u8g2_DrawUTF8Lines(u8g2, 0, yy, u8g2_GetDisplayWidth(u8g2), line_height, title);
+                u8g2_DrawHLine(u8g2, 0, yy - line_height - u8g2_GetDescent(u8g2) + 1, u8g2_GetDisplayWidth(u8g2));
+                yy += 3;
+            }
+            display_DrawSelectionList(u8g2, &u8sl, yy, sl, u8g2_GetDisplayWidth(u8g2));
+            display_draw_selection_list_arrows(u8g2, &u8sl);
+            u8g2_SendBuffer(u8g2);
+        } else {
+            display_redraw_selection_list_lines(u8g2, &u8sl, yy, sl, prev_pos);
         }
-        u8g2_DrawSelectionList(u8g2, &u8sl, yy, sl);
-        display_draw_selection_list_arrows(u8g2, &u8sl);
-        u8g2_SendBuffer(u8g2);
+
+        prev_pos = u8sl.current_pos;
+        prev_first_pos = u8sl.first_pos;
 
         for (;;) {
             event = u8x8_GetMenuEvent(u8g2_GetU8x8(u8g2));
@@ -866,6 +1052,9 @@ uint8_t display_UserInterfaceSelectionList(u8g2_t *u8g2, const char *title, uint
                 break;
             }
         }
+
+        /* Only a scroll requires the whole list to be redrawn */
+        full_redraw = (u8sl.first_pos != prev_first_pos);
     }
 }
 
@@ -899,7 +1088,9 @@ uint16_t display_UserInterfaceSelectionListCB(u8g2_t *u8g2, const char *title, u
         u8sl.visible = display_lines;
     }
 
-    u8sl.total = u8x8_GetStringLineCnt(sl);
+    display_list_layout_update(u8g2, sl);
+
+    u8sl.total = list_layout.total;
     u8sl.first_pos = 0;
     u8sl.current_pos = start_pos;
 
@@ -912,17 +1103,28 @@ uint16_t display_UserInterfaceSelectionListCB(u8g2_t *u8g2, const char *title, u
 
     u8g2_SetFontPosBaseline(u8g2);
 
+    bool full_redraw = true;
+    uint8_t prev_pos = u8sl.current_pos;
+    uint8_t prev_first_pos;
+
     for(;;) {
-        u8g2_ClearBuffer(u8g2);
-        yy = u8g2_GetAscent(u8g2);
-        if (title_lines > 0) {
-            yy += u8g2_DrawUTF8Lines(u8g2, 0, yy, u8g2_GetDisplayWidth(u8g2), line_height, title);
-            u8g2_DrawHLine(u8g2, 0, yy - line_height - u8g2_GetDescent(u8g2) + 1, u8g2_GetDisplayWidth(u8g2));
-            yy += 3;
+        if (full_redraw) {
+            u8g2_ClearBuffer(u8g2);
+            yy = u8g2_GetAscent(u8g2);
+            if (title_lines > 0) {
+                yy += u8g2_DrawUTF8Lines(u8g2, 0, yy, u8g2_GetDisplayWidth(u8g2), line_height, title);
+                u8g2_DrawHLine(u8g2, 0, yy - line_height - u8g2_GetDescent(u8g2) + 1, u8g2_GetDisplayWidth(u8g2));
+                yy += 3;
+            }
+            display_DrawSelectionList(u8g2, &u8sl, yy, sl, u8g2_GetDisplayWidth(u8g2));
+            display_draw_selection_list_arrows(u8g2, &u8sl);
+            u8g2_SendBuffer(u8g2);
+        } else {
+            display_redraw_selection_list_lines(u8g2, &u8sl, yy, sl, prev_pos);
         }
-        u8g2_DrawSelectionList(u8g2, &u8sl, yy, sl);
-        display_draw_selection_list_arrows(u8g2, &u8sl);
-        u8g2_SendBuffer(u8g2);
+
+        prev_pos = u8sl.current_pos;
+        prev_first_pos = u8sl.first_pos;
 
         for(;;) {
             uint8_t event_action;
@@ -961,6 +1163,9 @@ uint16_t display_UserInterfaceSelectionListCB(u8g2_t *u8g2, const char *title, u
                 break;
             }
         }
+
+        /* Only a scroll requires the whole list to be redrawn */
+        full_redraw = (u8sl.first_pos != prev_first_pos);
     }
 }
 
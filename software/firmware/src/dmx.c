@@ -9,15 +9,92 @@
 #include <elog.h>
 
 #include "board_config.h"
+#include "util.h"
 
 /**
  * Sending a complete DMX512 frame takes about 22ms,
  * so this number should be set to round up from there to
  * whatever frame period is desired. This is otherwise known
  * as the "BREAK to BREAK Time" in the standard.
+ *
+ * Shorter frames are sent with a proportionally shorter period,
+ * and this is the period used for a full-length frame.
  */
 #define DMX_FRAME_PERIOD_MS 25
 
+/**
+ * Shortest period used for short frames. The standard requires at
+ * least 1204us from BREAK to BREAK, which rounds up to this many ticks.
+ */
+#define DMX_FRAME_PERIOD_MIN_MS 2
+
+/**
+ * Number of slots sent beyond the highest slot that has been set,
+ * for the benefit of fixtures that expect their full footprint
+ * to be present in every frame.
+ */
+#define DMX_FRAME_SLOT_MARGIN 8
+
+/**
+ * Time spent on the BREAK and Mark-After-Break, plus the minimum
+ * idle time between frames, in addition to the 44us per slot.
+ */
+#define DMX_FRAME_OVERHEAD_US 400
+#define DMX_SLOT_TIME_US 44
+
+/**
+ * Size of a complete frame buffer, including the start code.
+ */
+#define DMX_FRAME_SIZE 513
+
+/**
+ * How long a blocking frame update will wait for the frame
+ * containing it to be sent before giving up.
+ */
+#define DMX_FRAME_WAIT_MS (DMX_FRAME_PERIOD_MS * 4)
+
+/**
+ * Longest expected time from publishing a frame update to the start
+ * of its data on the wire, which is one frame period plus the
+ * BREAK and Mark-After-Break.
+ */
+#define DMX_FRAME_LATENCY_LIMIT_US(period_ms) (((period_ms) * 1000U) + 200U)
+
+/**
+ * Frame buffers are exchanged between the frame setters and the frame
+ * sender through a single shared byte. The low bits hold the index
+ * of the buffer that is ready to send, and the fresh flag is set when
+ * that buffer has been published and not yet picked up.
+ */
+#define DMX_BUFFER_INDEX_MASK 0x03U
+#define DMX_BUFFER_FRESH      0x04U
+
+/**
+ * Limits for channel fades. Fade requests are passed to the frame
+ * sender through a small queue, and each channel being faded occupies
+ * one of a fixed set of ramp records.
+ */
+#define DMX_RAMP_MAX_CHANNELS 8
+#define DMX_RAMP_QUEUE_SIZE   4
+
+/**
+ * Timing for collecting RDM responses. Responders must start answering
+ * within 2ms of the end of a request, and may pause for up to 2.1ms
+ * between slots, so these are set to allow for tick granularity.
+ * The overall limit covers a BREAK plus a full-length response packet.
+ */
+#define DMX_RDM_RESPONSE_WAIT_MS 4
+#define DMX_RDM_RESPONSE_IDLE_MS 3
+#define DMX_RDM_RESPONSE_MAX_MS  15
+
+/**
+ * Baud rate used to generate the BREAK and Mark-After-Break from the
+ * UART itself. A zero byte sent at this rate holds the line low for
+ * its start bit and 8 data bits (~112us), and its 2 stop bits then
+ * form the Mark-After-Break (~25us).
+ */
+#define DMX_UART_BREAK_BAUD 80000
+
 /**
  * Because the DMX controller depends so tightly on the interaction
  * of specific peripherals, and switching them between alternate
@@ -32,7 +109,8 @@ typedef enum {
     DMX_FRAME_MARK_BEFORE_BREAK,
     DMX_FRAME_BREAK,
     DMX_FRAME_MARK_AFTER_BREAK,
-    DMX_FRAME_DATA
+    DMX_FRAME_DATA,
+    DMX_FRAME_RDM_RESPONSE
 } dmx_frame_state_t;
 
 typedef enum {
@@ -41,14 +119,42 @@ typedef enum {
     DMX_CONTROL_START,
     DMX_CONTROL_STOP,
     DMX_CONTROL_PAUSE,
-    DMX_CONTROL_SET_FRAME
+    DMX_CONTROL_RDM
 } dmx_control_event_type_t;
 
+typedef struct {
+    const uint8_t *request;
+    size_t request_len;
+    uint8_t *response;
+    size_t response_size;
+    size_t *response_len;
+} dmx_rdm_transaction_t;
+
 typedef struct {
     dmx_control_event_type_t event_type;
+    const dmx_rdm_transaction_t *rdm;
     osStatus_t *result;
 } dmx_control_event_t;
 
+typedef struct {
+    uint8_t count;         /*!< Number of channels, or 0 to cancel all fades */
+    bool wide_mode;        /*!< True if the channels are 16-bit */
+    dmx_ramp_curve_t curve;
+    uint16_t duration_ms;  /*!< Fade duration, or 0 to cancel fades on these channels */
+    uint16_t slots[DMX_RAMP_MAX_CHANNELS];
+    uint16_t targets[DMX_RAMP_MAX_CHANNELS];
+} dmx_ramp_command_t;
+
+typedef struct {
+    uint16_t slot;         /*!< Frame buffer position, or 0 if unused */
+    bool wide_mode;
+    dmx_ramp_curve_t curve;
+    uint16_t start;
+    uint16_t target;
+    uint16_t duration_ms;
+    uint32_t start_ticks;
+} dmx_ramp_t;
+
 /* Queue for DMX task control events */
 static osMessageQueueId_t dmx_control_queue = NULL;
 static const osMessageQueueAttr_t dmx_control_queue_attrs = {
@@ -67,28 +173,141 @@ static const osSemaphoreAttr_t dmx_frame_semaphore_attrs = {
     .name = "dmx_frame_semaphore"
 };
 
-/* Mutex to protect DMX frame updates */
-static osMutexId_t dmx_frame_mutex;
-static const osMutexAttr_t dmx_frame_mutex_attributes = {
-    .name = "dmx_frame_mutex"
+/* Semaphore to signal the completion of a frame to blocking updates */
+static osSemaphoreId_t dmx_frame_sent_semaphore = NULL;
+static const osSemaphoreAttr_t dmx_frame_sent_semaphore_attrs = {
+    .name = "dmx_frame_sent_semaphore"
 };
 
 static bool dmx_initialized = false;
 static dmx_port_state_t port_state = DMX_PORT_DISABLED;
 static dmx_frame_state_t frame_state = DMX_FRAME_IDLE;
-static uint8_t dmx_pending_frame[513] = {0};
-static bool has_pending_frame = false;
-static bool pending_frame_blocking = false;
-static uint8_t dmx_frame[513] = {0};
 static volatile bool dmx_direct_frame_update = false;
 
+/*
+ * Regular frames normally have their BREAK generated by the UART,
+ * by briefly switching to a lower baud rate, so that a frame only takes
+ * one interrupt to start its data and one to finish. The TIM4 sequence,
+ * which switches the TX pin between GPIO and UART, is still used for
+ * RDM requests and can be selected for regular frames for comparison.
+ */
+static volatile bool dmx_uart_break = true;
+static bool dmx_frame_uart_break = false;
+static bool dmx_tx_pin_uart = false;
+static uint32_t dmx_uart_brr = 0;
+static uint32_t dmx_uart_break_brr = 0;
+
+/* Frames whose data could not be started after the UART BREAK */
+static volatile uint32_t dmx_frame_start_errors = 0;
+
+/* Interrupts taken for the DMX port since the last frame was recorded */
+static volatile uint32_t dmx_isr_count = 0;
+static volatile uint32_t dmx_isr_cycles = 0;
+
+/*
+ * Triple-buffered frame pipeline.
+ *
+ * The writer buffer is only touched by the frame setters, and the
+ * transmit buffer is only touched by the frame sender. Both sides
+ * trade their buffer for the ready buffer with an atomic exchange
+ * of the shared state, so neither side ever blocks the other.
+ * Frame setters are called from several tasks, and from interrupts
+ * when direct frame updates are enabled, so each update is made
+ * inside a critical section from the start of the update until the
+ * writer buffer has been handed over.
+ */
+static uint8_t dmx_frame_buffers[3][DMX_FRAME_SIZE] = {0};
+static uint8_t dmx_writer_index = 0;
+static volatile uint8_t dmx_ready_state = 1;
+static uint8_t dmx_tx_index = 2;
+
+/*
+ * Range of slots in each buffer that are older than the most recently
+ * published frame, which the writer brings up to date before making
+ * further changes to that buffer. Only accessed by the frame setters.
+ */
+static uint16_t dmx_buffer_stale_start[3] = {0};
+static uint16_t dmx_buffer_stale_end[3] = {0};
+static uint8_t dmx_latest_index = 0;
+
+/*
+ * End of the highest slot set since the frame was last cleared, and the
+ * number of bytes to send for the frame held in each buffer.
+ */
+static uint16_t dmx_frame_end = 1;
+static uint16_t dmx_buffer_length[3] = { DMX_FRAME_SIZE, DMX_FRAME_SIZE, DMX_FRAME_SIZE };
+
+/* Sequence number and publish time of the frame in each buffer */
+static uint32_t dmx_published_sequence = 0;
+static uint32_t dmx_buffer_sequence[3] = {0};
+static uint32_t dmx_buffer_publish_cycles[3] = {0};
+static volatile uint32_t dmx_sent_sequence = 0;
+static volatile uint8_t dmx_frame_waiters = 0;
+static bool dmx_tx_latency_pending = false;
+
+/* RDM transaction currently using the line, if any */
+static const dmx_rdm_transaction_t *dmx_rdm_active = NULL;
+
+static dmx_latency_stats_t dmx_latency_stats = {0};
+
+/* Frame timing statistics, recorded by the DMX task */
+static dmx_frame_stats_t dmx_frame_stats = {0};
+static uint8_t dmx_frame_history_index = 0;
+static bool dmx_frame_timing_valid = false;
+static uint32_t dmx_frame_prev_cycles = 0;
+static uint32_t dmx_frame_deadline = 0;
+
+/*
+ * Fade requests are queued by the frame setters ahead of publishing the
+ * frame containing their target values, and are picked up by the frame
+ * sender together with that frame. The sender owns the active ramps.
+ * While any are active, each frame is sent from a private copy of the
+ * transmit buffer with their interpolated values filled in, so the
+ * published frames that later updates are copied from never hold them.
+ */
+static dmx_ramp_command_t dmx_ramp_queue[DMX_RAMP_QUEUE_SIZE] = {0};
+static volatile uint8_t dmx_ramp_queue_head = 0;
+static volatile uint8_t dmx_ramp_queue_tail = 0;
+static dmx_ramp_t dmx_ramps[DMX_RAMP_MAX_CHANNELS] = {0};
+static uint8_t dmx_ramp_frame[DMX_FRAME_SIZE] = {0};
+
+/* Data for the frame currently being sent */
+static const uint8_t *dmx_tx_data = NULL;
+
+/*
+ * Gamma 2.2 curve, sampled at 17 points across the fade in Q16,
+ * and linearly interpolated between those points.
+ */
+static const uint32_t dmx_ramp_gamma_table[17] = {
+    0, 147, 676, 1648, 3104, 5072, 7574, 10632, 14263,
+    18482, 23303, 28740, 34803, 41504, 48854, 56861, 65536
+};
+
 static void dmx_task_loop();
 static osStatus_t dmx_control_enable();
 static osStatus_t dmx_control_disable();
 static osStatus_t dmx_control_start();
 static osStatus_t dmx_control_stop(bool clear_frame);
-static osStatus_t dmx_control_set_frame();
-static void dmx_send_frame();
+static osStatus_t dmx_control_rdm(const dmx_rdm_transaction_t *transaction);
+static void dmx_control_event_finish(const dmx_control_event_t *control_event, osStatus_t ret);
+static size_t dmx_rdm_receive();
+static void dmx_rdm_release_line();
+static void dmx_tx_pin_init(bool uart);
+static void dmx_frame_abort();
+static void dmx_frame_latency_record();
+static uint8_t *dmx_frame_begin_update();
+static uint32_t dmx_frame_publish(uint16_t start, uint16_t end);
+static osStatus_t dmx_frame_wait_sent(uint32_t sequence, bool blocking);
+static void dmx_frame_clear_buffers();
+static osStatus_t dmx_ramp_queue_push(const uint16_t *channels, const uint16_t *values, size_t len,
+    bool wide_mode, uint16_t duration_ms, dmx_ramp_curve_t curve);
+static void dmx_ramp_process_commands();
+static const uint8_t *dmx_ramp_apply();
+static uint16_t dmx_ramp_value(const dmx_ramp_t *ramp, uint32_t ticks);
+static void dmx_frame_stats_record(uint32_t cycles_start, uint32_t cycles_sent, uint32_t cycles_done, uint32_t cycles_end, bool late,
+    uint32_t isr_count, uint32_t isr_cycles);
+static uint32_t dmx_frame_period_ms(uint16_t length);
+static bool dmx_send_frame();
 
 void task_dmx_run(void *argument)
 {
@@ -115,6 +334,11 @@ void task_dmx_run(void *argument)
 
     port_state = DMX_PORT_DISABLED;
     frame_state = DMX_FRAME_IDLE;
+    dmx_tx_pin_uart = false;
+
+    /* Baud rate divisors for the regular data rate and for generating the BREAK */
+    dmx_uart_brr = huart6.Instance->BRR;
+    dmx_uart_break_brr = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK2Freq(), DMX_UART_BREAK_BAUD);
 
     /* Create the queue for DMX task control events */
     dmx_control_queue = osMessageQueueNew(20, sizeof(dmx_control_event_t), &dmx_control_queue_attrs);
@@ -137,13 +361,16 @@ void task_dmx_run(void *argument)
         return;
     }
 
-    /* Create the mutex used to protect DMX frame update */
-    dmx_frame_mutex = osMutexNew(&dmx_frame_mutex_attributes);
-    if (!dmx_frame_mutex) {
-        log_e("dmx_frame_mutex create error");
+    /* Create the semaphore used to signal blocking frame updates */
+    dmx_frame_sent_semaphore = osSemaphoreNew(1, 0, &dmx_frame_sent_semaphore_attrs);
+    if (!dmx_frame_sent_semaphore) {
+        log_e("Unable to create frame sent semaphore");
         return;
     }
 
+    /* Enable the cycle counter, which is used for latency measurement */
+    cycle_counter_enable();
+
     dmx_initialized = true;
 
     /* Release the startup semaphore */
@@ -166,24 +393,60 @@ void task_dmx_run(void *argument)
     for (;;) {
         if (port_state == DMX_PORT_ENABLED_TRANSMITTING) {
             uint32_t ticks_start = osKernelGetTickCount();
+            const uint32_t cycles_start = DWT->CYCCNT;
+            const bool late = dmx_frame_timing_valid && (int32_t)(ticks_start - dmx_frame_deadline) > 0;
+
             /* Send the next frame */
-            dmx_send_frame();
+            if (!dmx_send_frame()) {
+                log_w("Invalid state");
+            }
+            const uint32_t cycles_sent = DWT->CYCCNT;
 
             /* Block until the frame is sent */
-            osSemaphoreAcquire(dmx_frame_semaphore, portMAX_DELAY);
+            if (osSemaphoreAcquire(dmx_frame_semaphore, DMX_FRAME_WAIT_MS) != osOK) {
+                log_w("Frame not completed");
+                dmx_frame_abort();
+                dmx_frame_timing_valid = false;
+            }
+            const uint32_t cycles_done = DWT->CYCCNT;
 
-            /* Copy any pending frame updates */
-            osMutexAcquire(dmx_frame_mutex, portMAX_DELAY);
-            if (has_pending_frame && !pending_frame_blocking) {
-                memcpy(dmx_frame, dmx_pending_frame, sizeof(dmx_frame));
-                has_pending_frame = false;
+            if (dmx_frame_start_errors > 0) {
+                log_w("Frame data not started: %lu", __atomic_exchange_n(&dmx_frame_start_errors, 0, __ATOMIC_RELAXED));
+            }
+
+            /* Collect the interrupts taken for this frame, before any RDM transaction */
+            UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+            const uint32_t isr_count = dmx_isr_count;
+            const uint32_t isr_cycles = dmx_isr_cycles;
+            dmx_isr_count = 0;
+            dmx_isr_cycles = 0;
+            taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
+            dmx_frame_deadline = ticks_start + dmx_frame_period_ms(dmx_buffer_length[dmx_tx_index]);
+
+            /*
+             * RDM transactions are slotted into the gap between frames,
+             * so that they only push back the next frame if they do not
+             * fit within the remainder of the frame period.
+             */
+            bool rdm_stretched = false;
+            ret = osMessageQueueGet(dmx_control_queue, &control_event, NULL, 0);
+            if (ret == osOK && control_event.event_type == DMX_CONTROL_RDM) {
+                dmx_control_event_finish(&control_event, dmx_control_rdm(control_event.rdm));
+                rdm_stretched = (int32_t)(osKernelGetTickCount() - dmx_frame_deadline) > 0;
+                ret = osErrorResource;
             }
-            osMutexRelease(dmx_frame_mutex);
 
             /* Add a delay to fill out the BREAK to BREAK time */
-            osDelayUntil(ticks_start + DMX_FRAME_PERIOD_MS);
+            osDelayUntil(dmx_frame_deadline);
 
-            ret = osMessageQueueGet(dmx_control_queue, &control_event, NULL, 0);
+            dmx_frame_stats_record(cycles_start, cycles_sent, cycles_done, DWT->CYCCNT, late,
+                isr_count, isr_cycles);
+
+            /* A period stretched by an RDM transaction is not a frame period */
+            if (rdm_stretched) {
+                dmx_frame_timing_valid = false;
+            }
         } else {
             ret = osMessageQueueGet(dmx_control_queue, &control_event, NULL, portMAX_DELAY);
         }
@@ -206,19 +469,24 @@ void task_dmx_run(void *argument)
         case DMX_CONTROL_PAUSE:
             ret = dmx_control_stop(false);
             break;
-        case DMX_CONTROL_SET_FRAME:
-            ret = dmx_control_set_frame();
+        case DMX_CONTROL_RDM:
+            ret = dmx_control_rdm(control_event.rdm);
             break;
         default:
             break;
         }
 
-        if (control_event.result) {
-            *(control_event.result) = ret;
-        }
-        if (osSemaphoreRelease(dmx_control_semaphore) != osOK) {
-            log_e("Unable to release dmx_control_semaphore");
-        }
+        dmx_control_event_finish(&control_event, ret);
+    }
+}
+
+void dmx_control_event_finish(const dmx_control_event_t *control_event, osStatus_t ret)
+{
+    if (control_event->result) {
+        *(control_event->result) = ret;
+    }
+    if (osSemaphoreRelease(dmx_control_semaphore) != osOK) {
+        log_e("Unable to release dmx_control_semaphore");
     }
 }
 
@@ -329,6 +597,15 @@ osStatus_t dmx_control_start()
 
     port_state = DMX_PORT_ENABLED_TRANSMITTING;
 
+    /* The gap since frames were last sent is not a frame period */
+    dmx_frame_timing_valid = false;
+
+    /* Drop any interrupts counted while frames were being sent explicitly */
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    dmx_isr_count = 0;
+    dmx_isr_cycles = 0;
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
     log_i("DMX512 frame output started");
 
     return osOK;
@@ -378,13 +655,8 @@ osStatus_t dmx_control_stop(bool clear_frame)
     port_state = DMX_PORT_ENABLED_IDLE;
 
     if (clear_frame) {
-        /* Clear the active and pending DMX frame values */
-        osMutexAcquire(dmx_frame_mutex, portMAX_DELAY);
-        memset(dmx_pending_frame, 0, sizeof(dmx_pending_frame));
-        memset(dmx_frame, 0, sizeof(dmx_frame));
-        has_pending_frame = false;
-        pending_frame_blocking = false;
-        osMutexRelease(dmx_frame_mutex);
+        /* Clear all the DMX frame buffers */
+        dmx_frame_clear_buffers();
     }
 
     log_i("DMX512 frame output stopped");
@@ -392,135 +664,549 @@ osStatus_t dmx_control_stop(bool clear_frame)
     return osOK;
 }
 
-osStatus_t dmx_set_frame(uint16_t offset, const uint8_t *frame, size_t len, bool blocking)
+osStatus_t dmx_rdm_transaction(const uint8_t *request, size_t request_len,
+    uint8_t *response, size_t response_size, size_t *response_len)
 {
+    if (!dmx_initialized) { return osErrorResource; }
+
+    if (!request || request_len == 0 || request_len > DMX_FRAME_SIZE
+        || (response && (response_size == 0 || response_size > UINT16_MAX))) {
+        return osErrorParameter;
+    }
+
+    size_t received = 0;
+    const dmx_rdm_transaction_t transaction = {
+        .request = request,
+        .request_len = request_len,
+        .response = response,
+        .response_size = response_size,
+        .response_len = &received
+    };
+
     osStatus_t result = osOK;
+    dmx_control_event_t control_event = {
+        .event_type = DMX_CONTROL_RDM,
+        .rdm = &transaction,
+        .result = &result
+    };
+
+    osMessageQueuePut(dmx_control_queue, &control_event, 0, portMAX_DELAY);
+    osSemaphoreAcquire(dmx_control_semaphore, portMAX_DELAY);
+
+    if (response_len) {
+        *response_len = received;
+    }
+    return result;
+}
+
+osStatus_t dmx_control_rdm(const dmx_rdm_transaction_t *transaction)
+{
+    if (frame_state != DMX_FRAME_MARK_BEFORE_BREAK || port_state == DMX_PORT_DISABLED) {
+        log_w("Invalid state");
+        return osErrorResource;
+    }
+
+    dmx_rdm_active = transaction;
+    dmx_frame_uart_break = false;
+
+    /* Set TX state to low */
+    HAL_GPIO_WritePin(DMX512_TX_GPIO_Port, DMX512_TX_Pin, GPIO_PIN_RESET);
+    if (dmx_tx_pin_uart) {
+        dmx_tx_pin_init(false);
+    }
 
+    frame_state = DMX_FRAME_BREAK;
+
+    /* Timer settings for the longer break required ahead of RDM requests (~196us) */
+    __HAL_TIM_SET_COUNTER(&htim4, 0);
+    __HAL_TIM_SET_COMPARE(&htim4, TIM_CHANNEL_1, 180);
+    HAL_TIM_OC_Start_IT(&htim4, TIM_CHANNEL_1);
+
+    /* Block until the request is sent */
+    if (osSemaphoreAcquire(dmx_frame_semaphore, DMX_FRAME_WAIT_MS) != osOK) {
+        log_w("RDM request not completed");
+        dmx_frame_abort();
+        dmx_rdm_active = NULL;
+        return osErrorTimeout;
+    }
+
+    if (frame_state == DMX_FRAME_RDM_RESPONSE) {
+        *(transaction->response_len) = dmx_rdm_receive();
+        dmx_rdm_release_line();
+    }
+
+    dmx_rdm_active = NULL;
+
+    return osOK;
+}
+
+size_t dmx_rdm_receive()
+{
+    const uint32_t ticks_start = osKernelGetTickCount();
+    uint32_t ticks_changed = ticks_start;
+    uint16_t received = 0;
+
+    /*
+     * Responses are collected until the line goes quiet, as their length
+     * is not known up front and discovery responses may be garbled
+     * by collisions.
+     */
+    for (;;) {
+        osDelay(1);
+        const uint32_t ticks = osKernelGetTickCount();
+        const uint16_t count = huart6.RxXferSize - huart6.RxXferCount;
+
+        if (huart6.RxState == HAL_UART_STATE_READY) {
+            received = count;
+            break;
+        } else if (count != received) {
+            received = count;
+            ticks_changed = ticks;
+        } else if (received == 0 && ticks - ticks_start > DMX_RDM_RESPONSE_WAIT_MS) {
+            break;
+        } else if (received > 0 && ticks - ticks_changed > DMX_RDM_RESPONSE_IDLE_MS) {
+            break;
+        }
+
+        if (ticks - ticks_start > DMX_RDM_RESPONSE_MAX_MS) {
+            break;
+        }
+    }
+
+    HAL_UART_AbortReceive(&huart6);
+
+    return received;
+}
+
+void dmx_rdm_release_line()
+{
+    /* Disable RX input */
+    HAL_GPIO_WritePin(DMX512_RX_EN_GPIO_Port, DMX512_RX_EN_Pin, GPIO_PIN_SET);
+
+    /* Reconfigure RX pin as GPIO */
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = DMX512_RX_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+    HAL_GPIO_WritePin(DMX512_RX_GPIO_Port, DMX512_RX_Pin, GPIO_PIN_RESET);
+
+    /* Enable TX output, with the TX pin still held high */
+    HAL_GPIO_WritePin(DMX512_TX_EN_GPIO_Port, DMX512_TX_EN_Pin, GPIO_PIN_SET);
+
+    frame_state = DMX_FRAME_MARK_BEFORE_BREAK;
+}
+
+osStatus_t dmx_set_frame(uint16_t offset, const uint8_t *frame, size_t len, bool blocking)
+{
     if (!dmx_initialized) { return osErrorResource; }
 
     if (offset + len > 512) {
         return osErrorParameter;
     }
 
-    if (dmx_direct_frame_update) {
-        memcpy(dmx_frame + offset + 1, frame, len);
-        memcpy(dmx_pending_frame + offset + 1, frame, len);
-        has_pending_frame = false;
-        pending_frame_blocking = false;
-    } else {
-        osMutexAcquire(dmx_frame_mutex, portMAX_DELAY);
-        memcpy(dmx_pending_frame + offset + 1, frame, len);
-        has_pending_frame = true;
-        pending_frame_blocking = blocking;
-        osMutexRelease(dmx_frame_mutex);
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    uint8_t *buf = dmx_frame_begin_update();
+    memcpy(buf + offset + 1, frame, len);
+
+    if (offset + 1 + len > dmx_frame_end) {
+        dmx_frame_end = offset + 1 + len;
     }
 
-    if (blocking) {
-        dmx_control_event_t control_event = {
-            .event_type = DMX_CONTROL_SET_FRAME,
-            .result = &result
-        };
+    const uint32_t sequence = dmx_frame_publish(offset + 1, offset + 1 + len);
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
 
-        osMessageQueuePut(dmx_control_queue, &control_event, 0, portMAX_DELAY);
-        osSemaphoreAcquire(dmx_control_semaphore, portMAX_DELAY);
+    return dmx_frame_wait_sent(sequence, blocking);
+}
+
+osStatus_t dmx_set_sparse_frame(const uint16_t *channels, const uint8_t *values, size_t len, bool blocking)
+{
+    if (!dmx_initialized) { return osErrorResource; }
+
+    if (!channels || !values) {
+        return osErrorParameter;
     }
 
-    return result;
+    uint16_t start = DMX_FRAME_SIZE;
+    uint16_t end = 0;
+
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    uint8_t *buf = dmx_frame_begin_update();
+    for (size_t i = 0; i < len; i++) {
+        if (channels[i] > 511) { continue; }
+        buf[channels[i] + 1] = values[i];
+        if (channels[i] + 1 < start) { start = channels[i] + 1; }
+        if (channels[i] + 2 > end) { end = channels[i] + 2; }
+    }
+
+    if (end > dmx_frame_end) {
+        dmx_frame_end = end;
+    }
+
+    const uint32_t sequence = dmx_frame_publish(start, end);
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
+    return dmx_frame_wait_sent(sequence, blocking);
 }
 
-osStatus_t dmx_set_sparse_frame(const uint16_t *channels, const uint8_t *values, size_t len, bool blocking)
+osStatus_t dmx_clear_frame(bool blocking)
 {
-    osStatus_t result = osOK;
+    if (!dmx_initialized) { return osErrorResource; }
+
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+
+    /* Cancel any fades in progress, so they do not linger over the cleared frame */
+    dmx_ramp_queue_push(NULL, NULL, 0, false, 0, DMX_RAMP_CURVE_LINEAR);
+
+    uint8_t *buf = dmx_frame_begin_update();
+    memset(buf + 1, 0, DMX_FRAME_SIZE - 1);
+    dmx_frame_end = 1;
+
+    const uint32_t sequence = dmx_frame_publish(1, DMX_FRAME_SIZE);
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
 
+    return dmx_frame_wait_sent(sequence, blocking);
+}
+
+osStatus_t dmx_set_ramp_frame(const uint16_t *channels, const uint16_t *values, size_t len,
+    bool wide_mode, uint16_t duration_ms, dmx_ramp_curve_t curve, bool blocking)
+{
     if (!dmx_initialized) { return osErrorResource; }
 
-    if (!channels || !values) {
+    if (!channels || !values || len > DMX_RAMP_MAX_CHANNELS) {
         return osErrorParameter;
     }
 
-    if (dmx_direct_frame_update) {
-        for (size_t i = 0; i < len; i++) {
-            if (channels[i] > 511) { continue; }
-            dmx_frame[channels[i] + 1] = values[i];
-            dmx_pending_frame[channels[i] + 1] = values[i];
+    /*
+     * Queue the fade before publishing its target values, so the frame
+     * sender can never pick up the new frame without also seeing the fade.
+     * The queue is drained as each frame is sent, so if it is full then
+     * wait for that to happen when allowed to block. Otherwise leave the
+     * frame alone, as publishing the values without their fade would
+     * step the output instead.
+     */
+    const uint32_t ticks_start = osKernelGetTickCount();
+    UBaseType_t saved_interrupt_status;
+    osStatus_t ramp_result;
+    for (;;) {
+        saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+        ramp_result = dmx_ramp_queue_push(channels, values, len, wide_mode, duration_ms, curve);
+        if (ramp_result != osErrorResource) { break; }
+        taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
+        if (!blocking || dmx_direct_frame_update
+            || port_state != DMX_PORT_ENABLED_TRANSMITTING
+            || osKernelGetTickCount() - ticks_start >= DMX_FRAME_WAIT_MS) {
+            return osErrorResource;
         }
-        has_pending_frame = false;
-        pending_frame_blocking = false;
-    } else {
-        osMutexAcquire(dmx_frame_mutex, portMAX_DELAY);
+        osDelay(1);
+    }
+
+    uint16_t start = DMX_FRAME_SIZE;
+    uint16_t end = 0;
 
-        for (size_t i = 0; i < len; i++) {
-            if (channels[i] > 511) { continue; }
-            dmx_pending_frame[channels[i] + 1] = values[i];
+    uint8_t *buf = dmx_frame_begin_update();
+    for (size_t i = 0; i < len; i++) {
+        if (channels[i] > (wide_mode ? 510 : 511)) { continue; }
+        const uint16_t slot = channels[i] + 1;
+        const uint16_t slot_end = slot + (wide_mode ? 2 : 1);
+        if (wide_mode) {
+            conv_u16_array(buf + slot, values[i]);
+        } else {
+            buf[slot] = (uint8_t)values[i];
         }
+        if (slot < start) { start = slot; }
+        if (slot_end > end) { end = slot_end; }
+    }
+
+    if (end > dmx_frame_end) {
+        dmx_frame_end = end;
+    }
 
-        has_pending_frame = true;
-        pending_frame_blocking = blocking;
+    const uint32_t sequence = dmx_frame_publish(start, end);
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
 
-        osMutexRelease(dmx_frame_mutex);
+    osStatus_t result = dmx_frame_wait_sent(sequence, blocking);
+    return (result == osOK) ? ramp_result : result;
+}
+
+osStatus_t dmx_ramp_queue_push(const uint16_t *channels, const uint16_t *values, size_t len,
+    bool wide_mode, uint16_t duration_ms, dmx_ramp_curve_t curve)
+{
+    const uint8_t head = dmx_ramp_queue_head;
+    const uint8_t next_head = (head + 1) % DMX_RAMP_QUEUE_SIZE;
+
+    if (next_head == __atomic_load_n(&dmx_ramp_queue_tail, __ATOMIC_ACQUIRE)) {
+        return osErrorResource;
     }
 
-    if (blocking) {
-        dmx_control_event_t control_event = {
-            .event_type = DMX_CONTROL_SET_FRAME,
-            .result = &result
-        };
+    dmx_ramp_command_t *command = &dmx_ramp_queue[head];
+    command->count = 0;
+    command->wide_mode = wide_mode;
+    command->curve = curve;
+    command->duration_ms = duration_ms;
+    for (size_t i = 0; i < len; i++) {
+        if (channels[i] > (wide_mode ? 510 : 511)) { continue; }
+        command->slots[command->count] = channels[i] + 1;
+        command->targets[command->count] = wide_mode ? values[i] : (values[i] & 0x00FF);
+        command->count++;
+    }
 
-        osMessageQueuePut(dmx_control_queue, &control_event, 0, portMAX_DELAY);
-        osSemaphoreAcquire(dmx_control_semaphore, portMAX_DELAY);
+    /* A fade request that ends up with no valid channels is treated as a no-op */
+    if (len > 0 && command->count == 0) {
+        return osErrorParameter;
     }
 
-    return result;
+    __atomic_store_n(&dmx_ramp_queue_head, next_head, __ATOMIC_RELEASE);
+    return osOK;
 }
 
-osStatus_t dmx_clear_frame(bool blocking)
+uint8_t *dmx_frame_begin_update()
 {
-    osStatus_t result = osOK;
+    const uint8_t index = dmx_writer_index;
+    const uint16_t start = dmx_buffer_stale_start[index];
+    const uint16_t end = dmx_buffer_stale_end[index];
+
+    /*
+     * Bring the writer buffer up to date with the latest published frame.
+     * Only the slots changed since this buffer last held the latest frame
+     * need to be copied, which is normally just a handful of channels.
+     */
+    if (start < end) {
+        memcpy(dmx_frame_buffers[index] + start, dmx_frame_buffers[dmx_latest_index] + start, end - start);
+        dmx_buffer_stale_start[index] = 0;
+        dmx_buffer_stale_end[index] = 0;
+    }
 
-    if (!dmx_initialized) { return osErrorResource; }
+    return dmx_frame_buffers[index];
+}
 
-    if (dmx_direct_frame_update) {
-        memset(dmx_frame, 0, sizeof(dmx_frame));
-        memset(dmx_pending_frame, 0, sizeof(dmx_frame));
-        has_pending_frame = false;
-        pending_frame_blocking = false;
-    } else {
-        osMutexAcquire(dmx_frame_mutex, portMAX_DELAY);
-        memset(dmx_pending_frame, 0, sizeof(dmx_pending_frame));
-        has_pending_frame = true;
-        pending_frame_blocking = blocking;
-        osMutexRelease(dmx_frame_mutex);
+uint32_t dmx_frame_publish(uint16_t start, uint16_t end)
+{
+    const uint8_t index = dmx_writer_index;
+
+    /* Mark the changed range as stale in the other buffers */
+    if (start < end) {
+        for (uint8_t i = 0; i < 3; i++) {
+            if (i == index) { continue; }
+            if (dmx_buffer_stale_start[i] >= dmx_buffer_stale_end[i]) {
+                dmx_buffer_stale_start[i] = start;
+                dmx_buffer_stale_end[i] = end;
+            } else {
+                if (start < dmx_buffer_stale_start[i]) { dmx_buffer_stale_start[i] = start; }
+                if (end > dmx_buffer_stale_end[i]) { dmx_buffer_stale_end[i] = end; }
+            }
+        }
+    }
+
+    /* Only send as much of the frame as is actually in use */
+    uint16_t length = dmx_frame_end + DMX_FRAME_SLOT_MARGIN;
+    if (length > DMX_FRAME_SIZE) {
+        length = DMX_FRAME_SIZE;
     }
+    dmx_buffer_length[index] = length;
 
-    if (blocking) {
-        dmx_control_event_t control_event = {
-            .event_type = DMX_CONTROL_SET_FRAME,
-            .result = &result
-        };
+    const uint32_t sequence = ++dmx_published_sequence;
+    dmx_buffer_sequence[index] = sequence;
+    dmx_buffer_publish_cycles[index] = DWT->CYCCNT;
+    dmx_latest_index = index;
 
-        osMessageQueuePut(dmx_control_queue, &control_event, 0, portMAX_DELAY);
-        osSemaphoreAcquire(dmx_control_semaphore, portMAX_DELAY);
+    /* Hand the writer buffer over, and take back whatever was ready */
+    const uint8_t prev_state = __atomic_exchange_n(&dmx_ready_state,
+        index | DMX_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+    dmx_writer_index = prev_state & DMX_BUFFER_INDEX_MASK;
+
+    if ((prev_state & DMX_BUFFER_FRESH) != 0) {
+        /* The previous update was replaced before it could be sent */
+        dmx_latency_stats.superseded++;
     }
 
-    return result;
+    return sequence;
 }
 
-osStatus_t dmx_control_set_frame()
+osStatus_t dmx_frame_wait_sent(uint32_t sequence, bool blocking)
 {
-    log_d("dmx_control_set_frame");
+    if (!blocking || dmx_direct_frame_update) {
+        return osOK;
+    }
 
-    if (frame_state != DMX_FRAME_MARK_BEFORE_BREAK) {
-        log_w("Invalid state");
+    if (frame_state == DMX_FRAME_IDLE) {
         return osErrorResource;
+    } else if (port_state != DMX_PORT_ENABLED_TRANSMITTING) {
+        /* The update will go out with the next explicitly sent frame */
+        return osOK;
     }
 
-    osMutexAcquire(dmx_frame_mutex, portMAX_DELAY);
-    memcpy(dmx_frame, dmx_pending_frame, sizeof(dmx_frame));
-    has_pending_frame = false;
-    pending_frame_blocking = false;
-    osMutexRelease(dmx_frame_mutex);
+    /*
+     * Wait until a frame containing this update has been sent.
+     * Completions left over from earlier frames only cause another
+     * check of the sequence number.
+     */
+    osStatus_t result = osOK;
+    __atomic_add_fetch(&dmx_frame_waiters, 1, __ATOMIC_ACQ_REL);
+    const uint32_t ticks_start = osKernelGetTickCount();
+    while ((int32_t)(dmx_sent_sequence - sequence) < 0) {
+        const uint32_t elapsed = osKernelGetTickCount() - ticks_start;
+        if (elapsed >= DMX_FRAME_WAIT_MS
+            || osSemaphoreAcquire(dmx_frame_sent_semaphore, DMX_FRAME_WAIT_MS - elapsed) != osOK) {
+            log_w("Timeout waiting for frame");
+            result = osErrorTimeout;
+            break;
+        }
+    }
+    if (__atomic_sub_fetch(&dmx_frame_waiters, 1, __ATOMIC_ACQ_REL) > 0) {
+        /* Pass the completion on to any other task waiting on a frame */
+        osSemaphoreRelease(dmx_frame_sent_semaphore);
+    }
 
-    return osOK;
+    return result;
+}
+
+void dmx_frame_clear_buffers()
+{
+    /*
+     * Only called from the DMX task, while no frame is being sent,
+     * but frame setters may still be running in other contexts.
+     */
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    memset(dmx_ramps, 0, sizeof(dmx_ramps));
+    __atomic_store_n(&dmx_ramp_queue_tail, dmx_ramp_queue_head, __ATOMIC_RELEASE);
+
+    memset(dmx_frame_buffers, 0, sizeof(dmx_frame_buffers));
+    memset(dmx_buffer_stale_start, 0, sizeof(dmx_buffer_stale_start));
+    memset(dmx_buffer_stale_end, 0, sizeof(dmx_buffer_stale_end));
+    dmx_frame_end = 1;
+    for (uint8_t i = 0; i < 3; i++) {
+        dmx_buffer_length[i] = 1 + DMX_FRAME_SLOT_MARGIN;
+    }
+    dmx_writer_index = 0;
+    __atomic_store_n(&dmx_ready_state, 1, __ATOMIC_RELEASE);
+    dmx_tx_index = 2;
+    dmx_latest_index = 0;
+    dmx_tx_latency_pending = false;
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+}
+
+uint32_t dmx_frame_period_ms(uint16_t length)
+{
+    if (length >= DMX_FRAME_SIZE) {
+        return DMX_FRAME_PERIOD_MS;
+    }
+
+    /* Round the frame time up to whole ticks, with the same slack as a full frame */
+    const uint32_t frame_us = DMX_FRAME_OVERHEAD_US + (length * DMX_SLOT_TIME_US);
+    uint32_t period_ms = (frame_us + 999U) / 1000U
+        + (DMX_FRAME_PERIOD_MS - ((DMX_FRAME_OVERHEAD_US + (DMX_FRAME_SIZE * DMX_SLOT_TIME_US) + 999U) / 1000U));
+    if (period_ms < DMX_FRAME_PERIOD_MIN_MS) {
+        period_ms = DMX_FRAME_PERIOD_MIN_MS;
+    }
+    return period_ms;
+}
+
+void dmx_frame_stats_record(uint32_t cycles_start, uint32_t cycles_sent, uint32_t cycles_done, uint32_t cycles_end, bool late,
+    uint32_t isr_count, uint32_t isr_cycles)
+{
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    const uint32_t send_us = (cycles_sent - cycles_start) / cycles_per_us;
+    const uint32_t busy_us = (cycles_done - cycles_sent) / cycles_per_us;
+    const uint32_t idle_us = (cycles_end - cycles_done) / cycles_per_us;
+
+    taskENTER_CRITICAL();
+
+    if (dmx_frame_timing_valid) {
+        const uint32_t period_us = (cycles_start - dmx_frame_prev_cycles) / cycles_per_us;
+
+        if (dmx_frame_stats.count == 0 || period_us < dmx_frame_stats.min_period_us) {
+            dmx_frame_stats.min_period_us = period_us;
+        }
+        if (period_us > dmx_frame_stats.max_period_us) {
+            dmx_frame_stats.max_period_us = period_us;
+        }
+        dmx_frame_stats.total_period_us += period_us;
+        dmx_frame_stats.count++;
+
+        dmx_frame_stats.history_us[dmx_frame_history_index] = period_us;
+        dmx_frame_history_index = (dmx_frame_history_index + 1) % DMX_FRAME_HISTORY_SIZE;
+
+        if (late) {
+            dmx_frame_stats.late++;
+        }
+    }
+
+    if (send_us > dmx_frame_stats.max_send_us) {
+        dmx_frame_stats.max_send_us = send_us;
+    }
+    dmx_frame_stats.total_send_us += send_us;
+    dmx_frame_stats.total_busy_us += busy_us;
+    dmx_frame_stats.total_idle_us += idle_us;
+
+    dmx_frame_stats.sent++;
+    dmx_frame_stats.total_isr += isr_count;
+    if (isr_count > dmx_frame_stats.max_isr) {
+        dmx_frame_stats.max_isr = isr_count;
+    }
+    dmx_frame_stats.total_isr_cycles += isr_cycles;
+    if (isr_cycles > dmx_frame_stats.max_isr_cycles) {
+        dmx_frame_stats.max_isr_cycles = isr_cycles;
+    }
+
+    dmx_frame_prev_cycles = cycles_start;
+    dmx_frame_timing_valid = true;
+
+    taskEXIT_CRITICAL();
+}
+
+void dmx_get_frame_stats(dmx_frame_stats_t *stats)
+{
+    if (!stats) { return; }
+    taskENTER_CRITICAL();
+    memcpy(stats, &dmx_frame_stats, sizeof(dmx_frame_stats_t));
+
+    /* Rotate the history so it reads oldest first */
+    for (uint8_t i = 0; i < DMX_FRAME_HISTORY_SIZE; i++) {
+        stats->history_us[i] = dmx_frame_stats.history_us[(dmx_frame_history_index + i) % DMX_FRAME_HISTORY_SIZE];
+    }
+    taskEXIT_CRITICAL();
+}
+
+void dmx_reset_frame_stats()
+{
+    taskENTER_CRITICAL();
+    memset(&dmx_frame_stats, 0, sizeof(dmx_frame_stats_t));
+    dmx_frame_history_index = 0;
+    taskEXIT_CRITICAL();
+}
+
+void dmx_set_uart_break(bool enabled)
+{
+    dmx_uart_break = enabled;
+}
+
+bool dmx_is_uart_break()
+{
+    return dmx_uart_break;
+}
+
+void dmx_isr_record(uint32_t cycles)
+{
+    dmx_isr_count++;
+    dmx_isr_cycles += cycles;
+}
+
+void dmx_get_latency_stats(dmx_latency_stats_t *stats)
+{
+    if (!stats) { return; }
+    taskENTER_CRITICAL();
+    memcpy(stats, &dmx_latency_stats, sizeof(dmx_latency_stats_t));
+    taskEXIT_CRITICAL();
+}
+
+void dmx_reset_latency_stats()
+{
+    taskENTER_CRITICAL();
+    memset(&dmx_latency_stats, 0, sizeof(dmx_latency_stats_t));
+    taskEXIT_CRITICAL();
 }
 
 void dmx_enable_direct_frame_update()
@@ -528,20 +1214,68 @@ void dmx_enable_direct_frame_update()
     dmx_direct_frame_update = true;
 }
 
-void dmx_send_frame_explicit()
+bool dmx_send_frame_explicit()
+{
+    return dmx_send_frame();
+}
+
+uint32_t dmx_get_frame_duration_ms()
 {
-    dmx_send_frame();
+    const uint32_t frame_us = DMX_FRAME_OVERHEAD_US + (dmx_buffer_length[dmx_latest_index] * DMX_SLOT_TIME_US);
+    return (frame_us + 999U) / 1000U;
 }
 
-void dmx_send_frame()
+bool dmx_send_frame()
 {
     if (frame_state != DMX_FRAME_MARK_BEFORE_BREAK) {
-        log_w("Invalid state");
-        return;
+        return false;
+    }
+
+    /*
+     * Start any newly requested fades from the values last sent, then pick
+     * up the most recently published frame, if there is one.
+     * This is done with interrupts masked so that a frame update cannot
+     * slip in between the two steps.
+     */
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    dmx_ramp_process_commands();
+    if ((dmx_ready_state & DMX_BUFFER_FRESH) != 0) {
+        const uint8_t prev_state = __atomic_exchange_n(&dmx_ready_state,
+            dmx_tx_index, __ATOMIC_ACQ_REL);
+        dmx_tx_index = prev_state & DMX_BUFFER_INDEX_MASK;
+        dmx_tx_latency_pending = true;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
+    /* Fill in the current values of any channels being faded */
+    dmx_tx_data = dmx_ramp_apply();
+
+    dmx_frame_uart_break = dmx_uart_break;
+    if (dmx_frame_uart_break) {
+        if (!dmx_tx_pin_uart) {
+            dmx_tx_pin_init(true);
+        }
+
+        frame_state = DMX_FRAME_BREAK;
+
+        /*
+         * Send a zero byte at the lower baud rate, which produces both the
+         * BREAK and the Mark-After-Break, and continue with the frame data
+         * from the transmit complete interrupt for that byte.
+         */
+        huart6.Instance->BRR = dmx_uart_break_brr;
+        __HAL_UART_CLEAR_FLAG(&huart6, UART_FLAG_TC);
+        huart6.Instance->DR = 0x00;
+        __HAL_UART_ENABLE_IT(&huart6, UART_IT_TC);
+
+        return true;
     }
 
     /* Set TX state to low */
     HAL_GPIO_WritePin(DMX512_TX_GPIO_Port, DMX512_TX_Pin, GPIO_PIN_RESET);
+    if (dmx_tx_pin_uart) {
+        dmx_tx_pin_init(false);
+    }
 
     frame_state = DMX_FRAME_BREAK;
 
@@ -549,6 +1283,8 @@ void dmx_send_frame()
     __HAL_TIM_SET_COUNTER(&htim4, 0);
     __HAL_TIM_SET_COMPARE(&htim4, TIM_CHANNEL_1, 100); /* Timer period 100us */
     HAL_TIM_OC_Start_IT(&htim4, TIM_CHANNEL_1);
+
+    return true;
 }
 
 void dmx_timer_notify()
@@ -558,13 +1294,7 @@ void dmx_timer_notify()
 
     if (frame_state == DMX_FRAME_BREAK) {
         /* Reconfigure TX pin as UART */
-        GPIO_InitTypeDef GPIO_InitStruct = {0};
-        GPIO_InitStruct.Pin = DMX512_TX_Pin;
-        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
-        GPIO_InitStruct.Pull = GPIO_NOPULL;
-        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-        GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
-        HAL_GPIO_Init(DMX512_TX_GPIO_Port, &GPIO_InitStruct);
+        dmx_tx_pin_init(true);
 
         frame_state = DMX_FRAME_MARK_AFTER_BREAK;
 
@@ -573,29 +1303,281 @@ void dmx_timer_notify()
         __HAL_TIM_SET_COMPARE(&htim4, TIM_CHANNEL_1, 7);
         HAL_TIM_OC_Start_IT(&htim4, TIM_CHANNEL_1);
 
+    } else if (frame_state == DMX_FRAME_MARK_AFTER_BREAK && dmx_rdm_active) {
+        frame_state = DMX_FRAME_DATA;
+        /* Begin UART transmission of the RDM request */
+        HAL_UART_Transmit_DMA(&huart6, dmx_rdm_active->request, dmx_rdm_active->request_len);
+
     } else if (frame_state == DMX_FRAME_MARK_AFTER_BREAK) {
         frame_state = DMX_FRAME_DATA;
         /* Begin UART transmission of frame data */
-        HAL_UART_Transmit_DMA(&huart6, dmx_frame, sizeof(dmx_frame));
+        HAL_UART_Transmit_DMA(&huart6, dmx_tx_data, dmx_buffer_length[dmx_tx_index]);
+
+        /* Measure the time from publishing the frame to it going out on the wire */
+        dmx_frame_latency_record();
     }
 }
 
+void dmx_frame_abort()
+{
+    /* Stop whatever part of the frame was still in progress */
+    HAL_TIM_OC_Stop_IT(&htim4, TIM_CHANNEL_1);
+    HAL_UART_AbortTransmit(&huart6);
+    huart6.Instance->BRR = dmx_uart_brr;
+
+    /* Return the line to idle, for when the TX pin is under GPIO control */
+    HAL_GPIO_WritePin(DMX512_TX_GPIO_Port, DMX512_TX_Pin, GPIO_PIN_SET);
+
+    frame_state = DMX_FRAME_MARK_BEFORE_BREAK;
+
+    /* Discard a completion that raced with the abort */
+    osSemaphoreAcquire(dmx_frame_semaphore, 0);
+}
+
+void dmx_frame_latency_record()
+{
+    if (dmx_tx_latency_pending) {
+        const uint32_t latency_us = (DWT->CYCCNT - dmx_buffer_publish_cycles[dmx_tx_index]) / (SystemCoreClock / 1000000U);
+        dmx_latency_stats.count++;
+        dmx_latency_stats.last_us = latency_us;
+        if (latency_us > dmx_latency_stats.max_us) {
+            dmx_latency_stats.max_us = latency_us;
+        }
+        dmx_latency_stats.total_us += latency_us;
+        if (latency_us > DMX_FRAME_LATENCY_LIMIT_US(dmx_frame_period_ms(dmx_buffer_length[dmx_tx_index]))) {
+            dmx_latency_stats.late++;
+        }
+        dmx_tx_latency_pending = false;
+    }
+}
+
+void dmx_tx_pin_init(bool uart)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = DMX512_TX_Pin;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    if (uart) {
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+        GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
+    } else {
+        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    }
+    HAL_GPIO_Init(DMX512_TX_GPIO_Port, &GPIO_InitStruct);
+    dmx_tx_pin_uart = uart;
+}
+
 void dmx_uart_tx_cplt()
 {
-    if (frame_state == DMX_FRAME_DATA) {
+    if (frame_state == DMX_FRAME_BREAK && dmx_frame_uart_break) {
+        /* The BREAK byte has been sent, so go back to the regular baud rate */
+        huart6.Instance->BRR = dmx_uart_brr;
+
+        frame_state = DMX_FRAME_DATA;
+
+        /*
+         * Begin transmission of frame data without any DMA interrupts,
+         * as the transmit complete interrupt marks the end of the frame.
+         */
+        __HAL_DMA_DISABLE_IT(huart6.hdmatx, DMA_IT_TC | DMA_IT_HT | DMA_IT_TE | DMA_IT_DME);
+        if (HAL_DMA_Start(huart6.hdmatx, (uint32_t)dmx_tx_data,
+            (uint32_t)&huart6.Instance->DR, dmx_buffer_length[dmx_tx_index]) != HAL_OK) {
+            /*
+             * The line is left idling high after the BREAK, so skip this
+             * frame and let the task send the next one on schedule.
+             * The transmit complete interrupt has already been disabled.
+             */
+            frame_state = DMX_FRAME_MARK_BEFORE_BREAK;
+            dmx_frame_start_errors++;
+            osSemaphoreRelease(dmx_frame_semaphore);
+            return;
+        }
+        __HAL_UART_CLEAR_FLAG(&huart6, UART_FLAG_TC);
+        SET_BIT(huart6.Instance->CR3, USART_CR3_DMAT);
+        __HAL_UART_ENABLE_IT(&huart6, UART_IT_TC);
+
+        /* Measure the time from publishing the frame to it going out on the wire */
+        dmx_frame_latency_record();
+
+    } else if (frame_state == DMX_FRAME_DATA && dmx_rdm_active) {
         /* Set TX state to high */
         HAL_GPIO_WritePin(DMX512_TX_GPIO_Port, DMX512_TX_Pin, GPIO_PIN_SET);
 
         /* Reconfigure TX pin as GPIO */
-        GPIO_InitTypeDef GPIO_InitStruct = {0};
-        GPIO_InitStruct.Pin = DMX512_TX_Pin;
-        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-        GPIO_InitStruct.Pull = GPIO_NOPULL;
-        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-        HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+        dmx_tx_pin_init(false);
+
+        if (dmx_rdm_active->response) {
+            /* Disable TX output, turning the line around for the response */
+            HAL_GPIO_WritePin(DMX512_TX_EN_GPIO_Port, DMX512_TX_EN_Pin, GPIO_PIN_RESET);
+
+            /* Reconfigure RX pin as UART */
+            GPIO_InitTypeDef GPIO_InitStruct = {0};
+            GPIO_InitStruct.Pin = DMX512_RX_Pin;
+            GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+            GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
+            HAL_GPIO_Init(DMX512_RX_GPIO_Port, &GPIO_InitStruct);
+
+            /* Enable RX input */
+            HAL_GPIO_WritePin(DMX512_RX_EN_GPIO_Port, DMX512_RX_EN_Pin, GPIO_PIN_RESET);
+
+            /* Begin UART reception of the response, discarding anything stale */
+            __HAL_UART_CLEAR_OREFLAG(&huart6);
+            HAL_UART_Receive_IT(&huart6, dmx_rdm_active->response, (uint16_t)dmx_rdm_active->response_size);
+
+            frame_state = DMX_FRAME_RDM_RESPONSE;
+        } else {
+            frame_state = DMX_FRAME_MARK_BEFORE_BREAK;
+        }
+
+        osSemaphoreRelease(dmx_frame_semaphore);
+
+    } else if (frame_state == DMX_FRAME_DATA && dmx_frame_uart_break) {
+        /* Release the DMA stream, leaving the TX pin as UART and idling high */
+        CLEAR_BIT(huart6.Instance->CR3, USART_CR3_DMAT);
+        HAL_DMA_PollForTransfer(huart6.hdmatx, HAL_DMA_FULL_TRANSFER, 0);
+
+        frame_state = DMX_FRAME_MARK_BEFORE_BREAK;
+
+        dmx_sent_sequence = dmx_buffer_sequence[dmx_tx_index];
+        if (dmx_frame_waiters > 0) {
+            osSemaphoreRelease(dmx_frame_sent_semaphore);
+        }
+
+        osSemaphoreRelease(dmx_frame_semaphore);
+
+    } else if (frame_state == DMX_FRAME_DATA) {
+        /* Set TX state to high */
+        HAL_GPIO_WritePin(DMX512_TX_GPIO_Port, DMX512_TX_Pin, GPIO_PIN_SET);
+
+        /* Reconfigure TX pin as GPIO */
+        dmx_tx_pin_init(false);
 
         frame_state = DMX_FRAME_MARK_BEFORE_BREAK;
 
+        dmx_sent_sequence = dmx_buffer_sequence[dmx_tx_index];
+        if (dmx_frame_waiters > 0) {
+            osSemaphoreRelease(dmx_frame_sent_semaphore);
+        }
+
         osSemaphoreRelease(dmx_frame_semaphore);
     }
 }
+
+void dmx_ramp_process_commands()
+{
+    const uint8_t *buf = dmx_frame_buffers[dmx_tx_index];
+    const uint32_t ticks = osKernelGetTickCount();
+    uint8_t tail = dmx_ramp_queue_tail;
+
+    while (tail != __atomic_load_n(&dmx_ramp_queue_head, __ATOMIC_ACQUIRE)) {
+        const dmx_ramp_command_t *command = &dmx_ramp_queue[tail];
+
+        if (command->count == 0) {
+            memset(dmx_ramps, 0, sizeof(dmx_ramps));
+        }
+
+        for (uint8_t i = 0; i < command->count; i++) {
+            dmx_ramp_t *ramp = NULL;
+            dmx_ramp_t *free_ramp = NULL;
+            for (uint8_t j = 0; j < DMX_RAMP_MAX_CHANNELS; j++) {
+                if (dmx_ramps[j].slot == command->slots[i]) {
+                    ramp = &dmx_ramps[j];
+                    break;
+                } else if (!free_ramp && dmx_ramps[j].slot == 0) {
+                    free_ramp = &dmx_ramps[j];
+                }
+            }
+
+            /* Fade from whatever value is currently on the wire */
+            uint16_t current;
+            if (ramp) {
+                current = dmx_ramp_value(ramp, ticks);
+            } else if (command->wide_mode) {
+                current = conv_array_u16(buf + command->slots[i]);
+            } else {
+                current = buf[command->slots[i]];
+            }
+
+            if (!ramp) { ramp = free_ramp; }
+            if (!ramp) { continue; }
+
+            if (command->duration_ms == 0 || current == command->targets[i]) {
+                ramp->slot = 0;
+                continue;
+            }
+
+            ramp->slot = command->slots[i];
+            ramp->wide_mode = command->wide_mode;
+            ramp->curve = command->curve;
+            ramp->start = current;
+            ramp->target = command->targets[i];
+            ramp->duration_ms = command->duration_ms;
+            ramp->start_ticks = ticks;
+        }
+
+        tail = (tail + 1) % DMX_RAMP_QUEUE_SIZE;
+        __atomic_store_n(&dmx_ramp_queue_tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+const uint8_t *dmx_ramp_apply()
+{
+    const uint8_t *frame = dmx_frame_buffers[dmx_tx_index];
+    const uint32_t ticks = osKernelGetTickCount();
+    bool copied = false;
+
+    for (uint8_t i = 0; i < DMX_RAMP_MAX_CHANNELS; i++) {
+        dmx_ramp_t *ramp = &dmx_ramps[i];
+        if (ramp->slot == 0) { continue; }
+
+        /* Leave the transmit buffer as published, and send a copy instead */
+        if (!copied) {
+            memcpy(dmx_ramp_frame, frame, dmx_buffer_length[dmx_tx_index]);
+            copied = true;
+        }
+
+        const uint16_t value = dmx_ramp_value(ramp, ticks);
+        if (ramp->wide_mode) {
+            conv_u16_array(dmx_ramp_frame + ramp->slot, value);
+        } else {
+            dmx_ramp_frame[ramp->slot] = (uint8_t)value;
+        }
+
+        /* Once the target is reached, the published frame takes over */
+        if (ticks - ramp->start_ticks >= ramp->duration_ms) {
+            ramp->slot = 0;
+        }
+    }
+
+    return copied ? dmx_ramp_frame : frame;
+}
+
+uint16_t dmx_ramp_value(const dmx_ramp_t *ramp, uint32_t ticks)
+{
+    const uint32_t elapsed = ticks - ramp->start_ticks;
+    if (elapsed >= ramp->duration_ms) {
+        return ramp->target;
+    }
+
+    /* Fade progress, in Q16 */
+    uint32_t progress = (elapsed << 16) / ramp->duration_ms;
+
+    if (ramp->curve == DMX_RAMP_CURVE_GAMMA) {
+        /*
+         * Rising fades follow the curve directly, and falling fades follow
+         * it mirrored in time, so both have the same light-equivalent time.
+         */
+        const bool rising = ramp->target > ramp->start;
+        const uint32_t x = rising ? progress : (65536U - progress);
+        const uint32_t index = x >> 12;
+        const uint32_t frac = x & 0x0FFFU;
+        uint32_t y = dmx_ramp_gamma_table[index];
+        if (index < 16) {
+            y += ((dmx_ramp_gamma_table[index + 1] - y) * frac) >> 12;
+        }
+        progress = rising ? y : (65536U - y);
+    }
+
+    const int32_t delta = (int32_t)ramp->target - (int32_t)ramp->start;
+    return (uint16_t)((int32_t)ramp->start + (int32_t)(((int64_t)delta * progress) >> 16));
+}
@@ -11,6 +11,43 @@ typedef enum : uint8_t {
     DMX_PORT_ENABLED_TRANSMITTING,/*!< Port is enabled and sending DMX frames */
 } dmx_port_state_t;
 
+typedef enum : uint8_t {
+    DMX_RAMP_CURVE_LINEAR = 0, /*!< Fade at a constant rate */
+    DMX_RAMP_CURVE_GAMMA       /*!< Fade along a gamma 2.2 curve */
+} dmx_ramp_curve_t;
+
+/**
+ * Number of recent frame periods kept for diagnostics.
+ */
+#define DMX_FRAME_HISTORY_SIZE 16
+
+typedef struct {
+    uint32_t count;           /*!< Number of BREAK to BREAK periods measured */
+    uint32_t min_period_us;   /*!< Shortest BREAK to BREAK period */
+    uint32_t max_period_us;   /*!< Longest BREAK to BREAK period */
+    uint64_t total_period_us; /*!< Sum of all periods, for averaging */
+    uint32_t late;            /*!< Frames started after their scheduled time */
+    uint32_t max_send_us;     /*!< Longest time spent starting a frame */
+    uint64_t total_send_us;   /*!< Time spent starting frames */
+    uint64_t total_busy_us;   /*!< Time spent waiting for frames to go out on the wire */
+    uint64_t total_idle_us;   /*!< Time spent waiting for the next frame period */
+    uint32_t sent;            /*!< Number of frames sent */
+    uint32_t total_isr;       /*!< Interrupts taken to send those frames */
+    uint32_t max_isr;         /*!< Most interrupts taken to send a single frame */
+    uint64_t total_isr_cycles;/*!< CPU cycles spent in those interrupts */
+    uint32_t max_isr_cycles;  /*!< Most CPU cycles spent in interrupts for a single frame */
+    uint32_t history_us[DMX_FRAME_HISTORY_SIZE]; /*!< Most recent periods, oldest first */
+} dmx_frame_stats_t;
+
+typedef struct {
+    uint32_t count;      /*!< Number of published frames that reached the wire */
+    uint32_t last_us;    /*!< Publish-to-wire latency of the most recent frame */
+    uint32_t max_us;     /*!< Longest publish-to-wire latency */
+    uint64_t total_us;   /*!< Sum of all latencies, for averaging */
+    uint32_t late;       /*!< Frames that took longer than one frame period to reach the wire */
+    uint32_t superseded; /*!< Frames replaced by a newer update before being sent */
+} dmx_latency_stats_t;
+
 /**
  * Initialize the DMX controller port and task
  */
@@ -39,6 +76,9 @@ osStatus_t dmx_disable();
  * Start sending data frames out the DMX control port.
  *
  * This will begin the process of sending frames at a regular interval.
+ * Frames only extend a few slots past the highest slot that has been set
+ * since the frame was last cleared, and shorter frames are sent at
+ * a correspondingly shorter interval.
  *
  * This function will block until it has taken effect.
  */
@@ -69,6 +109,10 @@ osStatus_t dmx_pause();
  * The underlying frame is up to 512 bytes long, so this function provides
  * an interface for altering a subset of that frame.
  *
+ * Updates are published without locking, and are picked up by the
+ * transmitter at the start of the next frame. Frame updates should
+ * only be made from one context at a time.
+ *
  * @param offset Position within the frame to update.
  * @param frame Data within the frame to update
  * @param len Length of the data to be updated
@@ -89,6 +133,35 @@ osStatus_t dmx_set_frame(uint16_t offset, const uint8_t *frame, size_t len, bool
  */
 osStatus_t dmx_set_sparse_frame(const uint16_t *channels, const uint8_t *values, size_t len, bool blocking);
 
+/**
+ * Fade channels in the current DMX data frame to new values.
+ *
+ * Each channel fades from the value currently being sent to its new
+ * value over the requested duration, with intermediate values computed
+ * for every frame sent along the way. Calling this again for a channel
+ * that is still fading starts a new fade from wherever that channel
+ * has reached. A duration of zero sets the channels immediately.
+ *
+ * Channels that are being faded should only be updated through this
+ * function, as other updates to them will be hidden until the fade
+ * finishes. Clearing the frame cancels all fades.
+ *
+ * Fade requests are queued for the frame sender, which takes them as
+ * each frame goes out. If the queue is full, a blocking call waits for
+ * room, while a non-blocking call leaves the frame unchanged and returns
+ * osErrorResource, so the caller can try again.
+ *
+ * @param channels Array of channels to update, with 16-bit channels given by their first slot
+ * @param values Corresponding array of values to fade to
+ * @param len Length of both arrays, up to 8 channels
+ * @param wide_mode True if the channels are 16-bit, false if 8-bit
+ * @param duration_ms Time to fade over
+ * @param curve Shape of the fade
+ * @param blocking True to block until the update takes effect, false to return immediately.
+ */
+osStatus_t dmx_set_ramp_frame(const uint16_t *channels, const uint16_t *values, size_t len,
+    bool wide_mode, uint16_t duration_ms, dmx_ramp_curve_t curve, bool blocking);
+
 /**
  * Clear the current DMX frame.
  *
@@ -99,12 +172,50 @@ osStatus_t dmx_set_sparse_frame(const uint16_t *channels, const uint8_t *values,
  */
 osStatus_t dmx_clear_frame(bool blocking);
 
+/**
+ * Get the frame timing statistics for automatically sent frames.
+ *
+ * These cover the regular frame cadence of the DMX task, and do not
+ * include frames sent via 'dmx_send_frame_explicit()'.
+ */
+void dmx_get_frame_stats(dmx_frame_stats_t *stats);
+
+/**
+ * Reset the frame timing statistics.
+ */
+void dmx_reset_frame_stats();
+
+/**
+ * Select how the BREAK and Mark-After-Break are generated for regular frames.
+ *
+ * By default, these are generated by the UART itself, by sending a zero
+ * byte at a lower baud rate. Otherwise, they are timed with TIM4
+ * while switching the TX pin between GPIO and UART, which takes
+ * more interrupts per frame. RDM requests always use the latter.
+ *
+ * This takes effect from the next frame sent.
+ */
+void dmx_set_uart_break(bool enabled);
+
+bool dmx_is_uart_break();
+
+/**
+ * Get the publish-to-wire latency statistics for frame updates.
+ */
+void dmx_get_latency_stats(dmx_latency_stats_t *stats);
+
+/**
+ * Reset the frame update latency statistics.
+ */
+void dmx_reset_latency_stats();
+
 /**
  * Enable the direct updating of the active frame.
  *
- * This function enables the circumvention of any task synchronization,
- * and should only be used when in the IDLE state and intending to
- * explicitly send frames via the 'dmx_send_frame_from_isr()' function.
+ * This function makes frame updates safe to call from an ISR, by never
+ * waiting for them to be sent, and should only be used when in the IDLE
+ * state and intending to explicitly send frames via the
+ * 'dmx_send_frame_explicit()' function.
  *
  * A call to any function that changes the port state will disable
  * this feature.
@@ -115,10 +226,45 @@ void dmx_enable_direct_frame_update();
  * Explicitly send the next DMX frame.
  *
  * This function is intended for use when the timing of frame sending
- * is being controlled externally.
- * It may fail silently if called more frequently than the frame period.
+ * is being controlled externally. The most recently published frame
+ * contents are picked up at the moment this function is called.
+ *
+ * @return True if the frame was started, false if the previous frame
+ *         is still being sent.
  */
-void dmx_send_frame_explicit();
+bool dmx_send_frame_explicit();
+
+/**
+ * Get the time it takes to send the most recently published frame,
+ * rounded up to whole milliseconds.
+ *
+ * This is intended for external frame scheduling, so that frames are
+ * not started when they would still be on the wire at a moment where
+ * the line needs to be free.
+ */
+uint32_t dmx_get_frame_duration_ms();
+
+/**
+ * Perform an RDM transaction on the DMX control port.
+ *
+ * The request is sent in the gap that follows a regular frame, if frames
+ * are being sent, and the line is then turned around to collect
+ * the response. The port must be enabled for this to work.
+ *
+ * The response is collected until the line goes quiet, and is returned
+ * as received. If it was preceded by a BREAK, that will show up
+ * as a leading null byte.
+ *
+ * This function will block until the transaction is complete.
+ *
+ * @param request Complete request packet, starting with its start code
+ * @param request_len Length of the request packet
+ * @param response Buffer for the response, or NULL if none is expected
+ * @param response_size Size of the response buffer
+ * @param response_len Number of response bytes received
+ */
+osStatus_t dmx_rdm_transaction(const uint8_t *request, size_t request_len,
+    uint8_t *response, size_t response_size, size_t *response_len);
 
 /**
  * Call this function from the timer ISR
@@ -130,4 +276,10 @@ void dmx_timer_notify();
  */
 void dmx_uart_tx_cplt();
 
+/**
+ * Call this function at the end of each interrupt handler for the
+ * peripherals used by the DMX port, with the CPU cycles spent in it.
+ */
+void dmx_isr_record(uint32_t cycles);
+
 #endif /* DMX_H */
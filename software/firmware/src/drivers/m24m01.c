@@ -1,6 +1,7 @@
 #include "m24m01.h"
 
 #include <strings.h>
+#include <cmsis_os.h>
 
 #define LOG_TAG "m24m01"
 #include <elog.h>
@@ -13,6 +14,18 @@ static constexpr uint8_t M24M01_ADDRESS = 0x50 << 1;
 #define DEVICE_ADDRESS(x) (M24M01_ADDRESS | (uint8_t)((x & 0x10000) >> 15))
 #define MEMORY_ADDRESS(x) ((uint16_t)(x & 0xFFFF))
 
+/*
+ * The datasheet specifies a maximum write cycle time of 5ms, so give
+ * up on polling for completion well after that.
+ */
+#define WRITE_CYCLE_TIMEOUT_MS 20U
+
+/* Set from the end of a write until the device acknowledges again */
+static bool write_cycle_pending = false;
+static uint32_t write_cycle_start = 0;
+
+static HAL_StatusTypeDef m24m01_wait_ready(I2C_HandleTypeDef *hi2c);
+
 HAL_StatusTypeDef m24m01_read_byte(I2C_HandleTypeDef *hi2c, uint32_t address, uint8_t *data)
 {
     HAL_StatusTypeDef ret = HAL_OK;
@@ -27,6 +40,8 @@ HAL_StatusTypeDef m24m01_read_byte(I2C_HandleTypeDef *hi2c, uint32_t address, ui
     uint8_t device_addr = DEVICE_ADDRESS(address);
     uint16_t mem_addr = MEMORY_ADDRESS(address);
 
+    m24m01_wait_ready(hi2c);
+
     ret = HAL_I2C_Mem_Read(hi2c, device_addr, mem_addr, I2C_MEMADD_SIZE_16BIT, data, 1, HAL_MAX_DELAY);
     if (ret != HAL_OK) {
         log_e("HAL_I2C_Mem_Read error: %d", ret);
@@ -49,6 +64,8 @@ HAL_StatusTypeDef m24m01_read_buffer(I2C_HandleTypeDef *hi2c, uint32_t address,
     uint8_t device_addr = DEVICE_ADDRESS(address);
     uint16_t mem_addr = MEMORY_ADDRESS(address);
 
+    m24m01_wait_ready(hi2c);
+
     ret = HAL_I2C_Mem_Read(hi2c, device_addr, mem_addr, I2C_MEMADD_SIZE_16BIT, data, data_len, HAL_MAX_DELAY);
     if (ret != HAL_OK) {
         log_e("HAL_I2C_Mem_Read error: %d", ret);
@@ -71,12 +88,16 @@ HAL_StatusTypeDef m24m01_write_byte(I2C_HandleTypeDef *hi2c, uint32_t address, u
     uint8_t device_addr = DEVICE_ADDRESS(address);
     uint16_t mem_addr = MEMORY_ADDRESS(address);
 
+    m24m01_wait_ready(hi2c);
+
     ret = HAL_I2C_Mem_Write(hi2c, device_addr, mem_addr, I2C_MEMADD_SIZE_16BIT, &data, 1, HAL_MAX_DELAY);
     if (ret != HAL_OK) {
         log_e("HAL_I2C_Mem_Write error: %d", ret);
     }
 
-    while(HAL_I2C_IsDeviceReady(hi2c, device_addr, 1, HAL_MAX_DELAY) != HAL_OK) {}
+    write_cycle_pending = true;
+    write_cycle_start = HAL_GetTick();
+    m24m01_wait_ready(hi2c);
 
     return ret;
 }
@@ -110,6 +131,15 @@ HAL_StatusTypeDef m24m01_write_buffer(I2C_HandleTypeDef *hi2c, uint32_t address,
 }
 
 HAL_StatusTypeDef m24m01_write_page(I2C_HandleTypeDef *hi2c, uint32_t address, const uint8_t *data, size_t data_len)
+{
+    HAL_StatusTypeDef ret = m24m01_write_page_start(hi2c, address, data, data_len);
+    if (ret == HAL_OK) {
+        ret = m24m01_wait_ready(hi2c);
+    }
+    return ret;
+}
+
+HAL_StatusTypeDef m24m01_write_page_start(I2C_HandleTypeDef *hi2c, uint32_t address, const uint8_t *data, size_t data_len)
 {
     HAL_StatusTypeDef ret = HAL_OK;
 
@@ -135,13 +165,60 @@ HAL_StatusTypeDef m24m01_write_page(I2C_HandleTypeDef *hi2c, uint32_t address, c
         return HAL_ERROR;
     }
 
+    m24m01_wait_ready(hi2c);
+
     ret = HAL_I2C_Mem_Write(hi2c, device_addr, mem_addr, I2C_MEMADD_SIZE_16BIT,
         (uint8_t *)data, data_len, HAL_MAX_DELAY);
     if (ret != HAL_OK) {
         log_e("HAL_I2C_Mem_Write error: %d", ret);
     }
 
-    while(HAL_I2C_IsDeviceReady(hi2c, device_addr, 1, HAL_MAX_DELAY) != HAL_OK) {}
+    /* Even a failed write may have started a write cycle */
+    write_cycle_pending = true;
+    write_cycle_start = HAL_GetTick();
 
     return ret;
 }
+
+bool m24m01_is_busy(I2C_HandleTypeDef *hi2c)
+{
+    if (!write_cycle_pending) {
+        return false;
+    }
+
+    /* The device does not acknowledge its address until the write cycle is complete */
+    if (HAL_I2C_IsDeviceReady(hi2c, M24M01_ADDRESS, 1, 2) == HAL_OK) {
+        write_cycle_pending = false;
+        return false;
+    }
+
+    if (HAL_GetTick() - write_cycle_start > WRITE_CYCLE_TIMEOUT_MS) {
+        log_e("Timeout waiting for write cycle");
+        write_cycle_pending = false;
+        return false;
+    }
+
+    return true;
+}
+
+HAL_StatusTypeDef m24m01_wait_ready(I2C_HandleTypeDef *hi2c)
+{
+    while (write_cycle_pending) {
+        if (HAL_I2C_IsDeviceReady(hi2c, M24M01_ADDRESS, 1, 2) == HAL_OK) {
+            write_cycle_pending = false;
+            break;
+        }
+
+        if (HAL_GetTick() - write_cycle_start > WRITE_CYCLE_TIMEOUT_MS) {
+            log_e("Timeout waiting for write cycle");
+            write_cycle_pending = false;
+            return HAL_TIMEOUT;
+        }
+
+        /* Let other tasks run while the write cycle completes */
+        if (osKernelGetState() == osKernelRunning) {
+            osDelay(1);
+        }
+    }
+    return HAL_OK;
+}
@@ -5,6 +5,7 @@
 #ifndef M24M01_H
 #define M24M01_H
 
+#include <stdbool.h>
 #include <stm32f4xx_hal.h>
 
 /**
@@ -67,4 +68,30 @@ HAL_StatusTypeDef m24m01_write_buffer(I2C_HandleTypeDef *hi2c, uint32_t address,
  */
 HAL_StatusTypeDef m24m01_write_page(I2C_HandleTypeDef *hi2c, uint32_t address, const uint8_t *data, size_t data_len);
 
+/**
+ * Start writing a sequence of bytes within a memory page.
+ *
+ * This has the same constraints as m24m01_write_page(), but returns as
+ * soon as the data has been transferred rather than waiting for the
+ * device to finish its internal write cycle. The caller may release the
+ * bus during this time, and use m24m01_is_busy() to poll for completion.
+ * Any other operation on the device will wait for the cycle to finish.
+ *
+ * @param hi2c Pointer to a handle for the I2C peripheral
+ * @param address Address to write from
+ * @param data Pointer to the buffer to write the data from
+ * @param data_len Size of the data to be written
+ */
+HAL_StatusTypeDef m24m01_write_page_start(I2C_HandleTypeDef *hi2c, uint32_t address, const uint8_t *data, size_t data_len);
+
+/**
+ * Check whether the device is still busy with an internal write cycle.
+ *
+ * This performs at most a single short address poll on the bus.
+ *
+ * @param hi2c Pointer to a handle for the I2C peripheral
+ * @return True if a write cycle is still in progress
+ */
+bool m24m01_is_busy(I2C_HandleTypeDef *hi2c);
+
 #endif /* M24M01_H */
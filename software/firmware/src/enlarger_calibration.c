@@ -151,6 +151,11 @@ calibration_result_t enlarger_calibration_start(enlarger_config_t *config)
 
     meter_probe_handle_t *handle = meter_probe_handle();
 
+    /* Profile the light source itself, since fades are accounted for separately */
+    enlarger_control_t control;
+    memcpy(&control, &config->control, sizeof(enlarger_control_t));
+    control.ramp_time = 0;
+
     display_static_list(DISPLAY_TITLE, "\n\nInitializing...");
 
     /* Turn everything off, just in case it isn't already off */
@@ -173,7 +178,7 @@ calibration_result_t enlarger_calibration_start(enlarger_config_t *config)
     reading_stats_t enlarger_on_stats;
     reading_stats_t enlarger_off_stats;
     reading_stats_t sensor_stats;
-    calibration_result = calibration_collect_reference_stats(&config->control,
+    calibration_result = calibration_collect_reference_stats(&control,
         &enlarger_on_stats, &enlarger_off_stats, &sensor_stats);
     if (calibration_result != CALIBRATION_OK) {
         log_e("Could not collect reference stats");
@@ -226,7 +231,7 @@ calibration_result_t enlarger_calibration_start(enlarger_config_t *config)
         sprintf(buf, "\nProfiling enlarger...\n\nCycle %d of %d", i + 1, PROFILE_ITERATIONS);
         display_static_list(DISPLAY_TITLE, buf);
 
-        calibration_result = calibration_build_timing_profile(&config->control,
+        calibration_result = calibration_build_timing_profile(&control,
             &timing_profile_inc,
             &enlarger_on_stats, &enlarger_off_stats, &sensor_stats);
         if (calibration_result != CALIBRATION_OK) {
@@ -37,6 +37,12 @@ bool enlarger_config_is_valid(const enlarger_config_t *config)
         return false;
     }
 
+    /* Fades are limited to a few seconds, and must have a known curve */
+    if (config->control.ramp_time > ENLARGER_RAMP_TIME_MAX
+        || config->control.ramp_curve > ENLARGER_RAMP_CURVE_GAMMA) {
+        return false;
+    }
+
     return true;
 }
 
@@ -79,7 +85,9 @@ bool enlarger_config_compare(const enlarger_config_t *config1, const enlarger_co
         || control1->dmx_channel_white != control2->dmx_channel_white
         || control1->contrast_mode != control2->contrast_mode
         || control1->focus_value != control2->focus_value
-        || control1->safe_value != control2->safe_value) {
+        || control1->safe_value != control2->safe_value
+        || control1->ramp_time != control2->ramp_time
+        || control1->ramp_curve != control2->ramp_curve) {
         return false;
     }
     for (size_t i = 0; i < CONTRAST_WHOLE_GRADE_COUNT; i++) {
@@ -236,7 +244,24 @@ uint32_t enlarger_config_min_exposure(const enlarger_config_t *config)
 {
     if (!config) { return 0; }
 
-    return config->timing.rise_time_equiv + config->timing.fall_time_equiv + config->timing.turn_off_delay;
+    return config->timing.rise_time_equiv + config->timing.fall_time_equiv + config->timing.turn_off_delay
+        + (enlarger_config_ramp_time_equiv(config) * 2);
+}
+
+uint32_t enlarger_config_ramp_time_equiv(const enlarger_config_t *config)
+{
+    if (!config || !config->control.dmx_control) { return 0; }
+
+    /*
+     * The area under each of the fade curves supported by the DMX
+     * controller, as a fraction of the fade time.
+     * Linear is 1/2, and a gamma of 2.2 is 1/3.2.
+     */
+    if (config->control.ramp_curve == ENLARGER_RAMP_CURVE_GAMMA) {
+        return (config->control.ramp_time * 5U) / 16U;
+    } else {
+        return config->control.ramp_time / 2U;
+    }
 }
 
 bool enlarger_config_has_rgb(const enlarger_config_t *config)
@@ -17,6 +17,16 @@ typedef enum : uint8_t {
     ENLARGER_CHANNEL_SET_RGBW       /*!< Four channels for RGBW */
 } enlarger_channel_set_t;
 
+/**
+ * Longest supported fade time between enlarger light levels.
+ */
+#define ENLARGER_RAMP_TIME_MAX 5000
+
+typedef enum : uint8_t {
+    ENLARGER_RAMP_CURVE_LINEAR = 0, /*!< Fade between light levels at a constant rate */
+    ENLARGER_RAMP_CURVE_GAMMA       /*!< Fade between light levels along a gamma curve */
+} enlarger_ramp_curve_t;
+
 typedef enum : uint8_t {
     ENLARGER_CONTRAST_MODE_WHITE = 0, /*!< Always emit white light and expect external contrast filters */
     ENLARGER_CONTRAST_MODE_GREEN_BLUE /*!< Use configured per-grade Green+Blue combinations */
@@ -57,6 +67,8 @@ typedef struct {
     uint16_t focus_value;       /*!< White light intensity to emit when in focus mode */
     uint16_t safe_value;        /*!< Red light intensity to emit when pausing mid-exposure sequence */
     enlarger_grade_values_t grade_values[CONTRAST_GRADE_MAX]; /*!< Per-grade light intensity settings */
+    uint16_t ramp_time;         /*!< Time (ms) to fade between light levels, or 0 to switch immediately */
+    enlarger_ramp_curve_t ramp_curve; /*!< Shape of the fade between light levels */
 } enlarger_control_t;
 
 /**
@@ -158,6 +170,15 @@ void enlarger_config_recalculate(enlarger_config_t *config);
  */
 uint32_t enlarger_config_min_exposure(const enlarger_config_t *config);
 
+/**
+ * Get the time period (ms) at full output that is equivalent to the
+ * output across a single fade between off and full brightness.
+ *
+ * The remainder of the fade time is accounted for in the same way as the
+ * difference between the rise/fall time and its equivalent.
+ */
+uint32_t enlarger_config_ramp_time_equiv(const enlarger_config_t *config);
+
 /**
  * Gets whether the enlarger has the necessary capabilities for RGB printing.
  */
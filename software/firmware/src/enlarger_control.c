@@ -1,5 +1,7 @@
 #include "enlarger_control.h"
 
+#include <string.h>
+
 #define LOG_TAG "enlarger_control"
 #include <elog.h>
 
@@ -13,9 +15,26 @@ static osStatus_t enlarger_control_set_state_dmx(const enlarger_control_t *enlar
     enlarger_control_state_t state, contrast_grade_t grade,
     uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
     bool blocking);
+static osStatus_t enlarger_control_state_values(const enlarger_control_t *enlarger_control,
+    enlarger_control_state_t state, contrast_grade_t grade,
+    uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
+    uint16_t *red, uint16_t *green, uint16_t *blue, uint16_t *white);
 static osStatus_t enlarger_control_set_frame(const enlarger_control_t *enlarger_control,
     uint16_t red, uint16_t green, uint16_t blue, uint16_t white,
     bool blocking);
+static size_t enlarger_control_build_frame(const enlarger_control_t *enlarger_control,
+    uint16_t red, uint16_t green, uint16_t blue, uint16_t white,
+    uint16_t *channels, uint8_t *values);
+static const enlarger_control_frame_t *enlarger_control_prepared_frame(const enlarger_control_frames_t *frames,
+    enlarger_control_state_t state, contrast_grade_t grade);
+static osStatus_t enlarger_control_set_ramp_frame(const enlarger_control_t *enlarger_control,
+    uint16_t red, uint16_t green, uint16_t blue, uint16_t white,
+    bool blocking);
+#ifdef DEBUG
+static bool enlarger_control_check_frame(const enlarger_control_frames_t *frames,
+    enlarger_control_state_t state, contrast_grade_t grade,
+    uint16_t red, uint16_t green, uint16_t blue, uint16_t white);
+#endif
 
 osStatus_t enlarger_control_set_state(const enlarger_control_t *enlarger_control,
     enlarger_control_state_t state, contrast_grade_t grade,
@@ -47,6 +66,291 @@ osStatus_t enlarger_control_set_state_safe(const enlarger_control_t *enlarger_co
     return enlarger_control_set_state(enlarger_control, ENLARGER_CONTROL_STATE_SAFE, CONTRAST_GRADE_MAX, 0, 0, 0, blocking);
 }
 
+void enlarger_control_prepare_frames(enlarger_control_frames_t *frames, const enlarger_control_t *enlarger_control)
+{
+    if (!frames) { return; }
+
+    memset(frames, 0, sizeof(enlarger_control_frames_t));
+    if (enlarger_control) {
+        memcpy(&frames->control, enlarger_control, sizeof(enlarger_control_t));
+    }
+
+    /* Fades are computed per-frame by the DMX task, so there is nothing to prepare */
+    if (!frames->control.dmx_control || frames->control.ramp_time > 0) {
+        return;
+    }
+
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint16_t white;
+
+    /* The slots touched are the same for every state, so only the values vary */
+    frames->len = enlarger_control_build_frame(&frames->control, 0, 0, 0, 0,
+        frames->channels, frames->off.values);
+
+    enlarger_control_state_values(&frames->control, ENLARGER_CONTROL_STATE_FOCUS, CONTRAST_GRADE_MAX,
+        0, 0, 0, &red, &green, &blue, &white);
+    enlarger_control_build_frame(&frames->control, red, green, blue, white,
+        frames->channels, frames->focus.values);
+
+    enlarger_control_state_values(&frames->control, ENLARGER_CONTROL_STATE_SAFE, CONTRAST_GRADE_MAX,
+        0, 0, 0, &red, &green, &blue, &white);
+    enlarger_control_build_frame(&frames->control, red, green, blue, white,
+        frames->channels, frames->safe.values);
+
+    for (contrast_grade_t grade = CONTRAST_GRADE_00; grade < CONTRAST_GRADE_MAX; grade++) {
+        enlarger_control_state_values(&frames->control, ENLARGER_CONTROL_STATE_EXPOSURE, grade,
+            0, 0, 0, &red, &green, &blue, &white);
+        enlarger_control_build_frame(&frames->control, red, green, blue, white,
+            frames->channels, frames->grades[grade].values);
+    }
+
+    frames->prepared = true;
+}
+
+osStatus_t enlarger_control_set_prepared_state(const enlarger_control_frames_t *frames,
+    enlarger_control_state_t state, contrast_grade_t grade,
+    uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
+    bool blocking)
+{
+    return enlarger_control_set_prepared_heads(frames, &state, 1, grade,
+        channel_red, channel_green, channel_blue, blocking);
+}
+
+osStatus_t enlarger_control_set_prepared_heads(const enlarger_control_frames_t *frames,
+    const enlarger_control_state_t *states, size_t count, contrast_grade_t grade,
+    uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
+    bool blocking)
+{
+    uint16_t channels[ENLARGER_CONTROL_FRAME_SLOTS * ENLARGER_CONTROL_MAX_HEADS];
+    uint8_t values[ENLARGER_CONTROL_FRAME_SLOTS * ENLARGER_CONTROL_MAX_HEADS];
+    size_t len = 0;
+    bool prepared = true;
+
+    if (!frames || !states || count == 0 || count > ENLARGER_CONTROL_MAX_HEADS) {
+        return osErrorParameter;
+    }
+
+    /*
+     * Compose every head into a single update, so they all change in the
+     * same frame. Explicit channel values are not prepared, so those
+     * frames are built here instead.
+     */
+    for (size_t i = 0; i < count; i++) {
+        if (!frames[i].prepared) {
+            prepared = false;
+            break;
+        }
+
+        const enlarger_control_frame_t *frame = enlarger_control_prepared_frame(&frames[i], states[i], grade);
+        if (frame) {
+            memcpy(channels + len, frames[i].channels, frames[i].len * sizeof(uint16_t));
+            memcpy(values + len, frame->values, frames[i].len);
+            len += frames[i].len;
+        } else {
+            uint16_t red;
+            uint16_t green;
+            uint16_t blue;
+            uint16_t white;
+            uint16_t head_channels[ENLARGER_CONTROL_FRAME_SLOTS];
+            uint8_t head_values[ENLARGER_CONTROL_FRAME_SLOTS];
+
+            osStatus_t ret = enlarger_control_state_values(&frames[i].control, states[i], grade,
+                channel_red, channel_green, channel_blue, &red, &green, &blue, &white);
+            if (ret != osOK) { return ret; }
+
+            const size_t head_len = enlarger_control_build_frame(&frames[i].control, red, green, blue, white,
+                head_channels, head_values);
+            memcpy(channels + len, head_channels, head_len * sizeof(uint16_t));
+            memcpy(values + len, head_values, head_len);
+            len += head_len;
+        }
+    }
+
+    if (!prepared) {
+        /*
+         * Relay control and fades are only supported on a single head,
+         * as they cannot be composed into one update with another head.
+         */
+        if (count > 1) {
+            return osErrorParameter;
+        }
+        return enlarger_control_set_state(&frames[0].control, states[0], grade,
+            channel_red, channel_green, channel_blue, blocking);
+    }
+
+    return dmx_set_sparse_frame(channels, values, len, blocking);
+}
+
+osStatus_t enlarger_control_set_prepared_state_off(const enlarger_control_frames_t *frames, bool blocking)
+{
+    return enlarger_control_set_prepared_state(frames, ENLARGER_CONTROL_STATE_OFF, CONTRAST_GRADE_MAX, 0, 0, 0, blocking);
+}
+
+const enlarger_control_frame_t *enlarger_control_prepared_frame(const enlarger_control_frames_t *frames,
+    enlarger_control_state_t state, contrast_grade_t grade)
+{
+    if (!frames->prepared) { return NULL; }
+
+    switch (state) {
+    case ENLARGER_CONTROL_STATE_OFF:
+        return &frames->off;
+    case ENLARGER_CONTROL_STATE_FOCUS:
+        return &frames->focus;
+    case ENLARGER_CONTROL_STATE_SAFE:
+        return &frames->safe;
+    case ENLARGER_CONTROL_STATE_EXPOSURE:
+        /* Explicit channel values are only known at the time of the change */
+        if (grade >= CONTRAST_GRADE_MAX) { return NULL; }
+        return &frames->grades[grade];
+    default:
+        return NULL;
+    }
+}
+
+bool enlarger_control_heads_overlap(const enlarger_control_t *enlarger_control1, const enlarger_control_t *enlarger_control2)
+{
+    uint16_t channels1[ENLARGER_CONTROL_FRAME_SLOTS];
+    uint16_t channels2[ENLARGER_CONTROL_FRAME_SLOTS];
+    uint8_t values[ENLARGER_CONTROL_FRAME_SLOTS];
+
+    if (!enlarger_control1 || !enlarger_control2) { return false; }
+
+    const size_t len1 = enlarger_control_build_frame(enlarger_control1, 0, 0, 0, 0, channels1, values);
+    const size_t len2 = enlarger_control_build_frame(enlarger_control2, 0, 0, 0, 0, channels2, values);
+
+    for (size_t i = 0; i < len1; i++) {
+        for (size_t j = 0; j < len2; j++) {
+            if (channels1[i] == channels2[j]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+#ifdef DEBUG
+bool enlarger_control_check_prepared_frames()
+{
+    enlarger_control_frames_t frames;
+    enlarger_control_t control;
+    bool result = true;
+
+    /*
+     * Prepare frames for every channel set, slot width and contrast mode,
+     * and compare every state and grade against values worked out here
+     * directly from the configuration. The channels are deliberately out
+     * of order, and every value differs, so that mixed up slots show up.
+     */
+    for (enlarger_channel_set_t channel_set = ENLARGER_CHANNEL_SET_WHITE; channel_set <= ENLARGER_CHANNEL_SET_RGBW; channel_set++) {
+        const bool has_rgb = channel_set != ENLARGER_CHANNEL_SET_WHITE;
+        const bool has_white = channel_set != ENLARGER_CHANNEL_SET_RGB;
+
+        for (uint8_t wide = 0; wide < 2; wide++) {
+            for (enlarger_contrast_mode_t contrast_mode = ENLARGER_CONTRAST_MODE_WHITE; contrast_mode <= ENLARGER_CONTRAST_MODE_GREEN_BLUE; contrast_mode++) {
+                memset(&control, 0, sizeof(enlarger_control_t));
+                control.dmx_control = true;
+                control.channel_set = channel_set;
+                control.dmx_wide_mode = wide;
+                control.dmx_channel_red = 30;
+                control.dmx_channel_green = 20;
+                control.dmx_channel_blue = 40;
+                control.dmx_channel_white = 10;
+                control.contrast_mode = contrast_mode;
+                control.focus_value = wide ? 0xF0E1 : 0xF0;
+                control.safe_value = wide ? 0x5A3C : 0x5A;
+                for (contrast_grade_t grade = CONTRAST_GRADE_00; grade < CONTRAST_GRADE_MAX; grade++) {
+                    control.grade_values[grade].channel_red = wide ? (0x1080 + grade) : (0x10 + grade);
+                    control.grade_values[grade].channel_green = wide ? (0x2080 + grade) : (0x20 + grade);
+                    control.grade_values[grade].channel_blue = wide ? (0x3080 + grade) : (0x30 + grade);
+                    control.grade_values[grade].channel_white = wide ? (0x4080 + grade) : (0x40 + grade);
+                }
+                enlarger_control_prepare_frames(&frames, &control);
+
+                result &= enlarger_control_check_frame(&frames, ENLARGER_CONTROL_STATE_OFF, CONTRAST_GRADE_MAX,
+                    0, 0, 0, 0);
+
+                if (channel_set == ENLARGER_CHANNEL_SET_RGB) {
+                    result &= enlarger_control_check_frame(&frames, ENLARGER_CONTROL_STATE_FOCUS, CONTRAST_GRADE_MAX,
+                        control.focus_value, control.focus_value, control.focus_value, 0);
+                } else {
+                    result &= enlarger_control_check_frame(&frames, ENLARGER_CONTROL_STATE_FOCUS, CONTRAST_GRADE_MAX,
+                        0, 0, 0, control.focus_value);
+                }
+
+                result &= enlarger_control_check_frame(&frames, ENLARGER_CONTROL_STATE_SAFE, CONTRAST_GRADE_MAX,
+                    has_rgb ? control.safe_value : 0, 0, 0, 0);
+
+                for (contrast_grade_t grade = CONTRAST_GRADE_00; grade < CONTRAST_GRADE_MAX; grade++) {
+                    if (has_rgb && contrast_mode == ENLARGER_CONTRAST_MODE_GREEN_BLUE) {
+                        result &= enlarger_control_check_frame(&frames, ENLARGER_CONTROL_STATE_EXPOSURE, grade,
+                            0,
+                            control.grade_values[grade].channel_green,
+                            control.grade_values[grade].channel_blue,
+                            0);
+                    } else {
+                        const enlarger_grade_values_t *values = &control.grade_values[CONTRAST_GRADE_2];
+                        result &= enlarger_control_check_frame(&frames, ENLARGER_CONTROL_STATE_EXPOSURE, grade,
+                            has_rgb ? values->channel_red : 0,
+                            has_rgb ? values->channel_green : 0,
+                            has_rgb ? values->channel_blue : 0,
+                            has_white ? values->channel_white : 0);
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+bool enlarger_control_check_frame(const enlarger_control_frames_t *frames,
+    enlarger_control_state_t state, contrast_grade_t grade,
+    uint16_t red, uint16_t green, uint16_t blue, uint16_t white)
+{
+    const enlarger_control_t *control = &frames->control;
+    const bool has_rgb = control->channel_set != ENLARGER_CHANNEL_SET_WHITE;
+    const bool has_white = control->channel_set != ENLARGER_CHANNEL_SET_RGB;
+    const uint16_t colors[4][2] = {
+        { control->dmx_channel_red, red },
+        { control->dmx_channel_green, green },
+        { control->dmx_channel_blue, blue },
+        { control->dmx_channel_white, white }
+    };
+    uint16_t channels[ENLARGER_CONTROL_FRAME_SLOTS];
+    uint8_t values[ENLARGER_CONTROL_FRAME_SLOTS];
+    size_t len = 0;
+
+    /* Slots follow in red, green, blue, white order, with 16-bit values most significant byte first */
+    for (size_t i = 0; i < 4; i++) {
+        if ((i < 3 && !has_rgb) || (i == 3 && !has_white)) { continue; }
+        if (control->dmx_wide_mode) {
+            channels[len] = colors[i][0];
+            values[len++] = (uint8_t)(colors[i][1] >> 8);
+            channels[len] = colors[i][0] + 1;
+            values[len++] = (uint8_t)(colors[i][1] & 0xFF);
+        } else {
+            channels[len] = colors[i][0];
+            values[len++] = (uint8_t)colors[i][1];
+        }
+    }
+
+    const enlarger_control_frame_t *frame = enlarger_control_prepared_frame(frames, state, grade);
+
+    if (!frame || frames->len != len
+        || memcmp(frames->channels, channels, len * sizeof(uint16_t)) != 0
+        || memcmp(frame->values, values, len) != 0) {
+        log_w("Prepared frame mismatch: set=%d, wide=%d, mode=%d, state=%d, grade=%d",
+            control->channel_set, control->dmx_wide_mode, control->contrast_mode, state, grade);
+        return false;
+    }
+
+    return true;
+}
+#endif
+
 osStatus_t enlarger_control_set_state_relay(enlarger_control_state_t state)
 {
     bool enabled;
@@ -78,6 +382,26 @@ osStatus_t enlarger_control_set_state_dmx(const enlarger_control_t *enlarger_con
     enlarger_control_state_t state, contrast_grade_t grade,
     uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
     bool blocking)
+{
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint16_t white;
+
+    osStatus_t ret = enlarger_control_state_values(enlarger_control, state, grade,
+        channel_red, channel_green, channel_blue,
+        &red, &green, &blue, &white);
+    if (ret != osOK) {
+        return ret;
+    }
+
+    return enlarger_control_set_frame(enlarger_control, red, green, blue, white, blocking);
+}
+
+osStatus_t enlarger_control_state_values(const enlarger_control_t *enlarger_control,
+    enlarger_control_state_t state, contrast_grade_t grade,
+    uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
+    uint16_t *red, uint16_t *green, uint16_t *blue, uint16_t *white)
 {
     const bool has_rgb =
         enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGB
@@ -86,64 +410,76 @@ osStatus_t enlarger_control_set_state_dmx(const enlarger_control_t *enlarger_con
         enlarger_control->channel_set == ENLARGER_CHANNEL_SET_WHITE
         || enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGBW;
 
-    uint16_t red = 0;
-    uint16_t green = 0;
-    uint16_t blue = 0;
-    uint16_t white = 0;
-
-    if (state == ENLARGER_CONTROL_STATE_OFF) {
-        red = 0;
-        green = 0;
-        blue = 0;
-        white = 0;
-    } else if (state == ENLARGER_CONTROL_STATE_FOCUS) {
+    *red = 0;
+    *green = 0;
+    *blue = 0;
+    *white = 0;
+
+    if (state == ENLARGER_CONTROL_STATE_FOCUS) {
         if (enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGB) {
-            red = enlarger_control->focus_value;
-            green = enlarger_control->focus_value;
-            blue = enlarger_control->focus_value;
+            *red = enlarger_control->focus_value;
+            *green = enlarger_control->focus_value;
+            *blue = enlarger_control->focus_value;
         } else {
-            white = enlarger_control->focus_value;
+            *white = enlarger_control->focus_value;
         }
     } else if (state == ENLARGER_CONTROL_STATE_SAFE) {
         if (has_rgb) {
-            red = enlarger_control->safe_value;
+            *red = enlarger_control->safe_value;
         }
     } else if (state == ENLARGER_CONTROL_STATE_EXPOSURE) {
         if (has_rgb && grade == CONTRAST_GRADE_MAX) {
-            red = channel_red;
-            green = channel_green;
-            blue = channel_blue;
+            *red = channel_red;
+            *green = channel_green;
+            *blue = channel_blue;
         } else if (has_rgb && enlarger_control->contrast_mode == ENLARGER_CONTRAST_MODE_GREEN_BLUE) {
             if (grade >= CONTRAST_GRADE_MAX) { return osErrorParameter; }
-            green = enlarger_control->grade_values[grade].channel_green;
-            blue = enlarger_control->grade_values[grade].channel_blue;
+            *green = enlarger_control->grade_values[grade].channel_green;
+            *blue = enlarger_control->grade_values[grade].channel_blue;
         } else {
             if (has_rgb) {
-                red = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_red;
-                green = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_green;
-                blue = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_blue;
+                *red = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_red;
+                *green = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_green;
+                *blue = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_blue;
             }
             if (has_white) {
-                white = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_white;
+                *white = enlarger_control->grade_values[CONTRAST_GRADE_2].channel_white;
             }
         }
     }
 
-    return enlarger_control_set_frame(enlarger_control, red, green, blue, white, blocking);
+    return osOK;
 }
 
 osStatus_t enlarger_control_set_frame(const enlarger_control_t *enlarger_control,
     uint16_t red, uint16_t green, uint16_t blue, uint16_t white,
     bool blocking)
+{
+    uint16_t channels[ENLARGER_CONTROL_FRAME_SLOTS];
+    uint8_t values[ENLARGER_CONTROL_FRAME_SLOTS];
+
+    if (enlarger_control->ramp_time > 0) {
+        return enlarger_control_set_ramp_frame(enlarger_control, red, green, blue, white, blocking);
+    }
+
+    const size_t len = enlarger_control_build_frame(enlarger_control, red, green, blue, white, channels, values);
+
+    return dmx_set_sparse_frame(channels, values, len, blocking);
+}
+
+size_t enlarger_control_build_frame(const enlarger_control_t *enlarger_control,
+    uint16_t red, uint16_t green, uint16_t blue, uint16_t white,
+    uint16_t *channels, uint8_t *values)
 {
     const bool has_rgb =
         enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGB
         || enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGBW;
 
-    uint16_t channels[8] = {0};
-    uint8_t values[8] = {0};
     size_t len = 0;
 
+    memset(channels, 0, sizeof(uint16_t) * ENLARGER_CONTROL_FRAME_SLOTS);
+    memset(values, 0, ENLARGER_CONTROL_FRAME_SLOTS);
+
     if (has_rgb) {
         if (enlarger_control->dmx_wide_mode) {
             channels[0] = enlarger_control->dmx_channel_red;
@@ -191,5 +527,44 @@ osStatus_t enlarger_control_set_frame(const enlarger_control_t *enlarger_control
         }
     }
 
-    return dmx_set_sparse_frame(channels, values, len, blocking);
+    return len;
+}
+
+osStatus_t enlarger_control_set_ramp_frame(const enlarger_control_t *enlarger_control,
+    uint16_t red, uint16_t green, uint16_t blue, uint16_t white,
+    bool blocking)
+{
+    const bool has_rgb =
+        enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGB
+        || enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGBW;
+
+    uint16_t channels[4] = {0};
+    uint16_t values[4] = {0};
+    size_t len = 0;
+
+    if (has_rgb) {
+        channels[0] = enlarger_control->dmx_channel_red;
+        channels[1] = enlarger_control->dmx_channel_green;
+        channels[2] = enlarger_control->dmx_channel_blue;
+        values[0] = red;
+        values[1] = green;
+        values[2] = blue;
+        len = 3;
+
+        if (enlarger_control->channel_set == ENLARGER_CHANNEL_SET_RGBW) {
+            channels[3] = enlarger_control->dmx_channel_white;
+            values[3] = white;
+            len = 4;
+        }
+    } else {
+        channels[0] = enlarger_control->dmx_channel_white;
+        values[0] = white;
+        len = 1;
+    }
+
+    const dmx_ramp_curve_t curve = (enlarger_control->ramp_curve == ENLARGER_RAMP_CURVE_GAMMA)
+        ? DMX_RAMP_CURVE_GAMMA : DMX_RAMP_CURVE_LINEAR;
+
+    return dmx_set_ramp_frame(channels, values, len, enlarger_control->dmx_wide_mode,
+        enlarger_control->ramp_time, curve, blocking);
 }
@@ -26,6 +26,39 @@ typedef enum : uint8_t {
     ENLARGER_CONTROL_STATE_EXPOSURE /*!< Enlarger is in exposure mode */
 } enlarger_control_state_t;
 
+/**
+ * Most DMX slots touched by any enlarger state, which is the case
+ * of four channels in 16-bit mode.
+ */
+#define ENLARGER_CONTROL_FRAME_SLOTS 8
+
+/**
+ * Most enlarger heads that can be driven together on the same DMX line.
+ */
+#define ENLARGER_CONTROL_MAX_HEADS 2
+
+typedef struct {
+    uint8_t values[ENLARGER_CONTROL_FRAME_SLOTS];
+} enlarger_control_frame_t;
+
+/**
+ * DMX frames for every enlarger state, prepared ahead of time.
+ *
+ * Every state touches the same set of slots, so each frame is just
+ * the values to write into them. Explicit channel values and fades
+ * cannot be prepared, and are passed through to the normal path.
+ */
+typedef struct {
+    enlarger_control_t control;             /*!< Configuration the frames were prepared from */
+    bool prepared;                          /*!< True if the frames are ready to use */
+    uint8_t len;                            /*!< Number of slots in each frame */
+    uint16_t channels[ENLARGER_CONTROL_FRAME_SLOTS]; /*!< Frame position of each slot */
+    enlarger_control_frame_t off;
+    enlarger_control_frame_t focus;
+    enlarger_control_frame_t safe;
+    enlarger_control_frame_t grades[CONTRAST_GRADE_MAX]; /*!< Exposure frame for each contrast grade */
+} enlarger_control_frames_t;
+
 /**
  * Set the enlarger to the desired state.
  *
@@ -58,4 +91,73 @@ osStatus_t enlarger_control_set_state_off(const enlarger_control_t *enlarger_con
 osStatus_t enlarger_control_set_state_focus(const enlarger_control_t *enlarger_control, bool blocking);
 osStatus_t enlarger_control_set_state_safe(const enlarger_control_t *enlarger_control, bool blocking);
 
+/**
+ * Prepare the frames for every enlarger state.
+ *
+ * This copies the control configuration, and builds the frame for the
+ * off, focus and safelight states and for the exposure state at every
+ * contrast grade, so that the prepared frames can be used to set the
+ * enlarger state without referring back to it. Nothing is prepared for
+ * relay control or fades, which the prepared setters pass on to the
+ * normal path instead.
+ *
+ * @param frames Frames to prepare
+ * @param enlarger_control The control portion of the active enlarger configuration
+ */
+void enlarger_control_prepare_frames(enlarger_control_frames_t *frames, const enlarger_control_t *enlarger_control);
+
+/**
+ * Set the enlarger to the desired state, using prepared frames.
+ *
+ * This behaves the same as 'enlarger_control_set_state()', but reduces
+ * the work of a state change to selecting the prepared frame and
+ * handing it off. This makes it suitable for use on exposure edges.
+ */
+osStatus_t enlarger_control_set_prepared_state(const enlarger_control_frames_t *frames,
+    enlarger_control_state_t state, contrast_grade_t grade,
+    uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
+    bool blocking);
+
+osStatus_t enlarger_control_set_prepared_state_off(const enlarger_control_frames_t *frames, bool blocking);
+
+/**
+ * Set several enlarger heads to their desired states, using prepared frames.
+ *
+ * The prepared frames for all the heads are composed into a single frame
+ * update, so every head changes in the same DMX frame and driving more
+ * than one head does not add to the time it takes for a change to
+ * reach the line. The contrast grade and explicit channel values
+ * apply to every head in the exposure state.
+ *
+ * Heads under relay control or with fades cannot be composed this way,
+ * so they are only accepted when there is a single head.
+ *
+ * @param frames Array of prepared frames, one for each head
+ * @param states Corresponding array of states to set
+ * @param count Number of heads, up to ENLARGER_CONTROL_MAX_HEADS
+ */
+osStatus_t enlarger_control_set_prepared_heads(const enlarger_control_frames_t *frames,
+    const enlarger_control_state_t *states, size_t count, contrast_grade_t grade,
+    uint16_t channel_red, uint16_t channel_green, uint16_t channel_blue,
+    bool blocking);
+
+/**
+ * Check whether two DMX enlarger heads would write to any of the same
+ * frame slots, which would prevent them from being driven together.
+ */
+bool enlarger_control_heads_overlap(const enlarger_control_t *enlarger_control1, const enlarger_control_t *enlarger_control2);
+
+#ifdef DEBUG
+/**
+ * Prepare frames for every channel set, slot width and contrast mode,
+ * and compare every state and contrast grade against the values those
+ * configurations are expected to produce.
+ *
+ * This is only built into debug firmware, where it is run once at startup.
+ *
+ * @return True if all prepared frames match
+ */
+bool enlarger_control_check_prepared_frames();
+#endif
+
 #endif /* ENLARGER_CONTROL_H */
@@ -18,21 +18,33 @@
 
 static TIM_HandleTypeDef *timer_htim = nullptr;
 static exposure_timer_config_t timer_config = {0};
-static enlarger_control_t enlarger_control = {0};
+static enlarger_control_frames_t enlarger_frames[ENLARGER_CONTROL_MAX_HEADS] = {0};
+static enlarger_config_t secondary_config = {0};
+static bool secondary_config_set = false;
+static uint8_t enlarger_head_count = 1;
+static uint32_t dmx_refresh_interval = 30;
 
 static TaskHandle_t timer_task_handle = nullptr;
 static bool enlarger_activated = false;
 static bool enlarger_deactivated = false;
+static bool enlarger_activate_pending = false;
 static bool enlarger_deactivate_pending = false;
+static uint8_t enlarger_heads_active = 0;
+static uint8_t enlarger_heads_pending = 0;
 static bool timer_notify_end = false;
 static bool timer_cancel_request = false;
 static exposure_timer_state_t timer_state = EXPOSURE_TIMER_STATE_NONE;
 static uint32_t time_elapsed = 0;
 static uint32_t buzz_start = 0;
 static uint32_t buzz_stop = 0;
+static uint32_t dmx_frame_elapsed = 0;
 static uint32_t enlarger_on_event_ticks = 0;
 static uint32_t enlarger_off_event_ticks = 0;
 
+static void exposure_timer_enlarger_delays(const enlarger_config_t *enlarger_config,
+    uint32_t *on_delay, uint32_t *off_delay, uint32_t *end_delay);
+static bool exposure_timer_set_enlarger_heads(uint8_t heads_active);
+
 void exposure_timer_init(TIM_HandleTypeDef *htim)
 {
     timer_htim = htim;
@@ -66,11 +78,45 @@ void exposure_timer_set_config_time(exposure_timer_config_t *config,
             exposure_time, min_exposure_time);
     }
 
+    uint32_t on_delay;
+    uint32_t off_delay;
+    uint32_t end_delay;
+    exposure_timer_enlarger_delays(enlarger_config, &on_delay, &off_delay, &end_delay);
+
     /* Assign the time fields based on the enlarger profile */
     config->exposure_time = exposure_time;
-    config->enlarger_on_delay = round_to_10(enlarger_config->timing.turn_on_delay + (enlarger_config->timing.rise_time - enlarger_config->timing.rise_time_equiv));
-    config->enlarger_off_delay = round_to_10(enlarger_config->timing.turn_off_delay + enlarger_config->timing.fall_time_equiv);
-    config->exposure_end_delay = round_to_10(enlarger_config->timing.fall_time - enlarger_config->timing.fall_time_equiv);
+    config->enlarger_on_delay = on_delay;
+    config->enlarger_off_delay = off_delay;
+    config->exposure_end_delay = end_delay;
+    config->secondary_off_time = 0;
+
+    /*
+     * Both heads are turned on together, and the secondary head is then
+     * turned off on its own schedule so that it also delivers the full
+     * exposure time according to its own timing profile. The end of the
+     * exposure process is pushed back to cover whichever head finishes last.
+     */
+    if (secondary_config_set) {
+        uint32_t secondary_on_delay;
+        uint32_t secondary_off_delay;
+        uint32_t secondary_end_delay;
+        exposure_timer_enlarger_delays(&secondary_config,
+            &secondary_on_delay, &secondary_off_delay, &secondary_end_delay);
+
+        if (exposure_time < round_to_10(enlarger_config_min_exposure(&secondary_config))) {
+            log_e("Cannot accurately time short exposure on secondary head");
+        }
+
+        if (exposure_time + secondary_on_delay > secondary_off_delay + 10) {
+            config->secondary_off_time = exposure_time + secondary_on_delay - secondary_off_delay;
+        } else {
+            config->secondary_off_time = 10;
+        }
+
+        if (secondary_on_delay + secondary_end_delay > on_delay + end_delay) {
+            config->exposure_end_delay = (secondary_on_delay + secondary_end_delay) - on_delay;
+        }
+    }
 
     /* Log all the relevant time properties */
     log_d("Set for desired time of %ldms", exposure_time);
@@ -78,6 +124,38 @@ void exposure_timer_set_config_time(exposure_timer_config_t *config,
     log_d("On delay: %dms", config->enlarger_on_delay);
     log_d("Off delay: %dms", config->enlarger_off_delay);
     log_d("End delay: %dms", config->exposure_end_delay);
+    if (config->secondary_off_time > 0) {
+        log_d("Secondary off time: %ldms", config->secondary_off_time);
+    }
+}
+
+void exposure_timer_enlarger_delays(const enlarger_config_t *enlarger_config,
+    uint32_t *on_delay, uint32_t *off_delay, uint32_t *end_delay)
+{
+    /*
+     * DMX fades between light levels act as an additional rise and fall
+     * on top of the calibrated timing profile, and are accounted for
+     * in the same way.
+     */
+    const uint32_t ramp_time = enlarger_config->control.dmx_control ? enlarger_config->control.ramp_time : 0;
+    const uint32_t ramp_time_equiv = enlarger_config_ramp_time_equiv(enlarger_config);
+
+    *on_delay = round_to_10(enlarger_config->timing.turn_on_delay + (enlarger_config->timing.rise_time - enlarger_config->timing.rise_time_equiv)
+        + (ramp_time - ramp_time_equiv));
+    *off_delay = round_to_10(enlarger_config->timing.turn_off_delay + enlarger_config->timing.fall_time_equiv + ramp_time_equiv);
+    *end_delay = round_to_10(enlarger_config->timing.fall_time - enlarger_config->timing.fall_time_equiv
+        + (ramp_time - ramp_time_equiv));
+}
+
+void exposure_timer_set_secondary_enlarger(const enlarger_config_t *enlarger_config)
+{
+    if (enlarger_config) {
+        memcpy(&secondary_config, enlarger_config, sizeof(enlarger_config_t));
+        secondary_config_set = true;
+    } else {
+        memset(&secondary_config, 0, sizeof(enlarger_config_t));
+        secondary_config_set = false;
+    }
 }
 
 void exposure_timer_set_config(const exposure_timer_config_t *config, const enlarger_control_t *control)
@@ -88,10 +166,21 @@ void exposure_timer_set_config(const exposure_timer_config_t *config, const enla
         memcpy(&timer_config, config, sizeof(exposure_timer_config_t));
     }
 
-    if (!control) {
-        memset(&enlarger_control, 0, sizeof(enlarger_control_t));
-    } else {
-        memcpy(&enlarger_control, control, sizeof(enlarger_control_t));
+    /* Prepare the enlarger frames here, to keep that work off the exposure edges */
+    enlarger_control_prepare_frames(&enlarger_frames[0], control);
+    enlarger_head_count = 1;
+
+    if (secondary_config_set && timer_config.secondary_off_time > 0
+        && enlarger_frames[0].control.dmx_control) {
+        enlarger_control_prepare_frames(&enlarger_frames[1], &secondary_config.control);
+        enlarger_head_count = 2;
+    }
+
+    dmx_refresh_interval = 30;
+    for (uint8_t i = 0; i < enlarger_head_count; i++) {
+        if (enlarger_frames[i].control.ramp_time > 0) {
+            dmx_refresh_interval = 10;
+        }
     }
 }
 
@@ -115,16 +204,30 @@ HAL_StatusTypeDef exposure_timer_run()
     timer_task_handle = xTaskGetCurrentTaskHandle();
     enlarger_activated = false;
     enlarger_deactivated = false;
+    enlarger_activate_pending = false;
     enlarger_deactivate_pending = false;
+    enlarger_heads_active = 0;
+    enlarger_heads_pending = 0;
     timer_notify_end = false;
     timer_cancel_request = false;
     timer_state = EXPOSURE_TIMER_STATE_NONE;
     time_elapsed = 0;
+    dmx_frame_elapsed = 0;
     enlarger_on_event_ticks = 0;
     enlarger_off_event_ticks = 0;
 
     buzzer_reset_volume();
 
+    /*
+     * Keep panel LED updates out of the way until the exposure is over,
+     * and schedule the safelight to be off by the time the countdown
+     * finishes, so its turn-off delay overlaps with the countdown.
+     */
+    illum_controller_panel_hold(true);
+    const uint32_t countdown_ms = (timer_config.start_tone == EXPOSURE_TIMER_START_TONE_COUNTDOWN) ? 3000 : 0;
+    const uint32_t safelight_ready_ticks = illum_controller_safelight_schedule(ILLUM_SAFELIGHT_EXPOSURE,
+        osKernelGetTickCount() + pdMS_TO_TICKS(countdown_ms));
+
     if (timer_config.start_tone == EXPOSURE_TIMER_START_TONE_COUNTDOWN) {
         do {
             buzzer_beep_blocking(2000, 50);
@@ -154,13 +257,17 @@ HAL_StatusTypeDef exposure_timer_run()
         buzzer_task_enable(false);
         buzzer_set_frequency(500);
 
-        illum_controller_safelight_state(ILLUM_SAFELIGHT_EXPOSURE);
+        /* Wait for the safelight to finish turning off, if it has not already */
+        if ((int32_t)(safelight_ready_ticks - osKernelGetTickCount()) > 0) {
+            osDelayUntil(safelight_ready_ticks);
+        }
 
         log_i("Starting exposure timer");
 
-        if (enlarger_control.dmx_control) {
+        if (enlarger_frames[0].control.dmx_control) {
             dmx_pause();
             dmx_enable_direct_frame_update();
+            dmx_reset_latency_stats();
         }
 
         HAL_TIM_Base_Start_IT(timer_htim);
@@ -190,7 +297,12 @@ HAL_StatusTypeDef exposure_timer_run()
             }
         }
 
-        if (enlarger_control.dmx_control) {
+        if (enlarger_frames[0].control.dmx_control) {
+            dmx_latency_stats_t latency_stats;
+            dmx_get_latency_stats(&latency_stats);
+            log_d("DMX edge latency: count=%lu, last=%luus, max=%luus",
+                latency_stats.count, latency_stats.last_us, latency_stats.max_us);
+
             osDelay(30);
             dmx_start();
         }
@@ -199,6 +311,7 @@ HAL_StatusTypeDef exposure_timer_run()
 
         buzzer_task_enable(true);
         illum_controller_safelight_state(ILLUM_SAFELIGHT_HOME);
+        illum_controller_panel_hold(false);
 
         log_d("Actual enlarger on/off time: %lums",
             (enlarger_off_event_ticks - enlarger_on_event_ticks) / portTICK_RATE_MS);
@@ -214,6 +327,10 @@ HAL_StatusTypeDef exposure_timer_run()
             }
         }
         osDelay(pdMS_TO_TICKS(500));
+    } else {
+        /* This also cancels the scheduled safelight change, if it has not happened yet */
+        illum_controller_safelight_state(ILLUM_SAFELIGHT_HOME);
+        illum_controller_panel_hold(false);
     }
 
     return timer_cancel_request ? HAL_TIMEOUT : HAL_OK;
@@ -233,39 +350,87 @@ void exposure_timer_notify()
         HAL_TIM_Base_Stop_IT(timer_htim);
     }
 
+    const uint32_t enlarger_off_time = timer_config.enlarger_on_delay + (timer_config.exposure_time - timer_config.enlarger_off_delay);
+
     if (!enlarger_activated) {
-        enlarger_on_event_ticks = osKernelGetTickCount();
-        enlarger_control_set_state(&enlarger_control,
-            ENLARGER_CONTROL_STATE_EXPOSURE, timer_config.contrast_grade,
-            timer_config.channel_red, timer_config.channel_green, timer_config.channel_blue,
-            false);
-        if (enlarger_control.dmx_control) {
-            dmx_send_frame_explicit();
+        /*
+         * If the update could not be taken, such as when the fade queue
+         * is full, try again on the next tick. The rest of the exposure
+         * is timed from whenever this succeeds.
+         */
+        const uint8_t heads_active = (1U << enlarger_head_count) - 1U;
+        if (!exposure_timer_set_enlarger_heads(heads_active)) {
+            return;
+        }
+        enlarger_heads_active = heads_active;
+        if (enlarger_frames[0].control.dmx_control) {
+            enlarger_activate_pending = true;
+        } else {
+            enlarger_on_event_ticks = osKernelGetTickCount();
         }
         enlarger_activated = true;
     } else {
         time_elapsed += 10;
 
-        if (!enlarger_deactivated && !enlarger_deactivate_pending
-            && ((time_elapsed >= timer_config.enlarger_on_delay + (timer_config.exposure_time - timer_config.enlarger_off_delay)) || cancel_flag)) {
-            if (enlarger_control.dmx_control) {
-                enlarger_deactivate_pending = true;
-            } else {
-                enlarger_control_set_state_off(&enlarger_control, false);
-                enlarger_off_event_ticks = osKernelGetTickCount();
-                enlarger_deactivated = true;
+        if (!enlarger_deactivated && !enlarger_deactivate_pending) {
+            uint8_t heads_off = 0;
+            if ((enlarger_heads_active & 0x01) != 0 && (time_elapsed >= enlarger_off_time || cancel_flag)) {
+                heads_off |= 0x01;
+            }
+            if ((enlarger_heads_active & 0x02) != 0 && (time_elapsed >= timer_config.secondary_off_time || cancel_flag)) {
+                heads_off |= 0x02;
+            }
+
+            /* As with the on edge, an update that could not be taken is tried again on the next tick */
+            if (heads_off != 0 && exposure_timer_set_enlarger_heads(enlarger_heads_active & ~heads_off)) {
+                enlarger_heads_active &= ~heads_off;
+                if (enlarger_frames[0].control.dmx_control) {
+                    enlarger_heads_pending = heads_off;
+                    enlarger_deactivate_pending = true;
+                } else {
+                    enlarger_off_event_ticks = osKernelGetTickCount();
+                    enlarger_deactivated = true;
+                }
             }
         }
+    }
 
-        if (enlarger_control.dmx_control && (time_elapsed % 30) == 0) {
-            if (enlarger_deactivate_pending) {
-                enlarger_control_set_state_off(&enlarger_control, false);
+    if (enlarger_frames[0].control.dmx_control) {
+        if (enlarger_activate_pending || enlarger_deactivate_pending) {
+            /*
+             * Send the on and off frames right away. Refresh frames are
+             * held back ahead of the off edge, so the line is normally
+             * free and this only has to wait on a cancel.
+             */
+            if (dmx_send_frame_explicit()) {
+                const uint32_t ticks = osKernelGetTickCount();
+                if (enlarger_activate_pending) {
+                    enlarger_on_event_ticks = ticks;
+                    enlarger_activate_pending = false;
+                }
+                if (enlarger_deactivate_pending) {
+                    if ((enlarger_heads_pending & 0x01) != 0) {
+                        enlarger_off_event_ticks = ticks;
+                    }
+                    enlarger_heads_pending = 0;
+                    enlarger_deactivate_pending = false;
+                    enlarger_deactivated = (enlarger_heads_active == 0);
+                }
+                dmx_frame_elapsed = time_elapsed;
             }
-            dmx_send_frame_explicit();
-            if (enlarger_deactivate_pending) {
-                enlarger_off_event_ticks = osKernelGetTickCount();
-                enlarger_deactivate_pending = false;
-                enlarger_deactivated = true;
+        } else if (time_elapsed - dmx_frame_elapsed >= dmx_refresh_interval) {
+            /* Only refresh if the frame will be off the wire before the next off edge */
+            uint32_t next_off_time = UINT32_MAX;
+            if ((enlarger_heads_active & 0x01) != 0) {
+                next_off_time = enlarger_off_time;
+            }
+            if ((enlarger_heads_active & 0x02) != 0 && timer_config.secondary_off_time < next_off_time) {
+                next_off_time = timer_config.secondary_off_time;
+            }
+            if (enlarger_deactivated || time_elapsed + dmx_get_frame_duration_ms() < next_off_time) {
+                if (dmx_send_frame_explicit()) {
+                    dmx_frame_elapsed = time_elapsed;
+                }
             }
         }
     }
@@ -362,3 +527,25 @@ void exposure_timer_notify()
         timer_state = EXPOSURE_TIMER_STATE_DONE;
     }
 }
+
+bool exposure_timer_set_enlarger_heads(uint8_t heads_active)
+{
+    enlarger_control_state_t states[ENLARGER_CONTROL_MAX_HEADS];
+
+    for (uint8_t i = 0; i < enlarger_head_count; i++) {
+        states[i] = ((heads_active & (1U << i)) != 0)
+            ? ENLARGER_CONTROL_STATE_EXPOSURE : ENLARGER_CONTROL_STATE_OFF;
+    }
+
+    osStatus_t ret = enlarger_control_set_prepared_heads(enlarger_frames, states, enlarger_head_count,
+        timer_config.contrast_grade,
+        timer_config.channel_red, timer_config.channel_green, timer_config.channel_blue,
+        false);
+
+    if (ret != osOK && enlarger_frames[0].control.dmx_control) {
+        /* Fades are only taken as frames go out, so send one to make room for the retry */
+        dmx_send_frame_explicit();
+    }
+
+    return ret == osOK;
+}
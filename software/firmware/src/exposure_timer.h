@@ -45,6 +45,9 @@ typedef struct {
     /* Time delay between the end of the timer period and the completion of the timer process */
     uint16_t exposure_end_delay;
 
+    /* Time from turning the enlarger on until turning the secondary head off, or 0 if there is none */
+    uint32_t secondary_off_time;
+
     /* Tone sequence to play at the start of the exposure sequence */
     exposure_timer_start_tone_t start_tone;
 
@@ -82,6 +85,17 @@ void exposure_timer_init(TIM_HandleTypeDef *htim);
 void exposure_timer_set_config_time(exposure_timer_config_t *config,
     uint32_t exposure_time, const enlarger_config_t *enlarger_config);
 
+/**
+ * Set the enlarger configuration for a secondary head, which is driven
+ * together with the primary enlarger on the same DMX line.
+ *
+ * This affects the time fields set by 'exposure_timer_set_config_time()',
+ * and is only used if the primary enlarger is also under DMX control.
+ *
+ * @param enlarger_config Secondary enlarger configuration, or NULL for none
+ */
+void exposure_timer_set_secondary_enlarger(const enlarger_config_t *enlarger_config);
+
 /**
  * Set the provided configuration as the active configuration for
  * the exposure timer.
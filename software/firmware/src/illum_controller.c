@@ -21,6 +21,12 @@ static const osMutexAttr_t illum_mutex_attributes = {
   .attr_bits = osMutexRecursive,
 };
 
+/* Semaphore to wake up the service task when there is new work for it */
+static osSemaphoreId_t illum_service_semaphore = NULL;
+static const osSemaphoreAttr_t illum_service_semaphore_attributes = {
+    .name = "illum_service_semaphore"
+};
+
 static safelight_config_t illum_safelight_config;
 static illum_safelight_t illum_safelight = ILLUM_SAFELIGHT_HOME;
 static bool illum_blackout = false;
@@ -32,8 +38,17 @@ static uint16_t panel_led_dim = 0;
 static bool panel_led_normal_changed = true;
 static bool panel_led_bright_changed = true;
 static bool panel_led_dim_changed = true;
+static bool panel_hold = false;
 
+/* Safelight change waiting for the service task, if any */
+static bool safelight_scheduled = false;
+static illum_safelight_t safelight_scheduled_mode = ILLUM_SAFELIGHT_HOME;
+static uint32_t safelight_scheduled_ticks = 0;
+
+static void illum_controller_service_loop();
 static void illum_controller_set_safelight(bool enabled);
+static bool mode_safelight_enabled(illum_safelight_t mode);
+static bool safelight_needs_turn_off_delay(illum_safelight_t mode);
 static uint8_t panel_brightness_value(illum_panel_brightness_t panel_brightness);
 static void panel_brightness_update();
 
@@ -48,6 +63,59 @@ void illum_controller_init()
     illum_blackout = keypad_is_blackout_enabled();
 }
 
+void task_illum_run(void *argument)
+{
+    osSemaphoreId_t task_start_semaphore = argument;
+
+    /* Create the semaphore used to wake up the service task */
+    illum_service_semaphore = osSemaphoreNew(1, 0, &illum_service_semaphore_attributes);
+    if (!illum_service_semaphore) {
+        log_e("Unable to create service semaphore");
+        return;
+    }
+
+    /* Release the startup semaphore */
+    if (osSemaphoreRelease(task_start_semaphore) != osOK) {
+        log_e("Unable to release task_start_semaphore");
+        return;
+    }
+
+    /* Start the service task loop */
+    illum_controller_service_loop();
+}
+
+[[noreturn]] void illum_controller_service_loop()
+{
+    for (;;) {
+        uint32_t wait_ticks = osWaitForever;
+
+        osMutexAcquire(illum_mutex, portMAX_DELAY);
+
+        /* Carry out the scheduled safelight change, once it is due */
+        if (safelight_scheduled) {
+            const uint32_t ticks = osKernelGetTickCount();
+            if ((int32_t)(ticks - safelight_scheduled_ticks) >= 0) {
+                log_d("safelight_state: %d, scheduled=%lu, actual=%lu",
+                    safelight_scheduled_mode, safelight_scheduled_ticks, ticks);
+                illum_safelight = safelight_scheduled_mode;
+                illum_controller_set_safelight(!illum_blackout && mode_safelight_enabled(illum_safelight));
+                safelight_scheduled = false;
+            } else {
+                wait_ticks = safelight_scheduled_ticks - ticks;
+            }
+        }
+
+        /* Send any panel changes to the LED driver */
+        if (!panel_hold) {
+            panel_brightness_update();
+        }
+
+        osMutexRelease(illum_mutex);
+
+        osSemaphoreAcquire(illum_service_semaphore, wait_ticks);
+    }
+}
+
 void illum_controller_refresh()
 {
     bool safelight_dmx = false;
@@ -87,7 +155,7 @@ void illum_controller_refresh()
     osMutexRelease(illum_mutex);
 }
 
-static bool mode_safelight_enabled(illum_safelight_t mode)
+bool mode_safelight_enabled(illum_safelight_t mode)
 {
     const safelight_mode_t setting = illum_safelight_config.mode;
     bool safelight_enabled = true;
@@ -152,11 +220,18 @@ static bool mode_safelight_enabled(illum_safelight_t mode)
     return safelight_enabled;
 }
 
+bool safelight_needs_turn_off_delay(illum_safelight_t mode)
+{
+    return !illum_blackout
+        && mode_safelight_enabled(illum_safelight) && !mode_safelight_enabled(mode)
+        && (mode == ILLUM_SAFELIGHT_EXPOSURE || mode == ILLUM_SAFELIGHT_MEASUREMENT)
+        && illum_safelight_config.turn_off_delay > 0;
+}
+
 void illum_controller_safelight_state(illum_safelight_t mode)
 {
-    bool safelight_prev_enabled;
     bool safelight_enabled;
-    uint32_t turn_off_delay;
+    uint32_t turn_off_delay = 0;
 
     osMutexAcquire(illum_mutex, portMAX_DELAY);
 
@@ -164,22 +239,58 @@ void illum_controller_safelight_state(illum_safelight_t mode)
         log_d("safelight_state: %d", mode);
     }
 
-    safelight_prev_enabled = !illum_blackout && mode_safelight_enabled(illum_safelight);
+    safelight_scheduled = false;
+
     safelight_enabled = !illum_blackout && mode_safelight_enabled(mode);
-    turn_off_delay = illum_safelight_config.turn_off_delay;
+    if (safelight_needs_turn_off_delay(mode)) {
+        turn_off_delay = illum_safelight_config.turn_off_delay;
+    }
     illum_safelight = mode;
 
     illum_controller_set_safelight(safelight_enabled);
 
     osMutexRelease(illum_mutex);
 
-    if (safelight_prev_enabled && !safelight_enabled
-        && (mode == ILLUM_SAFELIGHT_EXPOSURE || mode == ILLUM_SAFELIGHT_MEASUREMENT)
-        && turn_off_delay > 0) {
+    if (turn_off_delay > 0) {
         osDelay(turn_off_delay);
     }
 }
 
+uint32_t illum_controller_safelight_schedule(illum_safelight_t mode, uint32_t ready_ticks)
+{
+    /* Without the service task, just make the change right away */
+    if (!illum_service_semaphore) {
+        illum_controller_safelight_state(mode);
+        return osKernelGetTickCount();
+    }
+
+    osMutexAcquire(illum_mutex, portMAX_DELAY);
+
+    const uint32_t ticks = osKernelGetTickCount();
+    uint32_t change_ticks = ready_ticks;
+    uint32_t turn_off_delay = 0;
+
+    if (safelight_needs_turn_off_delay(mode)) {
+        turn_off_delay = illum_safelight_config.turn_off_delay;
+        change_ticks -= turn_off_delay;
+    }
+    if ((int32_t)(change_ticks - ticks) < 0) {
+        change_ticks = ticks;
+    }
+
+    log_d("safelight_schedule: %d, change=%lu, ready=%lu", mode, change_ticks, change_ticks + turn_off_delay);
+
+    safelight_scheduled = true;
+    safelight_scheduled_mode = mode;
+    safelight_scheduled_ticks = change_ticks;
+
+    osMutexRelease(illum_mutex);
+
+    osSemaphoreRelease(illum_service_semaphore);
+
+    return change_ticks + turn_off_delay;
+}
+
 void illum_controller_set_safelight(bool enabled)
 {
     bool toggle_relay = false;
@@ -209,7 +320,12 @@ void illum_controller_set_safelight(bool enabled)
         relay_safelight_enable(enabled);
     }
 
-    /* Toggle the DMX output channel, if configured */
+    /*
+     * Toggle the DMX output channel, if configured.
+     * This may run from the service task while the enlarger is being
+     * changed from another task or the exposure interrupt, which is safe
+     * because each DMX frame update is made inside a critical section.
+     */
     if (toggle_dmx) {
         uint8_t frame[2] = {0};
         if (illum_safelight_config.dmx_wide_mode) {
@@ -261,8 +377,27 @@ void illum_controller_set_panel(led_t panel_led, illum_panel_brightness_t panel_
         panel_led_dim = updated_led_dim;
         panel_led_dim_changed = true;
     }
-    panel_brightness_update();
+
+    /* Leave the LED driver update to the service task, once it is running */
+    if (!illum_service_semaphore) {
+        panel_brightness_update();
+    }
+    osMutexRelease(illum_mutex);
+
+    if (illum_service_semaphore) {
+        osSemaphoreRelease(illum_service_semaphore);
+    }
+}
+
+void illum_controller_panel_hold(bool hold)
+{
+    osMutexAcquire(illum_mutex, portMAX_DELAY);
+    panel_hold = hold;
     osMutexRelease(illum_mutex);
+
+    if (!hold && illum_service_semaphore) {
+        osSemaphoreRelease(illum_service_semaphore);
+    }
 }
 
 uint8_t panel_brightness_value(illum_panel_brightness_t panel_brightness)
@@ -315,7 +450,7 @@ void illum_controller_keypad_blackout_callback(bool enabled, void *user_data)
         log_d("blackout_state: %d", enabled);
         illum_blackout = enabled;
     }
-    illum_controller_safelight_state(illum_safelight);
+    illum_controller_set_safelight(!illum_blackout && mode_safelight_enabled(illum_safelight));
 
     if (enabled) {
         display_enable(false);
@@ -8,6 +8,10 @@
  * and the panel LEDs.
  * Also responsible for controlling whether the DMX control port
  * is transmitting.
+ *
+ * Panel LED updates and scheduled safelight changes are carried out
+ * by a service task, so that they can be coalesced and kept clear of
+ * the moments where the enlarger is being switched.
  */
 
 #ifndef ILLUM_CONTROLLER_H
@@ -30,6 +34,13 @@ typedef enum {
 
 void illum_controller_init();
 
+/**
+ * Start the illumination controller service task.
+ *
+ * @param argument The osSemaphoreId_t used to synchronize task startup.
+ */
+void task_illum_run(void *argument);
+
 /**
  * Refresh the illumination configuration.
  *
@@ -38,10 +49,49 @@ void illum_controller_init();
  */
 void illum_controller_refresh();
 
+/**
+ * Set the safelight state immediately.
+ *
+ * If this turns the safelight off ahead of an exposure or measurement,
+ * then this function will block for the configured turn-off delay.
+ * Any scheduled safelight change is cancelled.
+ */
 void illum_controller_safelight_state(illum_safelight_t mode);
 
+/**
+ * Schedule a safelight state change so that it has taken effect
+ * by a specific time.
+ *
+ * If the change turns the safelight off ahead of an exposure or
+ * measurement, then it is started the configured turn-off delay ahead
+ * of the requested time. Otherwise it is made at the requested time.
+ * This function does not block, and the scheduled change is cancelled
+ * by any call to 'illum_controller_safelight_state()'.
+ *
+ * @param mode Safelight state to change to
+ * @param ready_ticks Tick count by which the change should have taken effect
+ * @return Tick count at which the change will actually have taken effect,
+ *         which may be later than requested if there is not enough time
+ */
+uint32_t illum_controller_safelight_schedule(illum_safelight_t mode, uint32_t ready_ticks);
+
+/**
+ * Set the brightness of panel LEDs.
+ *
+ * The LED driver is updated by the service task, and any changes made
+ * before it gets to them are combined into a single update.
+ */
 void illum_controller_set_panel(led_t panel_led, illum_panel_brightness_t panel_brightness);
 
+/**
+ * Hold back panel LED updates.
+ *
+ * While held, panel changes are recorded but not sent to the LED driver.
+ * When released, only the resulting final state is sent. This is used to
+ * keep LED driver traffic out of the way of an exposure.
+ */
+void illum_controller_panel_hold(bool hold);
+
 bool illum_controller_is_blackout();
 
 void illum_controller_keypad_blackout_callback(bool enabled, void *user_data);
@@ -69,7 +69,11 @@ static const osSemaphoreAttr_t task_start_semaphore_attributes = {
 #define TASK_KEYPAD_STACK_SIZE      (2048U)
 #define TASK_BUZZER_STACK_SIZE      (1024U)
 #define TASK_DMX_STACK_SIZE         (2048U)
+#define TASK_ILLUM_STACK_SIZE       (1024U)
 #define TASK_METER_PROBE_STACK_SIZE (2048U)
+#define TASK_SCREENSHOT_STACK_SIZE  (4096U)
+#define TASK_DISPLAY_STACK_SIZE     (2048U)
+#define TASK_SETTINGS_STACK_SIZE    (2048U)
 
 static task_params_t task_list[] = {
     {
@@ -112,6 +116,14 @@ static task_params_t task_list[] = {
             .priority = osPriorityAboveNormal
         }
     },
+    {
+        .task_func = task_illum_run,
+        .task_attrs = {
+            .name = "illum",
+            .stack_size = TASK_ILLUM_STACK_SIZE,
+            .priority = osPriorityNormal
+        }
+    },
     {
         .task_func = task_meter_probe_run,
         .task_attrs = {
@@ -127,6 +139,30 @@ static task_params_t task_list[] = {
             .stack_size = TASK_METER_PROBE_STACK_SIZE,
             .priority = osPriorityNormal
         }
+    },
+    {
+        .task_func = task_display_run,
+        .task_attrs = {
+            .name = "display",
+            .stack_size = TASK_DISPLAY_STACK_SIZE,
+            .priority = osPriorityNormal
+        }
+    },
+    {
+        .task_func = task_settings_run,
+        .task_attrs = {
+            .name = "settings",
+            .stack_size = TASK_SETTINGS_STACK_SIZE,
+            .priority = osPriorityBelowNormal
+        }
+    },
+    {
+        .task_func = task_screenshot_run,
+        .task_attrs = {
+            .name = "screenshot",
+            .stack_size = TASK_SCREENSHOT_STACK_SIZE,
+            .priority = osPriorityBelowNormal
+        }
     }
 };
 
@@ -434,6 +470,11 @@ void main_task_shutdown()
     /* Put the keypad controller into the reset state */
     HAL_GPIO_WritePin(KEY_RESET_GPIO_Port, KEY_RESET_Pin, GPIO_PIN_RESET);
 
+    /* Write out any pending settings changes */
+    if (settings_flush() != HAL_OK) {
+        log_w("Some settings changes were not saved");
+    }
+
     /* Wait for things to settle */
     osDelay(200);
 
@@ -21,6 +21,7 @@
 #include "dens_remote.h"
 #include "usb_host.h"
 #include "dmx.h"
+#include "rdm.h"
 #include "util.h"
 
 static menu_result_t diagnostics_keypad();
@@ -28,7 +29,10 @@ static menu_result_t diagnostics_led();
 static menu_result_t diagnostics_buzzer();
 static menu_result_t diagnostics_relay();
 static menu_result_t diagnostics_dmx512();
+static menu_result_t diagnostics_dmx512_timing();
+static menu_result_t diagnostics_dmx512_rdm();
 static menu_result_t diagnostics_densitometer();
+static menu_result_t diagnostics_display_updates();
 
 menu_result_t menu_diagnostics()
 {
@@ -43,7 +47,10 @@ menu_result_t menu_diagnostics()
                 "Buzzer Test\n"
                 "Relay Test\n"
                 "DMX512 Control Test\n"
-                "Densitometer Test");
+                "DMX512 Frame Timing\n"
+                "DMX512 RDM Devices\n"
+                "Densitometer Test\n"
+                "Display Updates");
 
         if (option == 1) {
             menu_result = diagnostics_keypad();
@@ -56,7 +63,13 @@ menu_result_t menu_diagnostics()
         } else if (option == 5) {
             menu_result = diagnostics_dmx512();
         } else if (option == 6) {
+            menu_result = diagnostics_dmx512_timing();
+        } else if (option == 7) {
+            menu_result = diagnostics_dmx512_rdm();
+        } else if (option == 8) {
             menu_result = diagnostics_densitometer();
+        } else if (option == 9) {
+            menu_result = diagnostics_display_updates();
         } else if (option == UINT8_MAX) {
             menu_result = MENU_TIMEOUT;
         }
@@ -619,6 +632,153 @@ menu_result_t diagnostics_dmx512()
     return MENU_OK;
 }
 
+menu_result_t diagnostics_dmx512_timing()
+{
+    char buf[256];
+    dmx_frame_stats_t stats;
+    dmx_latency_stats_t latency_stats;
+    bool show_isr = false;
+
+    for (;;) {
+        dmx_get_frame_stats(&stats);
+        dmx_get_latency_stats(&latency_stats);
+
+        if (show_isr) {
+            const uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+            const uint32_t isr_x100 = (stats.sent > 0) ? (uint32_t)(((uint64_t)stats.total_isr * 100) / stats.sent) : 0;
+            const uint32_t isr_ns = (stats.sent > 0) ? (uint32_t)((stats.total_isr_cycles * 1000) / ((uint64_t)stats.sent * cycles_per_us)) : 0;
+
+            sprintf(buf,
+                "Break = %s\n"
+                "Sent = %lu\n"
+                "ISR/frame = %lu.%02lu, Max = %lu\n"
+                "ISR time = %luns\n"
+                "Max time = %luns",
+                dmx_is_uart_break() ? "UART" : "Timer",
+                stats.sent,
+                isr_x100 / 100, isr_x100 % 100, stats.max_isr,
+                isr_ns,
+                (stats.max_isr_cycles * 1000) / cycles_per_us);
+        } else {
+            const uint64_t total_us = stats.total_send_us + stats.total_busy_us + stats.total_idle_us;
+            const uint32_t busy_pct = (total_us > 0) ? (uint32_t)(((stats.total_send_us + stats.total_busy_us) * 100) / total_us) : 0;
+
+            sprintf(buf,
+                "Frames = %lu, Late = %lu\n"
+                "Period = %lu/%lu/%luus\n"
+                "Send = %lu/%luus, Busy = %lu%%\n"
+                "Latency = %lu/%luus\n"
+                "Last = %lu, %lu, %lu us",
+                stats.count, stats.late,
+                stats.min_period_us,
+                (stats.count > 0) ? (uint32_t)(stats.total_period_us / stats.count) : 0UL,
+                stats.max_period_us,
+                (stats.count > 0) ? (uint32_t)(stats.total_send_us / stats.count) : 0UL,
+                stats.max_send_us, busy_pct,
+                (latency_stats.count > 0) ? (uint32_t)(latency_stats.total_us / latency_stats.count) : 0UL,
+                latency_stats.max_us,
+                stats.history_us[DMX_FRAME_HISTORY_SIZE - 3],
+                stats.history_us[DMX_FRAME_HISTORY_SIZE - 2],
+                stats.history_us[DMX_FRAME_HISTORY_SIZE - 1]);
+        }
+        display_static_list("DMX512 Frame Timing", buf);
+
+        keypad_event_t keypad_event;
+        if (keypad_wait_for_event(&keypad_event, 500) == HAL_OK) {
+            if (keypad_is_key_released_or_repeated(&keypad_event, KEYPAD_START)) {
+                dmx_reset_frame_stats();
+                dmx_reset_latency_stats();
+            } else if (keypad_is_key_released_or_repeated(&keypad_event, KEYPAD_INC_EXPOSURE)
+                || keypad_is_key_released_or_repeated(&keypad_event, KEYPAD_DEC_EXPOSURE)) {
+                show_isr = !show_isr;
+            } else if (keypad_is_key_released_or_repeated(&keypad_event, KEYPAD_FOCUS) && show_isr) {
+                /* Switch how the BREAK is generated, to compare the interrupt load */
+                dmx_set_uart_break(!dmx_is_uart_break());
+                dmx_reset_frame_stats();
+                dmx_reset_latency_stats();
+            } else if (keypad_event.key == KEYPAD_CANCEL && !keypad_event.pressed) {
+                break;
+            } else if (keypad_event.key == KEYPAD_USB_KEYBOARD && keypad_event.pressed
+                && keypad_usb_get_keypad_equivalent(&keypad_event) == KEYPAD_CANCEL) {
+                break;
+            }
+        }
+    }
+
+    return MENU_OK;
+}
+
+menu_result_t diagnostics_dmx512_rdm()
+{
+    char buf[256];
+    rdm_uid_t uids[5];
+    size_t count = 0;
+    rdm_result_t result;
+
+    /* RDM needs the port enabled, but not necessarily sending frames */
+    if (dmx_get_port_state() == DMX_PORT_DISABLED) {
+        if (dmx_enable() != osOK) {
+            log_w("Unable to enable DMX512 port");
+            return MENU_OK;
+        }
+    }
+
+    for (;;) {
+        display_static_list("DMX512 RDM Devices", "\n\nSearching...");
+
+        result = rdm_discover(uids, sizeof(uids) / sizeof(rdm_uid_t), &count);
+
+        size_t offset = 0;
+        if (result != RDM_RESULT_OK) {
+            sprintf(buf, "\n\nDiscovery failed:\n%s", rdm_result_str(result));
+        } else if (count == 0) {
+            sprintf(buf, "\n\nNo devices found");
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                rdm_device_info_t info;
+                result = rdm_get_device_info(uids[i], &info);
+                if (result == RDM_RESULT_OK) {
+                    offset += sprintf(buf + offset, "%04X:%08lX @%03d+%d M%04X",
+                        RDM_UID_MANUFACTURER(uids[i]), RDM_UID_DEVICE(uids[i]),
+                        (info.start_address <= 512) ? info.start_address : 0,
+                        info.footprint, info.model_id);
+                } else {
+                    offset += sprintf(buf + offset, "%04X:%08lX %s",
+                        RDM_UID_MANUFACTURER(uids[i]), RDM_UID_DEVICE(uids[i]),
+                        rdm_result_str(result));
+                }
+                if (i < count - 1) {
+                    buf[offset++] = '\n';
+                    buf[offset] = '\0';
+                }
+            }
+        }
+
+        display_static_list("DMX512 RDM Devices", buf);
+
+        keypad_event_t keypad_event;
+        bool done = false;
+        while (!done) {
+            if (keypad_wait_for_event(&keypad_event, -1) == HAL_OK) {
+                if (keypad_is_key_released_or_repeated(&keypad_event, KEYPAD_START)) {
+                    break;
+                } else if (keypad_event.key == KEYPAD_CANCEL && !keypad_event.pressed) {
+                    done = true;
+                } else if (keypad_event.key == KEYPAD_USB_KEYBOARD && keypad_event.pressed
+                    && keypad_usb_get_keypad_equivalent(&keypad_event) == KEYPAD_CANCEL) {
+                    done = true;
+                }
+            }
+        }
+        if (done) { break; }
+    }
+
+    /* Reset the DMX controller state */
+    illum_controller_refresh();
+
+    return MENU_OK;
+}
+
 menu_result_t diagnostics_densitometer()
 {
     char buf[512];
@@ -673,3 +833,32 @@ menu_result_t diagnostics_densitometer()
     }
     return MENU_OK;
 }
+
+menu_result_t diagnostics_display_updates()
+{
+    char buf[128];
+    display_update_stats_t update_stats;
+
+    for (;;) {
+        display_get_update_stats(&update_stats);
+
+        sprintf(buf,
+            "Submitted = %lu\n"
+            "Rendered = %lu\n"
+            "Dropped = %lu",
+            update_stats.submitted, update_stats.rendered, update_stats.dropped);
+        display_static_list("Display Updates", buf);
+
+        keypad_event_t keypad_event;
+        if (keypad_wait_for_event(&keypad_event, 500) == HAL_OK) {
+            if (keypad_event.key == KEYPAD_CANCEL && !keypad_event.pressed) {
+                break;
+            } else if (keypad_event.key == KEYPAD_USB_KEYBOARD && keypad_event.pressed
+                && keypad_usb_get_keypad_equivalent(&keypad_event) == KEYPAD_CANCEL) {
+                break;
+            }
+        }
+    }
+
+    return MENU_OK;
+}
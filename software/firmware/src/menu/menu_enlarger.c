@@ -50,6 +50,7 @@ menu_result_t menu_enlarger_configs(state_controller_t *controller)
     size_t offset;
     bool reload_configs = true;
     uint8_t config_default_index = 0;
+    uint8_t config_secondary_index = UINT8_MAX;
     size_t config_count = 0;
     uint8_t option = 1;
     do {
@@ -57,6 +58,7 @@ menu_result_t menu_enlarger_configs(state_controller_t *controller)
         if (reload_configs) {
             config_count = 0;
             config_default_index = settings_get_default_enlarger_config_index();
+            config_secondary_index = settings_get_secondary_enlarger_config_index();
             for (size_t i = 0; i < MAX_ENLARGER_CONFIGS; i++) {
                 if (!settings_get_enlarger_config_name(config_name_list + (i * PROFILE_NAME_LEN), i)) {
                     break;
@@ -70,14 +72,11 @@ menu_result_t menu_enlarger_configs(state_controller_t *controller)
 
         for (size_t i = 0; i < config_count; i++) {
             const char *config_name = config_name_list + (i * PROFILE_NAME_LEN);
+            const char marker = (i == config_default_index) ? 187 : ((i == config_secondary_index) ? '+' : ' ');
             if (config_name && strlen(config_name) > 0) {
-                sprintf(buf + offset, "%c %s",
-                    ((i == config_default_index) ? 187 : ' '),
-                    config_name);
+                sprintf(buf + offset, "%c %s", marker, config_name);
             } else {
-                sprintf(buf + offset, "%c Enlarger profile %d",
-                    ((i == config_default_index) ? 187 : ' '),
-                    i + 1);
+                sprintf(buf + offset, "%c Enlarger profile %d", marker, i + 1);
             }
             offset += pad_str_to_length(buf + offset, ' ', DISPLAY_MENU_ROW_LENGTH);
             if (i < config_count) {
@@ -139,10 +138,17 @@ menu_result_t menu_enlarger_configs(state_controller_t *controller)
                     menu_enlarger_delete_config(config_index, config_count);
                     reload_configs = true;
                 }
+
+                /* The secondary head can be changed from within the editor */
+                config_secondary_index = settings_get_secondary_enlarger_config_index();
             } else if (option_key == KEYPAD_ADD_ADJUSTMENT) {
                 log_i("Set default config at index: %d", config_index);
                 settings_set_default_enlarger_config_index(config_index);
                 config_default_index = option - 1;
+                if (config_secondary_index == config_index) {
+                    settings_set_secondary_enlarger_config_index(UINT8_MAX);
+                    config_secondary_index = UINT8_MAX;
+                }
             }
         }
     } while (option > 0 && menu_result != MENU_TIMEOUT);
@@ -184,6 +190,13 @@ void menu_enlarger_delete_config(uint8_t index, size_t config_count)
     } else if (default_config_index > index) {
         settings_set_default_enlarger_config_index(default_config_index - 1);
     }
+
+    uint8_t secondary_config_index = settings_get_secondary_enlarger_config_index();
+    if (secondary_config_index == index) {
+        settings_set_secondary_enlarger_config_index(UINT8_MAX);
+    } else if (secondary_config_index != UINT8_MAX && secondary_config_index > index) {
+        settings_set_secondary_enlarger_config_index(secondary_config_index - 1);
+    }
 }
 
 menu_result_t menu_enlarger_config_edit(enlarger_config_t *config, uint8_t index)
@@ -205,6 +218,15 @@ menu_result_t menu_enlarger_config_edit(enlarger_config_t *config, uint8_t index
     do {
         size_t offset = 0;
 
+        /*
+         * Relay profiles have a contrast filter row, and saved DMX
+         * profiles have a secondary head row, in the same position.
+         * The secondary head is a setting in its own right rather than
+         * part of the profile, so it takes effect as soon as it changes.
+         */
+        const bool has_secondary_row = config->control.dmx_control && index != UINT8_MAX;
+        const uint8_t test_option = (!config->control.dmx_control || has_secondary_row) ? 5 : 4;
+
         offset += menu_build_padded_str_row(buf + offset, "Name", config->name);
         offset += menu_build_padded_str_row(buf + offset, "Power control", config->control.dmx_control ? "DMX" : "Relay");
         offset += menu_build_padded_str_row(buf + offset, "Timing profile", "\xB7\xB7\xB7");
@@ -212,6 +234,16 @@ menu_result_t menu_enlarger_config_edit(enlarger_config_t *config, uint8_t index
         if (!config->control.dmx_control) {
             offset += menu_build_padded_str_row(buf + offset, "Contrast filters",
                 contrast_filter_name_str(config->contrast_filter));
+        } else if (has_secondary_row) {
+            const char *value_str;
+            if (index == settings_get_default_enlarger_config_index()) {
+                value_str = "Default";
+            } else if (index == settings_get_secondary_enlarger_config_index()) {
+                value_str = "Yes";
+            } else {
+                value_str = "No";
+            }
+            offset += menu_build_padded_str_row(buf + offset, "Secondary head", value_str);
         }
 
         offset += sprintf(buf + offset, "*** Test Enlarger ***\n");
@@ -275,7 +307,18 @@ menu_result_t menu_enlarger_config_edit(enlarger_config_t *config, uint8_t index
                     config_dirty = true;
                 }
             }
-        } else if (option == (config->control.dmx_control ? 4 : 5)) {
+        } else if (has_secondary_row && option == 4) {
+            /* Toggle the secondary head, which is driven alongside the default */
+            if (index == settings_get_default_enlarger_config_index()) {
+                continue;
+            } else if (index == settings_get_secondary_enlarger_config_index()) {
+                log_i("Clear secondary config");
+                settings_set_secondary_enlarger_config_index(UINT8_MAX);
+            } else {
+                log_i("Set secondary config at index: %d", index);
+                settings_set_secondary_enlarger_config_index(index);
+            }
+        } else if (option == test_option) {
             /* Test Enlarger */
             menu_result_t sub_result;
             if (config->control.dmx_control) {
@@ -286,7 +329,7 @@ menu_result_t menu_enlarger_config_edit(enlarger_config_t *config, uint8_t index
             if (sub_result == MENU_TIMEOUT) {
                 menu_result = MENU_TIMEOUT;
             }
-        } else if (option == (config->control.dmx_control ? 5 : 6)) {
+        } else if (option == test_option + 1) {
             log_d("Run calibration from profile editor");
             uint8_t sub_option = display_message(
                 "Run Timing Calibration?\n",
@@ -315,7 +358,7 @@ menu_result_t menu_enlarger_config_edit(enlarger_config_t *config, uint8_t index
                 /* Return assuming no timeout */
                 continue;
             }
-        } else if (option == (config->control.dmx_control ? 6 : 7)) {
+        } else if (option == test_option + 2) {
             log_d("Delete config from config editor");
             if (menu_enlarger_config_delete_prompt(config, index)) {
                 menu_result = MENU_DELETE;
@@ -446,6 +489,15 @@ menu_result_t menu_enlarger_config_control_edit(enlarger_control_t *enlarger_con
                 }
                 has_contrast_grades = false;
             }
+
+            if (enlarger_control->ramp_time > 0) {
+                offset += menu_build_padded_format_row(buf + offset,
+                    "Fade time", "%s %dms",
+                    (enlarger_control->ramp_curve == ENLARGER_RAMP_CURVE_GAMMA) ? "Gamma" : "Linear",
+                    enlarger_control->ramp_time);
+            } else {
+                offset += menu_build_padded_str_row(buf + offset, "Fade time", "Off");
+            }
         } else {
             has_rgb_channels = false;
             has_contrast_grades = false;
@@ -746,6 +798,41 @@ menu_result_t menu_enlarger_config_control_edit(enlarger_control_t *enlarger_con
                     }
                 }
             }
+        } else if (enlarger_control->dmx_control && option == (has_rgb_channels ? 9 : 7)) {
+            uint16_t value_sel = enlarger_control->ramp_time;
+            if (display_input_value_u16(
+                "Fade Time",
+                "Time to fade between light\n"
+                "levels, or 0 to switch them\n"
+                "immediately.\n",
+                "", &value_sel, 0, ENLARGER_RAMP_TIME_MAX, 4, "ms") == UINT8_MAX) {
+                menu_result = MENU_TIMEOUT;
+            } else {
+                enlarger_ramp_curve_t ramp_curve = enlarger_control->ramp_curve;
+                if (value_sel > 0) {
+                    if (ramp_curve > ENLARGER_RAMP_CURVE_GAMMA) { ramp_curve = 0; }
+
+                    uint8_t sub_option = display_selection_list(
+                        "Fade Curve", ramp_curve + 1,
+                        "Linear\n"
+                        "Gamma");
+
+                    if (sub_option > 0 && sub_option < UINT8_MAX) {
+                        ramp_curve = sub_option - 1;
+                    } else if (sub_option == UINT8_MAX) {
+                        menu_result = MENU_TIMEOUT;
+                        break;
+                    } else {
+                        continue;
+                    }
+                }
+
+                if (value_sel != enlarger_control->ramp_time || ramp_curve != enlarger_control->ramp_curve) {
+                    enlarger_control->ramp_time = value_sel;
+                    enlarger_control->ramp_curve = ramp_curve;
+                    config_dirty = true;
+                }
+            }
         } else if (option == 0 && config_dirty) {
             menu_result = MENU_SAVE;
         } else if (option == UINT8_MAX) {
@@ -29,6 +29,11 @@
  */
 #define CONF_FILENAME "printalyzer-conf.dat"
 
+/*
+ * Default filename for binary settings backups.
+ */
+#define BACKUP_FILENAME "printalyzer-backup.bin"
+
 /*
  * Maximum allowed size of the configuration file, since the entire file
  * is loaded into memory for parsing. If anything bigger is required, then
@@ -82,6 +87,9 @@ static bool write_section_enlargers(FIL *fp);
 static bool write_section_papers(FIL *fp);
 static bool write_section_step_wedge(FIL *fp);
 
+static menu_result_t menu_backup_settings();
+static menu_result_t menu_restore_settings(state_controller_t *controller);
+
 menu_result_t menu_import_export(state_controller_t *controller)
 {
     log_i("Import/Export menu");
@@ -93,12 +101,18 @@ menu_result_t menu_import_export(state_controller_t *controller)
         option = display_selection_list(
                 "Import / Export Configuration", option,
                 "Import from USB device\n"
-                "Export to USB device");
+                "Export to USB device\n"
+                "Backup to USB device\n"
+                "Restore from USB device");
 
         if (option == 1) {
             menu_result = menu_import_config(controller);
         } else if (option == 2) {
             menu_result = menu_export_config();
+        } else if (option == 3) {
+            menu_result = menu_backup_settings();
+        } else if (option == 4) {
+            menu_result = menu_restore_settings(controller);
         } else if (option == UINT8_MAX) {
             menu_result = MENU_TIMEOUT;
         }
@@ -270,8 +284,14 @@ bool import_config_file(const char *filename, bool *reload_paper)
             if (!pair.key) { continue; }
 
             if (strncmp("settings", pair.key, pair.keyLength) == 0 && pair.jsonType == JSONObject) {
-                if (file_properties.has_settings) {
-                    import_section_settings(pair.value, pair.valueLength, &enlarger_config_index, &paper_profile_index);
+                if (file_properties.has_settings
+                    && !import_section_settings(pair.value, pair.valueLength, &enlarger_config_index, &paper_profile_index)) {
+                    display_message(
+                        "Import from USB device",
+                        NULL,
+                        "\n"
+                        "Settings section could not\n"
+                        "be imported.\n", " OK ");
                 }
             } else if (strncmp("safelight", pair.key, pair.keyLength) == 0 && pair.jsonType == JSONObject) {
                 if (file_properties.has_safelight) {
@@ -298,6 +318,9 @@ bool import_config_file(const char *filename, bool *reload_paper)
     } while (0);
 
     /* Set default indices for enlarger and paper sections */
+    if (file_properties.has_enlargers && imported_enlargers > 0) {
+        settings_set_secondary_enlarger_config_index(UINT8_MAX);
+    }
     if (file_properties.has_enlargers && imported_enlargers > 0 && enlarger_config_index >= 0) {
         if (enlarger_config_index < imported_enlargers) {
             settings_set_default_enlarger_config_index(enlarger_config_index);
@@ -542,7 +565,9 @@ bool import_section_settings(const char *buf, size_t len, int *enlarger_config_i
      * This code only does the most basic of validation, relying on the
      * settings API to implement stricter validation before actually saving
      * the values.
+     * All the values are saved together, once the section is complete.
      */
+    settings_begin_config_edit();
     status = JSON_Iterate(buf, len, &start, &next, &pair);
     while (status == JSONSuccess) {
         if (pair.key) {
@@ -609,6 +634,10 @@ bool import_section_settings(const char *buf, size_t len, int *enlarger_config_i
         }
         status = JSON_Iterate(buf, len, &start, &next, &pair);
     }
+    if (!settings_commit_config_edit()) {
+        log_e("Unable to save imported settings");
+        return false;
+    }
 
     return true;
 }
@@ -825,6 +854,16 @@ void parse_section_enlarger_control(const char *buf, size_t len, enlarger_contro
                 }
             } else if (strncmp("grade_values", pair.key, pair.keyLength) == 0 && pair.jsonType == JSONArray) {
                 parse_section_enlarger_control_grade_values(pair.value, pair.valueLength, control);
+            } else if (strncmp("ramp_time", pair.key, pair.keyLength) == 0 && pair.jsonType == JSONNumber) {
+                int num = json_parse_int(pair.value, pair.valueLength, -1);
+                if (num >= 0 && num <= ENLARGER_RAMP_TIME_MAX) {
+                    control->ramp_time = num;
+                }
+            } else if (strncmp("ramp_curve", pair.key, pair.keyLength) == 0 && pair.jsonType == JSONNumber) {
+                int num = json_parse_int(pair.value, pair.valueLength, -1);
+                if (num >= 0 && num <= ENLARGER_RAMP_CURVE_GAMMA) {
+                    control->ramp_curve = num;
+                }
             }
         }
         status = JSON_Iterate(buf, len, &start, &next, &pair);
@@ -1338,6 +1377,8 @@ bool write_section_enlargers(FIL *fp)
             json_write(fp, 8, "contrast_mode", config.control.contrast_mode, true);
             json_write(fp, 8, "focus_value", config.control.focus_value, true);
             json_write(fp, 8, "safe_value", config.control.safe_value, true);
+            json_write(fp, 8, "ramp_time", config.control.ramp_time, true);
+            json_write(fp, 8, "ramp_curve", config.control.ramp_curve, true);
             f_printf(fp, "        \"grade_values\": [\n");
             for (j = 0; j < CONTRAST_WHOLE_GRADE_COUNT; j++) {
                 if (j > 0) {
@@ -1449,3 +1490,144 @@ bool write_section_step_wedge(FIL *fp)
     step_wedge_free(wedge);
     return true;
 }
+
+menu_result_t menu_backup_settings()
+{
+    char buf[256];
+    char filename[32];
+    uint8_t option;
+    FRESULT res;
+    FIL fp;
+    bool success = false;
+
+    if (!usb_msc_is_mounted()) {
+        option = display_message(
+                "Backup to USB device",
+                NULL,
+                "\n"
+                "Please insert a USB storage\n"
+                "device and try again.\n", " OK ");
+        if (option == UINT8_MAX) {
+            return MENU_TIMEOUT;
+        } else {
+            return MENU_OK;
+        }
+    }
+
+    strcpy(filename, BACKUP_FILENAME);
+    do {
+        if (display_input_text("Backup File Name", filename, sizeof(filename)) == 0) {
+            return MENU_OK;
+        }
+    } while (scrub_export_filename(filename, ".bin"));
+
+    memset(&fp, 0, sizeof(FIL));
+    res = f_open(&fp, filename, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res == FR_OK) {
+        success = settings_snapshot_save(&fp);
+        if (f_close(&fp) != FR_OK) {
+            success = false;
+        }
+    } else {
+        log_e("Error opening backup file: %d", res);
+    }
+
+    if (success) {
+        sprintf(buf,
+            "\n"
+            "Settings backed up to file:\n"
+            "%s\n", filename);
+        option = display_message(
+            "Backup to USB device",
+            NULL, buf, " OK ");
+    } else {
+        option = display_message(
+            "Backup to USB device",
+            NULL,
+            "\n"
+            "Unable to back up settings!\n", " OK ");
+    }
+
+    if (option == UINT8_MAX) {
+        return MENU_TIMEOUT;
+    } else {
+        return MENU_OK;
+    }
+}
+
+menu_result_t menu_restore_settings(state_controller_t *controller)
+{
+    char path_buf[256];
+    uint8_t option;
+    FRESULT res;
+    FIL fp;
+    bool success = false;
+
+    if (!usb_msc_is_mounted()) {
+        option = display_message(
+                "Restore from USB device",
+                NULL,
+                "\n"
+                "Please insert a USB storage\n"
+                "device and try again.\n", " OK ");
+        if (option == UINT8_MAX) {
+            return MENU_TIMEOUT;
+        } else {
+            return MENU_OK;
+        }
+    }
+
+    option = file_picker_show("Select Backup File", path_buf, sizeof(path_buf), NULL);
+    if (option == MENU_TIMEOUT) {
+        return MENU_TIMEOUT;
+    } else if (option != MENU_OK) {
+        return MENU_OK;
+    }
+
+    option = display_message(
+        "Restore from USB device",
+        NULL,
+        "\n"
+        "Replace all current settings\n"
+        "with the selected backup?\n", " Yes \n No ");
+    if (option == UINT8_MAX) {
+        return MENU_TIMEOUT;
+    } else if (option != 1) {
+        return MENU_OK;
+    }
+
+    memset(&fp, 0, sizeof(FIL));
+    res = f_open(&fp, path_buf, FA_READ | FA_OPEN_EXISTING);
+    if (res == FR_OK) {
+        success = settings_snapshot_restore(&fp);
+        f_close(&fp);
+    } else {
+        log_e("Error opening backup file: %d", res);
+    }
+
+    if (success) {
+        option = display_message(
+            "Restore from USB device",
+            NULL,
+            "\n"
+            "Settings restored from backup\n", " OK ");
+    } else {
+        option = display_message(
+            "Restore from USB device",
+            NULL,
+            "\n"
+            "Settings were not restored\n", " OK ");
+    }
+
+    /* Reload active profiles that may have changed */
+    state_controller_reload_enlarger_config(controller);
+    state_controller_reload_paper_profile(controller, true);
+
+    illum_controller_refresh();
+
+    if (option == UINT8_MAX) {
+        return MENU_TIMEOUT;
+    } else {
+        return MENU_OK;
+    }
+}
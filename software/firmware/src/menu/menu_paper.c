@@ -715,6 +715,7 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
     float *patch_density = NULL;
     uint8_t option = 1;
     int32_t calibration_pev = 0;
+    uint32_t page_start = 0;
 
     const float display_dmin = paper_dmin;
     const float display_dmax = paper_dmax;
@@ -743,7 +744,7 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
     }
 
     /* Allocate a buffer for the menu text */
-    buf = pvPortMalloc((wedge->step_count * (sizeof(char) * 33)) + (5 * 33));
+    buf = pvPortMalloc((STEP_WEDGE_MENU_PAGE_STEP_COUNT * (sizeof(char) * 33)) + (7 * 33));
     if (!buf) {
         vPortFree(patch_density);
         vPortFree(wedge);
@@ -755,14 +756,21 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
         patch_density[i] = NAN;
     }
 
-    dens_data->min_option = 5;
-    dens_data->max_option = (5 + wedge->step_count) - 1;
-    dens_data->alt_option = UINT8_MAX;
-
     do {
         size_t offset = 0;
         size_t name_len = MIN(strlen(wedge->name), 20);
 
+        /* Wedges with many steps are shown a page at a time */
+        const uint32_t page_count = MIN(wedge->step_count - page_start, STEP_WEDGE_MENU_PAGE_STEP_COUNT);
+        uint8_t list_option = 4 + page_count;
+        const uint8_t prev_option = (page_start > 0) ? ++list_option : 0;
+        const uint8_t next_option = (page_start + page_count < wedge->step_count) ? ++list_option : 0;
+        const uint8_t calculate_option = ++list_option;
+
+        dens_data->min_option = 5;
+        dens_data->max_option = (5 + page_count) - 1;
+        dens_data->alt_option = UINT8_MAX;
+
         strcpy(buf, "Step wedge ");
         offset = pad_str_to_length(buf, ' ', DISPLAY_MENU_ROW_LENGTH - (name_len + 2));
         buf[offset++] = '{';
@@ -798,20 +806,26 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
                 "Print Exposure Value       [---]\n");
         }
 
-        for (uint32_t i = 0; i < wedge->step_count; i++) {
+        for (uint32_t i = page_start; i < page_start + page_count; i++) {
             if (is_valid_number(patch_density[i]) && patch_density[i] >= paper_dmin) {
                 offset += sprintf(buf + offset,
-                    "Step %-2lu        {D=%0.02f} [D=%0.02f]\n",
+                    "Step %-3lu       {D=%0.02f} [D=%0.02f]\n",
                     i + 1,
                     step_wedge_get_density(wedge, i),
                     patch_density[i]);
             } else {
                 offset += sprintf(buf + offset,
-                    "Step %-2lu        {D=%0.02f} [------]\n",
+                    "Step %-3lu       {D=%0.02f} [------]\n",
                     i + 1,
                     step_wedge_get_density(wedge, i));
             }
         }
+        if (prev_option) {
+            offset += sprintf(buf + offset, "*** Previous Steps ***\n");
+        }
+        if (next_option) {
+            offset += sprintf(buf + offset, "*** Next Steps ***\n");
+        }
         sprintf(buf + offset, "*** Calculate Profile ***");
 
         option = display_selection_list_cb(title, option, buf,
@@ -859,8 +873,8 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
             } else {
                 calibration_pev = value_sel;
             }
-        } else if (option >= 5 && option < 5 + wedge->step_count) {
-            int step_index = option - 5;
+        } else if (option >= 5 && option < 5 + page_count) {
+            const uint32_t step_index = page_start + option - 5;
 
             /* Constrain the input based on Dmin and Dmax */
             uint16_t min_value = lroundf(paper_dmin * 100);
@@ -875,14 +889,20 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
                     patch_density[step_index] = (float)dens_data->reading / 100.0F;
                 }
 
-                option++;
+                if (option == (5 + page_count) - 1 && next_option) {
+                    /* Continue measuring at the top of the next page */
+                    page_start += STEP_WEDGE_MENU_PAGE_STEP_COUNT;
+                    option = 5;
+                } else {
+                    option++;
+                }
             } else {
                 uint8_t patch_option;
                 char patch_title_buf[32];
                 char patch_buf[128];
-                sprintf(patch_title_buf, "Step %d", step_index + 1);
+                sprintf(patch_title_buf, "Step %lu", step_index + 1);
                 sprintf(patch_buf,
-                    "\nMeasured density at patch %d\n"
+                    "\nMeasured density at patch %lu\n"
                     "of the exposed paper.\n",
                     step_index + 1);
 
@@ -914,7 +934,13 @@ menu_result_t menu_paper_profile_calibrate_grade(state_controller_t *controller,
                     menu_result = MENU_TIMEOUT;
                 }
             }
-        } else if (option == 5 + wedge->step_count) {
+        } else if (option > 0 && option == prev_option) {
+            page_start -= STEP_WEDGE_MENU_PAGE_STEP_COUNT;
+            option = 5;
+        } else if (option > 0 && option == next_option) {
+            page_start += STEP_WEDGE_MENU_PAGE_STEP_COUNT;
+            option = 5;
+        } else if (option == calculate_option) {
             menu_result_t val_result;
             log_i("Calculate profile");
 
@@ -52,7 +52,7 @@ menu_result_t menu_step_wedge()
         offset += menu_build_padded_str_row(buf, "Name", wedge->name);
 
         offset += sprintf(buf + offset,
-            "Steps                       [%2lu]\n"
+            "Steps                      [%3lu]\n"
             "Base density            [D=%0.02f]\n"
             "Density increment       [D=%0.02f]\n",
             wedge->step_count,
@@ -75,12 +75,12 @@ menu_result_t menu_step_wedge()
         if (option == 1) {
             display_input_text("Step Wedge Name", wedge->name, PROFILE_NAME_LEN);
         } else if (option == 2) {
-            uint8_t value_sel = wedge->step_count;
-            if (display_input_value(
+            uint16_t value_sel = wedge->step_count;
+            if (display_input_value_u16(
                 "Step Count",
                 "\nNumber of distinct patches\n"
                 "on the step wedge.\n",
-                "", &value_sel, MIN_STEP_WEDGE_STEP_COUNT, MAX_STEP_WEDGE_STEP_COUNT, 2, " steps") == UINT8_MAX) {
+                "", &value_sel, MIN_STEP_WEDGE_STEP_COUNT, MAX_STEP_WEDGE_STEP_COUNT, 3, " steps") == UINT8_MAX) {
                 menu_result = MENU_TIMEOUT;
             }
             if (value_sel != wedge->step_count) {
@@ -233,8 +233,9 @@ menu_result_t menu_step_wedge_calibration(step_wedge_t *wedge)
     size_t offset = 0;
     char *buf = NULL;
     input_poll_params_t poll_params = {0};
+    uint32_t page_start = 0;
 
-    buf = pvPortMalloc((wedge->step_count * (sizeof(char) * 33)) + 64);
+    buf = pvPortMalloc((STEP_WEDGE_MENU_PAGE_STEP_COUNT * (sizeof(char) * 33)) + (3 * 33));
     if (!buf) {
         return MENU_OK;
     }
@@ -249,14 +250,21 @@ menu_result_t menu_step_wedge_calibration(step_wedge_t *wedge)
         prev_density[i] = wedge->step_density[i];
     }
 
-    poll_params.min_option = 1;
-    poll_params.max_option = wedge->step_count;
-
     do {
+        /* Wedges with many steps are shown a page at a time */
+        const uint32_t page_count = MIN(wedge->step_count - page_start, STEP_WEDGE_MENU_PAGE_STEP_COUNT);
+        uint8_t list_option = page_count;
+        const uint8_t prev_option = (page_start > 0) ? ++list_option : 0;
+        const uint8_t next_option = (page_start + page_count < wedge->step_count) ? ++list_option : 0;
+        const uint8_t reset_option = ++list_option;
+
+        poll_params.min_option = 1;
+        poll_params.max_option = page_count;
+
         densitometer_enable(DENSITOMETER_MODE_TRANSMISSION);
 
         offset = 0;
-        for (uint32_t i = 0; i < wedge->step_count; i++) {
+        for (uint32_t i = page_start; i < page_start + page_count; i++) {
             bool is_calibrated;
             if (isnormal(wedge->step_density[i]) || fpclassify(wedge->step_density[i]) == FP_ZERO) {
                 is_calibrated = true;
@@ -265,12 +273,18 @@ menu_result_t menu_step_wedge_calibration(step_wedge_t *wedge)
             }
 
             offset += sprintf(buf + offset,
-                "Step %-2lu                 %cD=%0.02f%c\n",
+                "Step %-3lu                %cD=%0.02f%c\n",
                 i + 1,
                 (is_calibrated ? '[' : '{'),
                 step_wedge_get_density(wedge, i),
                 (is_calibrated ? ']' : '}'));
         }
+        if (prev_option) {
+            offset += sprintf(buf + offset, "*** Previous Steps ***\n");
+        }
+        if (next_option) {
+            offset += sprintf(buf + offset, "*** Next Steps ***\n");
+        }
         sprintf(buf + offset, "*** Reset Values ***");
 
         if (strlen(wedge->name) > 0) {
@@ -281,20 +295,27 @@ menu_result_t menu_step_wedge_calibration(step_wedge_t *wedge)
                 menu_step_wedge_densitometer_input_poll_callback, &poll_params);
         }
 
-        if (option > 0 && option <= wedge->step_count) {
+        if (option > 0 && option <= page_count) {
+            const uint32_t step_index = page_start + option - 1;
             if (poll_params.reading != UINT16_MAX) {
-                wedge->step_density[option - 1] = (float)poll_params.reading / 100.0F;
-                option++;
+                wedge->step_density[step_index] = (float)poll_params.reading / 100.0F;
+                if (option == page_count && next_option) {
+                    /* Continue measuring at the top of the next page */
+                    page_start += STEP_WEDGE_MENU_PAGE_STEP_COUNT;
+                    option = 1;
+                } else {
+                    option++;
+                }
             } else {
                 uint8_t patch_option;
                 char patch_title_buf[32];
                 char patch_buf[128];
-                sprintf(patch_title_buf, "Step %d", option);
+                sprintf(patch_title_buf, "Step %lu", step_index + 1);
                 sprintf(patch_buf,
-                    "\nMeasured density at patch %d\n"
+                    "\nMeasured density at patch %lu\n"
                     "of the step wedge.\n",
-                    option);
-                uint16_t value_sel = lroundf(step_wedge_get_density(wedge, option - 1) * 100);
+                    step_index + 1);
+                uint16_t value_sel = lroundf(step_wedge_get_density(wedge, step_index) * 100);
 
                 densitometer_clear_reading();
 
@@ -303,15 +324,22 @@ menu_result_t menu_step_wedge_calibration(step_wedge_t *wedge)
                     "D=", &value_sel, 0, 999, 1, 2, "",
                     menu_step_wedge_densitometer_data_callback, NULL);
                 if (patch_option == 1) {
-                    wedge->step_density[option - 1] = (float)value_sel / 100.0F;
+                    wedge->step_density[step_index] = (float)value_sel / 100.0F;
                 } else if (patch_option == UINT8_MAX) {
                     menu_result = MENU_TIMEOUT;
                 }
             }
-        } else if (option == wedge->step_count + 1) {
+        } else if (option > 0 && option == prev_option) {
+            page_start -= STEP_WEDGE_MENU_PAGE_STEP_COUNT;
+            option = 1;
+        } else if (option > 0 && option == next_option) {
+            page_start += STEP_WEDGE_MENU_PAGE_STEP_COUNT;
+            option = 1;
+        } else if (option == reset_option) {
             for (uint32_t i = 0; i < wedge->step_count; i++) {
                 wedge->step_density[i] = NAN;
             }
+            page_start = 0;
             option = 1;
         } else if (option == UINT8_MAX) {
             menu_result = MENU_TIMEOUT;
@@ -344,7 +372,7 @@ menu_result_t menu_step_wedge_show(const step_wedge_t *wedge)
     int cal_status = calibration_status(wedge);
 
     offset += sprintf(buf + offset,
-        "Steps:                        %2lu\n"
+        "Steps:                       %3lu\n"
         "Base density:             D=%0.02f\n"
         "Density increment:        D=%0.02f\n"
         "Calibration:        ",
@@ -0,0 +1,519 @@
+#include "rdm.h"
+
+#include "stm32f4xx_hal.h"
+
+#include <cmsis_os.h>
+#include <string.h>
+
+#define LOG_TAG "rdm"
+#include <elog.h>
+
+#include "dmx.h"
+#include "util.h"
+
+#define RDM_START_CODE     0xCC
+#define RDM_SUB_START_CODE 0x01
+
+/* Packet layout, with offsets from the start code */
+#define RDM_OFFSET_LENGTH      2
+#define RDM_OFFSET_DEST_UID    3
+#define RDM_OFFSET_SOURCE_UID  9
+#define RDM_OFFSET_TN          15
+#define RDM_OFFSET_PORT_ID     16 /* Response type, in responses */
+#define RDM_OFFSET_MSG_COUNT   17
+#define RDM_OFFSET_SUB_DEVICE  18
+#define RDM_OFFSET_CC          20
+#define RDM_OFFSET_PID         21
+#define RDM_OFFSET_PDL         23
+#define RDM_OFFSET_PD          24
+
+#define RDM_PD_MAX      231
+#define RDM_PACKET_MAX  (RDM_OFFSET_PD + RDM_PD_MAX + 2)
+
+#define RDM_CC_DISCOVERY 0x10
+#define RDM_CC_GET       0x20
+#define RDM_CC_SET       0x30
+
+#define RDM_RESPONSE_ACK          0x00
+#define RDM_RESPONSE_ACK_TIMER    0x01
+#define RDM_RESPONSE_NACK_REASON  0x02
+#define RDM_RESPONSE_ACK_OVERFLOW 0x03
+
+#define RDM_PID_DISC_UNIQUE_BRANCH 0x0001
+#define RDM_PID_DISC_MUTE          0x0002
+#define RDM_PID_DISC_UN_MUTE       0x0003
+#define RDM_PID_DEVICE_INFO        0x0060
+#define RDM_PID_DMX_START_ADDRESS  0x00F0
+#define RDM_PID_SENSOR_VALUE       0x0201
+#define RDM_PID_LAMP_STATE         0x0403
+
+/*
+ * Controllers without an assigned ESTA manufacturer ID are expected
+ * to use one from the prototype range.
+ */
+#define RDM_CONTROLLER_MANUFACTURER 0x7FF0
+
+#define RDM_UID_MAX 0xFFFFFFFFFFFEULL
+
+/*
+ * Discovery searches the UID space depth-first, so the pending branch
+ * stack never needs to be deeper than one entry per UID bit. The
+ * branch limit guards against a misbehaving responder that never
+ * stays muted.
+ */
+#define RDM_DISCOVERY_STACK_SIZE   50
+#define RDM_DISCOVERY_BRANCH_LIMIT 1000
+
+static uint8_t rdm_transaction_number = 0;
+static rdm_uid_t rdm_source_uid = 0;
+
+static void rdm_write_uid(uint8_t *buf, rdm_uid_t uid);
+static rdm_uid_t rdm_read_uid(const uint8_t *buf);
+static size_t rdm_build_request(uint8_t *buf, rdm_uid_t dest, uint8_t tn, uint8_t cc, uint16_t pid,
+    const uint8_t *pd, uint8_t pdl);
+static rdm_result_t rdm_request(rdm_uid_t dest, uint8_t cc, uint16_t pid,
+    const uint8_t *pd, uint8_t pdl,
+    uint8_t *resp_pd, uint8_t resp_pd_size, uint8_t *resp_pdl);
+static rdm_result_t rdm_parse_response(const uint8_t *buf, size_t len,
+    rdm_uid_t dest, uint8_t tn, uint8_t cc, uint16_t pid,
+    const uint8_t **pd, uint8_t *pdl);
+static rdm_result_t rdm_discovery_branch(rdm_uid_t lower, rdm_uid_t upper, rdm_uid_t *uid);
+static rdm_result_t rdm_decode_euid(const uint8_t *buf, size_t len, rdm_uid_t *uid);
+
+rdm_uid_t rdm_controller_uid()
+{
+    if (rdm_source_uid == 0) {
+        const uint32_t device_id = HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2();
+        rdm_source_uid = ((rdm_uid_t)RDM_CONTROLLER_MANUFACTURER << 32) | device_id;
+    }
+    return rdm_source_uid;
+}
+
+void rdm_write_uid(uint8_t *buf, rdm_uid_t uid)
+{
+    for (int i = 5; i >= 0; i--) {
+        buf[i] = (uint8_t)(uid & 0xFF);
+        uid >>= 8;
+    }
+}
+
+rdm_uid_t rdm_read_uid(const uint8_t *buf)
+{
+    rdm_uid_t uid = 0;
+    for (int i = 0; i < 6; i++) {
+        uid = (uid << 8) | buf[i];
+    }
+    return uid;
+}
+
+size_t rdm_build_request(uint8_t *buf, rdm_uid_t dest, uint8_t tn, uint8_t cc, uint16_t pid,
+    const uint8_t *pd, uint8_t pdl)
+{
+    const uint8_t length = RDM_OFFSET_PD + pdl;
+
+    buf[0] = RDM_START_CODE;
+    buf[1] = RDM_SUB_START_CODE;
+    buf[RDM_OFFSET_LENGTH] = length;
+    rdm_write_uid(buf + RDM_OFFSET_DEST_UID, dest);
+    rdm_write_uid(buf + RDM_OFFSET_SOURCE_UID, rdm_controller_uid());
+    buf[RDM_OFFSET_TN] = tn;
+    buf[RDM_OFFSET_PORT_ID] = 1;
+    buf[RDM_OFFSET_MSG_COUNT] = 0;
+    conv_u16_array(buf + RDM_OFFSET_SUB_DEVICE, 0);
+    buf[RDM_OFFSET_CC] = cc;
+    conv_u16_array(buf + RDM_OFFSET_PID, pid);
+    buf[RDM_OFFSET_PDL] = pdl;
+    if (pdl > 0) {
+        memcpy(buf + RDM_OFFSET_PD, pd, pdl);
+    }
+
+    uint16_t checksum = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        checksum += buf[i];
+    }
+    conv_u16_array(buf + length, checksum);
+
+    return length + 2;
+}
+
+rdm_result_t rdm_request(rdm_uid_t dest, uint8_t cc, uint16_t pid,
+    const uint8_t *pd, uint8_t pdl,
+    uint8_t *resp_pd, uint8_t resp_pd_size, uint8_t *resp_pdl)
+{
+    uint8_t request[RDM_OFFSET_PD + RDM_PD_MAX + 2];
+    uint8_t response[RDM_PACKET_MAX + 1];
+    size_t response_len = 0;
+
+    if (pdl > RDM_PD_MAX) {
+        return RDM_RESULT_ERROR;
+    }
+
+    const uint8_t tn = rdm_transaction_number++;
+    const size_t request_len = rdm_build_request(request, dest, tn, cc, pid, pd, pdl);
+
+    /* Broadcast requests never get a response */
+    const bool broadcast = (dest & 0xFFFFFFFFULL) == 0xFFFFFFFFULL;
+
+    if (dmx_rdm_transaction(request, request_len,
+        broadcast ? NULL : response, sizeof(response), &response_len) != osOK) {
+        return RDM_RESULT_ERROR;
+    }
+    if (broadcast) {
+        return RDM_RESULT_OK;
+    }
+
+    const uint8_t *data = NULL;
+    uint8_t data_len = 0;
+    rdm_result_t result = rdm_parse_response(response, response_len, dest, tn, cc, pid, &data, &data_len);
+    if (result == RDM_RESULT_NACK && data_len >= 2) {
+        log_d("RDM NACK: pid=0x%04X, reason=0x%04X", pid, conv_array_u16(data));
+    }
+    if (result != RDM_RESULT_OK) {
+        return result;
+    }
+
+    if (resp_pd) {
+        if (data_len > resp_pd_size) {
+            data_len = resp_pd_size;
+        }
+        memcpy(resp_pd, data, data_len);
+    }
+    if (resp_pdl) {
+        *resp_pdl = data_len;
+    }
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_parse_response(const uint8_t *buf, size_t len,
+    rdm_uid_t dest, uint8_t tn, uint8_t cc, uint16_t pid,
+    const uint8_t **pd, uint8_t *pdl)
+{
+    if (len == 0) {
+        return RDM_RESULT_NO_RESPONSE;
+    }
+
+    /* The BREAK ahead of the response is received as a null byte */
+    if (len > 1 && buf[0] == 0x00 && buf[1] == RDM_START_CODE) {
+        buf++;
+        len--;
+    }
+
+    if (len < RDM_OFFSET_PD + 2
+        || buf[0] != RDM_START_CODE || buf[1] != RDM_SUB_START_CODE) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    const uint8_t length = buf[RDM_OFFSET_LENGTH];
+    if (length < RDM_OFFSET_PD || len < (size_t)length + 2
+        || buf[RDM_OFFSET_PDL] != length - RDM_OFFSET_PD) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    uint16_t checksum = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        checksum += buf[i];
+    }
+    if (checksum != conv_array_u16(buf + length)) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    if (rdm_read_uid(buf + RDM_OFFSET_DEST_UID) != rdm_controller_uid()
+        || rdm_read_uid(buf + RDM_OFFSET_SOURCE_UID) != dest
+        || buf[RDM_OFFSET_TN] != tn
+        || buf[RDM_OFFSET_CC] != cc + 1
+        || conv_array_u16(buf + RDM_OFFSET_PID) != pid) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    *pd = buf + RDM_OFFSET_PD;
+    *pdl = buf[RDM_OFFSET_PDL];
+
+    switch (buf[RDM_OFFSET_PORT_ID]) {
+    case RDM_RESPONSE_ACK:
+        return RDM_RESULT_OK;
+    case RDM_RESPONSE_NACK_REASON:
+        return RDM_RESULT_NACK;
+    case RDM_RESPONSE_ACK_TIMER:
+    case RDM_RESPONSE_ACK_OVERFLOW:
+        return RDM_RESULT_DEFERRED;
+    default:
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+}
+
+rdm_result_t rdm_discover(rdm_uid_t *uids, size_t max_uids, size_t *count)
+{
+    rdm_uid_t stack_lower[RDM_DISCOVERY_STACK_SIZE];
+    rdm_uid_t stack_upper[RDM_DISCOVERY_STACK_SIZE];
+    size_t depth = 0;
+    size_t found = 0;
+    uint16_t branches = 0;
+    rdm_result_t result;
+
+    if (!uids || !count) { return RDM_RESULT_ERROR; }
+    *count = 0;
+
+    log_d("Starting RDM discovery");
+
+    /* Un-mute every responder, so they all take part */
+    result = rdm_request(RDM_UID_BROADCAST, RDM_CC_DISCOVERY, RDM_PID_DISC_UN_MUTE, NULL, 0, NULL, 0, NULL);
+    if (result != RDM_RESULT_OK) {
+        return result;
+    }
+
+    stack_lower[0] = 0;
+    stack_upper[0] = RDM_UID_MAX;
+    depth = 1;
+
+    while (depth > 0 && found < max_uids) {
+        if (++branches > RDM_DISCOVERY_BRANCH_LIMIT) {
+            log_w("RDM discovery branch limit reached");
+            break;
+        }
+
+        depth--;
+        const rdm_uid_t lower = stack_lower[depth];
+        const rdm_uid_t upper = stack_upper[depth];
+
+        rdm_uid_t uid = 0;
+        result = rdm_discovery_branch(lower, upper, &uid);
+        if (result == RDM_RESULT_ERROR) {
+            return result;
+        } else if (result == RDM_RESULT_NO_RESPONSE) {
+            continue;
+        } else if (result == RDM_RESULT_OK) {
+            /*
+             * A single responder answered, so mute it and search the same
+             * branch again for any others. If it does not acknowledge the
+             * mute, then the answer was most likely a lucky collision.
+             */
+            uint8_t control[8];
+            result = rdm_request(uid, RDM_CC_DISCOVERY, RDM_PID_DISC_MUTE, NULL, 0, control, sizeof(control), NULL);
+            if (result == RDM_RESULT_ERROR) {
+                return result;
+            } else if (result == RDM_RESULT_OK) {
+                log_d("Found RDM responder: %04X:%08lX", RDM_UID_MANUFACTURER(uid), RDM_UID_DEVICE(uid));
+                bool duplicate = false;
+                for (size_t i = 0; i < found; i++) {
+                    if (uids[i] == uid) { duplicate = true; break; }
+                }
+                if (!duplicate) {
+                    uids[found++] = uid;
+                }
+                stack_lower[depth] = lower;
+                stack_upper[depth] = upper;
+                depth++;
+                continue;
+            }
+        }
+
+        /* Multiple responders answered, so split the branch in half */
+        if (lower == upper) {
+            continue;
+        }
+        if (depth + 2 > RDM_DISCOVERY_STACK_SIZE) {
+            log_w("RDM discovery stack overflow");
+            continue;
+        }
+        const rdm_uid_t mid = lower + ((upper - lower) / 2);
+        stack_lower[depth] = mid + 1;
+        stack_upper[depth] = upper;
+        depth++;
+        stack_lower[depth] = lower;
+        stack_upper[depth] = mid;
+        depth++;
+    }
+
+    log_d("RDM discovery found %d responders", (int)found);
+
+    *count = found;
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_discovery_branch(rdm_uid_t lower, rdm_uid_t upper, rdm_uid_t *uid)
+{
+    uint8_t request[RDM_OFFSET_PD + 12 + 2];
+    uint8_t response[32];
+    uint8_t pd[12];
+    size_t response_len = 0;
+
+    rdm_write_uid(pd, lower);
+    rdm_write_uid(pd + 6, upper);
+
+    const size_t request_len = rdm_build_request(request, RDM_UID_BROADCAST, rdm_transaction_number++,
+        RDM_CC_DISCOVERY, RDM_PID_DISC_UNIQUE_BRANCH, pd, sizeof(pd));
+
+    if (dmx_rdm_transaction(request, request_len, response, sizeof(response), &response_len) != osOK) {
+        return RDM_RESULT_ERROR;
+    }
+    if (response_len == 0) {
+        return RDM_RESULT_NO_RESPONSE;
+    }
+
+    if (rdm_decode_euid(response, response_len, uid) != RDM_RESULT_OK
+        || *uid < lower || *uid > upper) {
+        return RDM_RESULT_COLLISION;
+    }
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_decode_euid(const uint8_t *buf, size_t len, rdm_uid_t *uid)
+{
+    /*
+     * Discovery responses are sent without a BREAK, and consist of up to
+     * seven preamble bytes, a separator, and then the UID and checksum
+     * with each byte sent twice with alternating bits forced high.
+     */
+    size_t i = 0;
+    while (i < len && i < 7 && buf[i] == 0xFE) {
+        i++;
+    }
+    if (i >= len || buf[i] != 0xAA) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+    i++;
+    if (len - i < 16) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    const uint8_t *euid = buf + i;
+    uint8_t decoded[8];
+    uint16_t checksum = 0;
+    for (uint8_t j = 0; j < 8; j++) {
+        if ((euid[j * 2] & 0xAA) != 0xAA || (euid[(j * 2) + 1] & 0x55) != 0x55) {
+            return RDM_RESULT_INVALID_RESPONSE;
+        }
+        decoded[j] = euid[j * 2] & euid[(j * 2) + 1];
+        if (j < 6) {
+            checksum += euid[j * 2] + euid[(j * 2) + 1];
+        }
+    }
+
+    if (checksum != conv_array_u16(decoded + 6)) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    *uid = rdm_read_uid(decoded);
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_get_device_info(rdm_uid_t uid, rdm_device_info_t *info)
+{
+    uint8_t data[19];
+    uint8_t data_len = 0;
+
+    if (!info) { return RDM_RESULT_ERROR; }
+
+    rdm_result_t result = rdm_request(uid, RDM_CC_GET, RDM_PID_DEVICE_INFO, NULL, 0, data, sizeof(data), &data_len);
+    if (result != RDM_RESULT_OK) {
+        return result;
+    }
+    if (data_len < sizeof(data)) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    info->protocol_version = conv_array_u16(data);
+    info->model_id = conv_array_u16(data + 2);
+    info->product_category = conv_array_u16(data + 4);
+    info->software_version = ((uint32_t)conv_array_u16(data + 6) << 16) | conv_array_u16(data + 8);
+    info->footprint = conv_array_u16(data + 10);
+    info->personality = data[12];
+    info->personality_count = data[13];
+    info->start_address = conv_array_u16(data + 14);
+    info->sub_device_count = conv_array_u16(data + 16);
+    info->sensor_count = data[18];
+
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_get_dmx_start_address(rdm_uid_t uid, uint16_t *address)
+{
+    uint8_t data[2];
+    uint8_t data_len = 0;
+
+    if (!address) { return RDM_RESULT_ERROR; }
+
+    rdm_result_t result = rdm_request(uid, RDM_CC_GET, RDM_PID_DMX_START_ADDRESS, NULL, 0, data, sizeof(data), &data_len);
+    if (result != RDM_RESULT_OK) {
+        return result;
+    }
+    if (data_len < sizeof(data)) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    *address = conv_array_u16(data);
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_set_dmx_start_address(rdm_uid_t uid, uint16_t address)
+{
+    uint8_t data[2];
+
+    if (address < 1 || address > 512) { return RDM_RESULT_ERROR; }
+
+    conv_u16_array(data, address);
+    return rdm_request(uid, RDM_CC_SET, RDM_PID_DMX_START_ADDRESS, data, sizeof(data), NULL, 0, NULL);
+}
+
+rdm_result_t rdm_get_sensor_value(rdm_uid_t uid, uint8_t sensor, rdm_sensor_value_t *value)
+{
+    uint8_t data[9];
+    uint8_t data_len = 0;
+
+    if (!value) { return RDM_RESULT_ERROR; }
+
+    rdm_result_t result = rdm_request(uid, RDM_CC_GET, RDM_PID_SENSOR_VALUE, &sensor, 1, data, sizeof(data), &data_len);
+    if (result != RDM_RESULT_OK) {
+        return result;
+    }
+    if (data_len < sizeof(data)) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    value->sensor = data[0];
+    value->present = (int16_t)conv_array_u16(data + 1);
+    value->lowest = (int16_t)conv_array_u16(data + 3);
+    value->highest = (int16_t)conv_array_u16(data + 5);
+    value->recorded = (int16_t)conv_array_u16(data + 7);
+    return RDM_RESULT_OK;
+}
+
+rdm_result_t rdm_get_lamp_state(rdm_uid_t uid, uint8_t *state)
+{
+    uint8_t data[1];
+    uint8_t data_len = 0;
+
+    if (!state) { return RDM_RESULT_ERROR; }
+
+    rdm_result_t result = rdm_request(uid, RDM_CC_GET, RDM_PID_LAMP_STATE, NULL, 0, data, sizeof(data), &data_len);
+    if (result != RDM_RESULT_OK) {
+        return result;
+    }
+    if (data_len < sizeof(data)) {
+        return RDM_RESULT_INVALID_RESPONSE;
+    }
+
+    *state = data[0];
+    return RDM_RESULT_OK;
+}
+
+const char *rdm_result_str(rdm_result_t result)
+{
+    switch (result) {
+    case RDM_RESULT_OK:
+        return "OK";
+    case RDM_RESULT_NO_RESPONSE:
+        return "No response";
+    case RDM_RESULT_COLLISION:
+        return "Collision";
+    case RDM_RESULT_INVALID_RESPONSE:
+        return "Invalid response";
+    case RDM_RESULT_NACK:
+        return "NACK";
+    case RDM_RESULT_DEFERRED:
+        return "Deferred";
+    case RDM_RESULT_ERROR:
+    default:
+        return "Error";
+    }
+}
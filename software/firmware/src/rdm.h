@@ -0,0 +1,100 @@
+#ifndef RDM_H
+#define RDM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * RDM unique identifier, with the 16-bit manufacturer ID and
+ * the 32-bit device ID held in the low 48 bits.
+ */
+typedef uint64_t rdm_uid_t;
+
+#define RDM_UID_BROADCAST 0xFFFFFFFFFFFFULL
+
+#define RDM_UID_MANUFACTURER(uid) ((uint16_t)(((uid) >> 32) & 0xFFFFU))
+#define RDM_UID_DEVICE(uid) ((uint32_t)((uid) & 0xFFFFFFFFUL))
+
+typedef enum : uint8_t {
+    RDM_RESULT_OK = 0,          /*!< Valid acknowledgement received */
+    RDM_RESULT_NO_RESPONSE,     /*!< Nothing was received */
+    RDM_RESULT_COLLISION,       /*!< Multiple responders appear to have answered at once */
+    RDM_RESULT_INVALID_RESPONSE,/*!< Something was received, but it was not a valid response */
+    RDM_RESULT_NACK,            /*!< Responder refused the request */
+    RDM_RESULT_DEFERRED,        /*!< Responder acknowledged, but the result is not yet available */
+    RDM_RESULT_ERROR            /*!< Request could not be sent */
+} rdm_result_t;
+
+typedef struct {
+    uint16_t protocol_version;
+    uint16_t model_id;
+    uint16_t product_category;
+    uint32_t software_version;
+    uint16_t footprint;          /*!< Number of slots used in the current personality */
+    uint8_t personality;
+    uint8_t personality_count;
+    uint16_t start_address;      /*!< First slot used, from 1, or 0xFFFF if the device uses no slots */
+    uint16_t sub_device_count;
+    uint8_t sensor_count;
+} rdm_device_info_t;
+
+typedef struct {
+    uint8_t sensor;
+    int16_t present;
+    int16_t lowest;
+    int16_t highest;
+    int16_t recorded;
+} rdm_sensor_value_t;
+
+/**
+ * Lamp states reported by 'rdm_get_lamp_state()'
+ */
+#define RDM_LAMP_OFF     0x00
+#define RDM_LAMP_ON      0x01
+#define RDM_LAMP_STRIKE  0x02
+#define RDM_LAMP_STANDBY 0x03
+
+/**
+ * Get the UID used by this controller.
+ */
+rdm_uid_t rdm_controller_uid();
+
+/**
+ * Discover the RDM responders attached to the DMX control port.
+ *
+ * This performs the full discovery process, un-muting all responders
+ * and then searching the UID space until every responder has been
+ * found and muted. Each transaction is slotted in between regular
+ * frames, if frames are being sent.
+ *
+ * @param uids Array to fill with the UIDs of the discovered responders
+ * @param max_uids Size of the array
+ * @param count Number of responders discovered
+ */
+rdm_result_t rdm_discover(rdm_uid_t *uids, size_t max_uids, size_t *count);
+
+rdm_result_t rdm_get_device_info(rdm_uid_t uid, rdm_device_info_t *info);
+
+/**
+ * Get the DMX start address of a responder.
+ *
+ * @param uid Responder to query
+ * @param address First slot used by the responder, counting from 1
+ */
+rdm_result_t rdm_get_dmx_start_address(rdm_uid_t uid, uint16_t *address);
+
+/**
+ * Set the DMX start address of a responder.
+ *
+ * @param uid Responder to update
+ * @param address First slot to be used by the responder, counting from 1
+ */
+rdm_result_t rdm_set_dmx_start_address(rdm_uid_t uid, uint16_t address);
+
+rdm_result_t rdm_get_sensor_value(rdm_uid_t uid, uint8_t sensor, rdm_sensor_value_t *value);
+
+rdm_result_t rdm_get_lamp_state(rdm_uid_t uid, uint8_t *state);
+
+const char *rdm_result_str(rdm_result_t result);
+
+#endif /* RDM_H */
@@ -20,6 +20,8 @@
 #ifndef __CDT_PARSER__
 _Static_assert(PROFILE_NAME_LEN == 32, "PROFILE_NAME_LEN length has been changed");
 _Static_assert(CONTRAST_WHOLE_GRADE_COUNT == 7, "CONTRAST_WHOLE_GRADE_COUNT length has been changed");
+_Static_assert(MAX_ENLARGER_CONFIGS <= 32, "MAX_ENLARGER_CONFIGS exceeds cache bitmask size");
+_Static_assert(MAX_PAPER_PROFILES <= 32, "MAX_PAPER_PROFILES exceeds cache bitmask size");
 #endif
 
 #define LATEST_CONFIG_VERSION           1
@@ -41,7 +43,9 @@ _Static_assert(CONTRAST_WHOLE_GRADE_COUNT == 7, "CONTRAST_WHOLE_GRADE_COUNT leng
 
 #define LATEST_ENLARGER_CONFIG_VERSION  1
 #define LATEST_PAPER_PROFILE_VERSION    2
-#define LATEST_STEP_WEDGE_VERSION       1
+#define LATEST_STEP_WEDGE_VERSION       2
+#define LATEST_PROFILE_INDEX_VERSION    1
+#define LATEST_SNAPSHOT_VERSION         1
 
 /* Handle to I2C peripheral used by the EEPROM */
 static I2C_HandleTypeDef *eeprom_i2c = NULL;
@@ -59,9 +63,52 @@ static buzzer_volume_t setting_buzzer_volume = DEFAULT_BUZZER_VOLUME;
 static teststrip_mode_t setting_teststrip_mode = DEFAULT_TESTSTRIP_MODE;
 static teststrip_patches_t setting_teststrip_patches = DEFAULT_TESTSTRIP_PATCHES;
 static uint8_t setting_enlarger_config = DEFAULT_ENLARGER_CONFIG;
+static uint8_t setting_secondary_enlarger_config = UINT8_MAX;
 static uint8_t setting_paper_profile = DEFAULT_PAPER_PROFILE;
 static safelight_config_t setting_safelight_config = DEFAULT_SAFELIGHT_CONFIG;
 
+/*
+ * RAM shadow of the decoded profile pages.
+ * Each page is read from EEPROM on first access, after which the slot's
+ * loaded bit is set and all further lookups are served from memory.
+ * A loaded slot with a NULL entry is known to hold no valid record.
+ * These are only accessed while holding the EEPROM mutex.
+ */
+static uint32_t enlarger_config_cache_loaded = 0;
+static enlarger_config_t *enlarger_config_cache[MAX_ENLARGER_CONFIGS] = {0};
+static uint32_t paper_profile_cache_loaded = 0;
+static paper_profile_t *paper_profile_cache[MAX_PAPER_PROFILES] = {0};
+static bool step_wedge_cache_loaded = false;
+static step_wedge_t *step_wedge_cache = NULL;
+
+/*
+ * RAM copy of the profile index, loaded at startup so that profile
+ * lists can be built without reading any profile pages.
+ */
+typedef struct {
+    uint32_t version;             /*!< Version of the profile page, UINT32_MAX if empty */
+    uint32_t crc;                 /*!< CRC-32 of the full profile page */
+    char name[PROFILE_NAME_LEN];  /*!< Copy of the profile name */
+} profile_index_entry_t;
+
+static profile_index_entry_t enlarger_config_index[MAX_ENLARGER_CONFIGS];
+static profile_index_entry_t paper_profile_index[MAX_PAPER_PROFILES];
+
+/*
+ * Which of the two slots holds the current copy of each profile record,
+ * determined the first time the record is read.
+ * These are only accessed while holding the EEPROM mutex.
+ */
+typedef struct {
+    bool known;       /*!< Slots have been read since startup */
+    uint8_t slot;     /*!< Slot with the current copy, or RECORD_SLOT_NONE */
+    uint8_t sequence; /*!< Sequence number of the current copy */
+} settings_record_state_t;
+
+static settings_record_state_t enlarger_config_record[MAX_ENLARGER_CONFIGS] = {0};
+static settings_record_state_t paper_profile_record[MAX_PAPER_PROFILES] = {0};
+static settings_record_state_t step_wedge_record = {0};
+
 /**
  * Header Page (256B)
  * Mostly unused at the moment, will be populated if any top-level system
@@ -94,7 +141,9 @@ static safelight_config_t setting_safelight_config = DEFAULT_SAFELIGHT_CONFIG;
 #define CONFIG_TESTSTRIP_PATCHES         40
 #define CONFIG_ENLARGER_CONFIG           44
 #define CONFIG_PAPER_PROFILE             48
-/* RESERVED                              52*/
+#define CONFIG_JOURNAL_SEQUENCE          52 /* Last journal page folded into this page */
+#define CONFIG_SECONDARY_ENLARGER_CONFIG 56 /* Index + 1, or 0 for none */
+/* RESERVED                              60*/
 
 /**
  * Detailed configuration page (256B)
@@ -108,12 +157,37 @@ static safelight_config_t setting_safelight_config = DEFAULT_SAFELIGHT_CONFIG;
 #define CONFIG2_SAFELIGHT_CONTROL_SIZE   (12U)
 
 /**
- * Enlarger configurations (4096B)
+ * Profile index page (256B)
+ * Header for the profile index entries that follow it. The entries are
+ * only trusted if the version here is current, otherwise they are rebuilt
+ * from the profile pages.
+ */
+#define PAGE_PROFILE_INDEX               0x00300UL
+#define PROFILE_INDEX_VERSION            0
+
+/**
+ * Profile index entries (2048B)
+ * Directory of the enlarger and paper profile slots, with a 64-byte
+ * entry per slot, four entries to a page. Each entry mirrors the version
+ * and name fields of its profile page, along with a CRC-32 of the whole
+ * page, and is rewritten whenever that page changes.
+ */
+#define PAGE_ENLARGER_INDEX_BASE         0x00400UL
+#define PAGE_PAPER_INDEX_BASE            0x00800UL
+#define PROFILE_INDEX_ENTRY_SIZE         (64U)
+#define PROFILE_INDEX_ENTRY_VERSION      0
+#define PROFILE_INDEX_ENTRY_CRC          4
+#define PROFILE_INDEX_ENTRY_NAME         8  /* char[32] */
+
+/**
+ * Enlarger configurations (4096B + 4096B)
  * Each enlarger configuration is allocated a full 256-byte page,
  * starting at this address, up to a maximum of 16
- * configuration entries.
+ * configuration entries. The second slot for each entry
+ * is at the same position in the alternate region.
  */
 #define PAGE_ENLARGER_CONFIG_BASE              0x01000UL
+#define PAGE_ENLARGER_CONFIG_ALT_BASE          0x05000UL
 #define ENLARGER_CONFIG_VERSION                0
 #define ENLARGER_CONFIG_NAME                   4  /* char[32] */
 #define ENLARGER_CONFIG_TIMING_TURN_ON_DELAY   36
@@ -136,14 +210,18 @@ static safelight_config_t setting_safelight_config = DEFAULT_SAFELIGHT_CONFIG;
 #define ENLARGER_CONFIG_CONTROL_FOCUS_VALUE   140 /* 2B (uint16_t) */
 #define ENLARGER_CONFIG_CONTROL_SAFE_VALUE    142 /* 2B (uint16_t) */
 #define ENLARGER_CONFIG_CONTROL_GRADE_VALUES  144 /* 56B (7 * (4 * uint16_t)) */
+#define ENLARGER_CONFIG_CONTROL_RAMP_TIME     200 /* 2B (uint16_t) */
+#define ENLARGER_CONFIG_CONTROL_RAMP_CURVE    202 /* 1B (enlarger_ramp_curve_t) */
 
 /**
- * Paper profiles (4096B)
+ * Paper profiles (4096B + 4096B)
  * Each paper profile is allocated a full 256-byte page,
  * starting at this address, up to a maximum of 16
- * profile entries.
+ * profile entries. The second slot for each entry
+ * is at the same position in the alternate region.
  */
 #define PAGE_PAPER_PROFILE_BASE          0x02000UL
+#define PAGE_PAPER_PROFILE_ALT_BASE      0x06000UL
 #define PAPER_PROFILE_VERSION            0
 #define PAPER_PROFILE_NAME               4  /* char[32] */
 #define PAPER_PROFILE_GRADE00_HT         36
@@ -171,17 +249,77 @@ static safelight_config_t setting_safelight_config = DEFAULT_SAFELIGHT_CONFIG;
 #define PAPER_PROFILE_DMAX               124
 
 /**
- * Step wedge profile (256B)
- * Only a single step wedge profile is supported, and
- * it is given a full 256-byte page.
+ * Step wedge profile (2048B + 2048B)
+ * Only a single step wedge profile is supported, and it is given
+ * eight consecutive pages, with its second slot in the other half of
+ * the step wedge region. Version 1 profiles only used the first page
+ * of each slot, with the trailer at the end of that page.
  */
 #define PAGE_STEP_WEDGE_BASE             0x03000UL
+#define PAGE_STEP_WEDGE_ALT_BASE         0x03800UL
+#define STEP_WEDGE_SLOT_SIZE             (2048U)
 #define STEP_WEDGE_VERSION               0
 #define STEP_WEDGE_NAME                  4  /* char[32] */
 #define STEP_WEDGE_BASE_DENSITY          36
 #define STEP_WEDGE_DENSITY_INCREMENT     40
 #define STEP_WEDGE_STEP_COUNT            44
-#define STEP_WEDGE_STEP_DENSITY_0        48 /* up to 51 steps supported */
+#define STEP_WEDGE_STEP_DENSITY_0        48 /* up to 499 steps fit, 51 in version 1 */
+
+/**
+ * Profile record trailer
+ * Enlarger configurations, paper profiles and the step wedge are each
+ * stored in two slots, with every write going to the slot that does not
+ * hold the current copy. The last bytes of each slot are used to
+ * tell which copy is the newest one that was completely written.
+ * Pages written before this trailer was added have it zero-filled.
+ */
+#define RECORD_SEQUENCE(len)             ((len) - 4) /* 1B (uint8_t), incremented on each write */
+#define RECORD_CHECK(len)                ((len) - 3) /* 3B, low bits of the CRC-32 of the preceding bytes */
+#define RECORD_SLOT_NONE                 0xFF
+
+#ifndef __CDT_PARSER__
+_Static_assert(STEP_WEDGE_STEP_DENSITY_0 + (4 * MAX_STEP_WEDGE_STEP_COUNT) <= RECORD_SEQUENCE(STEP_WEDGE_SLOT_SIZE),
+    "MAX_STEP_WEDGE_STEP_COUNT overlaps the record trailer");
+#endif
+
+/**
+ * Config journal (4096B)
+ * Ring of pages that config value changes are appended to, instead of
+ * rewriting their fixed locations in the config page every time.
+ * Each page begins with a header, followed by fixed-size change records.
+ * At startup, records in pages newer than the sequence number saved in
+ * the config page are replayed on top of it. Before the ring wraps around
+ * onto such a page, the current values are compacted back into the
+ * config page.
+ */
+#define PAGE_CONFIG_JOURNAL_BASE         0x04000UL
+#define JOURNAL_PAGE_COUNT               16
+#define JOURNAL_MAGIC                    0  /* "JRNL" */
+#define JOURNAL_SEQUENCE                 4  /* 4B (uint32_t) */
+#define JOURNAL_RECORD_0                 8
+#define JOURNAL_RECORD_SIZE              8
+#define JOURNAL_RECORD_COUNT             31
+#define JOURNAL_RECORD_OFFSET            0  /* 1B config page offset, 0xFF if unused */
+#define JOURNAL_RECORD_VALUE             1  /* 4B (uint32_t) */
+#define JOURNAL_RECORD_CHECK             5  /* 3B, low bits of the record CRC-32 */
+
+/**
+ * Settings snapshot file
+ * Binary image of the settings regions of the EEPROM, written to and
+ * restored from external storage. The file begins with a header that
+ * describes each section, followed by the contents of each section
+ * in the same order. Every section has its own CRC-32, and the header
+ * ends with a CRC-32 of everything before it.
+ */
+#define SNAPSHOT_MAGIC                   0  /* "PZSNAPSH" */
+#define SNAPSHOT_VERSION                 8  /* 4B (uint32_t) */
+#define SNAPSHOT_SECTION_COUNT           12 /* 4B (uint32_t) */
+#define SNAPSHOT_SECTION_TABLE           16 /* 12B per section */
+#define SNAPSHOT_SECTION_ADDRESS         0  /* 4B (uint32_t) */
+#define SNAPSHOT_SECTION_LENGTH          4  /* 4B (uint32_t) */
+#define SNAPSHOT_SECTION_CRC             8  /* 4B (uint32_t) */
+#define SNAPSHOT_SECTION_ENTRY_SIZE      (12U)
+#define SNAPSHOT_SECTION_MAX_LENGTH      (4096U)
 
 /**
  * Bootloader page (512B)
@@ -205,11 +343,135 @@ static safelight_config_t setting_safelight_config = DEFAULT_SAFELIGHT_CONFIG;
  */
 #define PAGE_LIMIT                       0x20000UL
 
+/**
+ * Number of memory pages that can have writes pending at once.
+ */
+#define SETTINGS_WRITE_SLOT_COUNT        4
+
+/**
+ * Time to wait after a change is staged before writing it out, so that
+ * further changes to the same page can be merged into a single write.
+ */
+#define SETTINGS_WRITE_DELAY_MS          250
+
+/**
+ * Number of attempts made to write out a pending page, before its
+ * changes are discarded.
+ */
+#define SETTINGS_WRITE_ATTEMPTS          3
+
+/**
+ * Span at the start of the EEPROM that is read in a single sequential
+ * transfer at startup, covering the header, config pages and profile index.
+ */
+#define SETTINGS_BOOT_READ_SIZE          (PAGE_PAPER_INDEX_BASE + (PROFILE_INDEX_ENTRY_SIZE * MAX_PAPER_PROFILES))
+
+/**
+ * Span of config journal pages that is also read in a single transfer
+ * at startup, so the journal scan and replay do not read page by page.
+ */
+#define SETTINGS_BOOT_JOURNAL_SIZE       (PAGE_SIZE * JOURNAL_PAGE_COUNT)
+
+/*
+ * Pending EEPROM writes, held until the settings task writes them out.
+ * Each slot covers a single memory page, with a bitmask of the bytes that
+ * have been changed. Writes to a page that already has a slot are merged
+ * into it. These are only accessed while holding the EEPROM mutex.
+ */
+typedef struct {
+    bool pending;                   /*!< Slot holds changes that have not been written */
+    bool flushing;                  /*!< Slot is being written out, and must not be reused */
+    uint32_t address;               /*!< Base address of the page */
+    uint32_t sequence;              /*!< Order in which the slot was filled */
+    uint32_t generation;            /*!< Incremented whenever new changes are merged in */
+    uint8_t failures;               /*!< Consecutive failed attempts to write the slot out */
+    uint32_t dirty[PAGE_SIZE / 32]; /*!< Bitmask of changed bytes within the page */
+    uint8_t data[PAGE_SIZE];        /*!< Page contents for the changed bytes */
+} settings_write_slot_t;
+
+static settings_write_slot_t settings_write_slots[SETTINGS_WRITE_SLOT_COUNT] = {0};
+static uint32_t settings_write_sequence = 0;
+static uint32_t settings_write_discarded = 0;
+static bool settings_writer_running = false;
+
+/*
+ * Contents of the boot read spans, only allocated while settings_init()
+ * is running. Reads within the spans are served from here, and writes
+ * within the spans are mirrored into them.
+ */
+static uint8_t *settings_boot_data = NULL;
+static uint8_t *settings_boot_journal = NULL;
+
+/* Profile index needs rebuilding, which is left to the settings task */
+static bool settings_profile_index_pending = false;
+
+/*
+ * EEPROM regions included in a settings snapshot.
+ */
+typedef struct {
+    uint32_t address; /*!< Start address of the region */
+    uint32_t length;  /*!< Length of the region, up to SNAPSHOT_SECTION_MAX_LENGTH */
+} settings_snapshot_section_t;
+
+static const settings_snapshot_section_t settings_snapshot_sections[] = {
+    { PAGE_HEADER,                   PAGE_ENLARGER_CONFIG_BASE - PAGE_HEADER },
+    { PAGE_ENLARGER_CONFIG_BASE,     PAGE_SIZE * MAX_ENLARGER_CONFIGS },
+    { PAGE_PAPER_PROFILE_BASE,       PAGE_SIZE * MAX_PAPER_PROFILES },
+    { PAGE_STEP_WEDGE_BASE,          PAGE_CONFIG_JOURNAL_BASE - PAGE_STEP_WEDGE_BASE },
+    { PAGE_CONFIG_JOURNAL_BASE,      PAGE_SIZE * JOURNAL_PAGE_COUNT },
+    { PAGE_ENLARGER_CONFIG_ALT_BASE, PAGE_SIZE * MAX_ENLARGER_CONFIGS },
+    { PAGE_PAPER_PROFILE_ALT_BASE,   PAGE_SIZE * MAX_PAPER_PROFILES }
+};
+
+#define SNAPSHOT_SECTIONS    (sizeof(settings_snapshot_sections) / sizeof(settings_snapshot_section_t))
+#define SNAPSHOT_HEADER_SIZE (SNAPSHOT_SECTION_TABLE + (SNAPSHOT_SECTION_ENTRY_SIZE * SNAPSHOT_SECTIONS) + 4U)
+
+/*
+ * Buffered modifications to a single memory page, committed to the
+ * EEPROM as a single write.
+ */
+typedef struct {
+    uint32_t address;               /*!< Base address of the page being edited */
+    uint32_t dirty[PAGE_SIZE / 32]; /*!< Bitmask of modified bytes within the page */
+    uint8_t data[PAGE_SIZE];        /*!< Page contents for the modified bytes */
+    uint16_t field_count;           /*!< Number of field writes buffered in this edit */
+} settings_page_edit_t;
+
+/* Config page edit left open across setter calls by settings_begin_config_edit() */
+static settings_page_edit_t config_edit = {0};
+static osThreadId_t config_edit_owner = NULL;
+static bool config_edit_open = false;
+
+/*
+ * Config journal position. A record index of JOURNAL_RECORD_COUNT means
+ * the next change has to start a new page.
+ * These are only accessed while holding the EEPROM mutex.
+ */
+static uint32_t journal_page_sequence[JOURNAL_PAGE_COUNT];
+static uint32_t journal_base_sequence = 0;
+static uint32_t journal_sequence = 0;
+static uint8_t journal_page = JOURNAL_PAGE_COUNT - 1;
+static uint8_t journal_record = JOURNAL_RECORD_COUNT;
+
+/* Number of write cycles avoided by merging field writes into page edits */
+static uint32_t settings_write_cycles_saved = 0;
+
+static osSemaphoreId_t settings_write_semaphore = NULL;
+static const osSemaphoreAttr_t settings_write_semaphore_attributes = {
+    .name = "settings_write_semaphore"
+};
+
 static HAL_StatusTypeDef settings_read_header(bool *valid);
 static HAL_StatusTypeDef settings_write_header();
 
 static bool settings_init_config(bool force_clear);
 static HAL_StatusTypeDef settings_init_default_config();
+static HAL_StatusTypeDef settings_config_journal_scan();
+static HAL_StatusTypeDef settings_config_journal_replay(uint8_t *config_data);
+static bool settings_config_journal_append(uint32_t offset, uint32_t val);
+static bool settings_config_journal_next_page();
+static bool settings_config_journal_compact(settings_page_edit_t *edit);
+static void settings_config_journal_record_check(const uint8_t *record, uint8_t *check);
 static void settings_init_parse_config_page(const uint8_t *data);
 
 static bool settings_init_config2(bool force_clear);
@@ -225,8 +487,53 @@ static void settings_paper_profile_populate_page(const paper_profile_t *profile,
 static void settings_step_wedge_parse_page(step_wedge_t **wedge, const uint8_t *data);
 static void settings_step_wedge_populate_page(const step_wedge_t *wedge, uint8_t *data);
 
+static bool settings_init_profile_index(bool force_clear);
+static HAL_StatusTypeDef settings_load_profile_index(profile_index_entry_t *index_list, uint32_t index_base, size_t count);
+static HAL_StatusTypeDef settings_rebuild_profile_index(profile_index_entry_t *index_list, uint32_t index_base,
+    settings_record_state_t *record_list, uint32_t page_base, uint32_t alt_page_base, size_t count);
+static HAL_StatusTypeDef settings_update_profile_index(profile_index_entry_t *entry, uint32_t index_base, uint8_t index, const uint8_t *data);
+static bool settings_profile_index_is_valid(const profile_index_entry_t *entry, uint32_t latest_version);
+
+static HAL_StatusTypeDef settings_record_read(uint32_t address, uint32_t alt_address, size_t length,
+    settings_record_state_t *state, uint8_t *data);
+static HAL_StatusTypeDef settings_record_write(uint32_t address, uint32_t alt_address, size_t length,
+    settings_record_state_t *state, uint8_t *data);
+static bool settings_record_is_valid(const uint8_t *data, size_t length);
+static void settings_record_check(const uint8_t *data, size_t length, uint8_t *check);
+
+static HAL_StatusTypeDef settings_enlarger_config_cache_load(uint8_t index);
+static void settings_enlarger_config_cache_store(uint8_t index, const uint8_t *data);
+static HAL_StatusTypeDef settings_paper_profile_cache_load(uint8_t index);
+static void settings_paper_profile_cache_store(uint8_t index, const uint8_t *data, uint32_t version);
+static HAL_StatusTypeDef settings_step_wedge_cache_load();
+static void settings_step_wedge_cache_store(const uint8_t *data);
+
 static bool settings_cleanup_bootloader_firmware();
 
+static void settings_init_deferred();
+
+static void settings_snapshot_populate_header(uint8_t *header, const uint32_t *section_crc);
+static bool settings_snapshot_validate_header(const uint8_t *header, uint32_t *section_crc);
+static void settings_reload();
+
+static void settings_task_loop();
+static HAL_StatusTypeDef settings_read_buffer(uint32_t address, uint8_t *data, size_t data_len);
+static uint8_t *settings_boot_read_span(uint32_t address, uint32_t length);
+static bool settings_boot_read(uint32_t address, uint8_t *data, size_t data_len);
+static void settings_boot_mirror(uint32_t address, const uint8_t *data, size_t data_len);
+static HAL_StatusTypeDef settings_write_buffer(uint32_t address, const uint8_t *data, size_t data_len);
+static HAL_StatusTypeDef settings_write_through(uint32_t address, const uint8_t *data, size_t data_len);
+static settings_write_slot_t *settings_write_slot_acquire(uint32_t page_address);
+static bool settings_write_slot_flush_oldest(bool release_bus);
+static bool settings_write_slot_any(bool flushing_only);
+static void settings_wait_write_cycle(bool release_bus);
+
+static void settings_page_edit_begin(settings_page_edit_t *edit, uint32_t page_address);
+static void settings_page_edit_set(settings_page_edit_t *edit, uint32_t offset, const uint8_t *data, size_t data_len);
+static void settings_page_edit_set_u32(settings_page_edit_t *edit, uint32_t offset, uint32_t val);
+static bool settings_page_edit_commit(settings_page_edit_t *edit);
+static bool settings_config_write_u32(uint32_t offset, uint32_t val);
+
 static bool read_u32(uint32_t address, uint32_t *val);
 static bool write_u32(uint32_t address, uint32_t val);
 static bool write_f32(uint32_t address, float val) __attribute__ ((unused));
@@ -243,12 +550,21 @@ HAL_StatusTypeDef settings_init(I2C_HandleTypeDef *hi2c, osMutexId_t i2c_mutex)
     eeprom_i2c = hi2c;
     eeprom_i2c_mutex = i2c_mutex;
 
+    uint32_t start_ticks = osKernelGetTickCount();
+
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
     do {
         log_i("Settings init");
 
-        /* Cleanup the bootloader instruction page */
-        settings_cleanup_bootloader_firmware();
+        /*
+         * Read everything needed at startup in two transfers, one for the
+         * header, config pages and profile index, and one for the config
+         * journal, instead of a separate bus transaction for each page.
+         * If a buffer cannot be allocated, its pages are simply read
+         * individually.
+         */
+        settings_boot_data = settings_boot_read_span(PAGE_HEADER, SETTINGS_BOOT_READ_SIZE);
+        settings_boot_journal = settings_boot_read_span(PAGE_CONFIG_JOURNAL_BASE, SETTINGS_BOOT_JOURNAL_SIZE);
 
         /* Read and validate the header page */
         ret = settings_read_header(&valid);
@@ -257,6 +573,7 @@ HAL_StatusTypeDef settings_init(I2C_HandleTypeDef *hi2c, osMutexId_t i2c_mutex)
         /* Initialize all settings data pages */
         if (!settings_init_config(!valid)) { break; }
         if (!settings_init_config2(!valid)) { break; }
+        if (!settings_init_profile_index(!valid)) { break; }
 
         /* Initialize the header page if necessary */
         if (!valid) {
@@ -264,8 +581,13 @@ HAL_StatusTypeDef settings_init(I2C_HandleTypeDef *hi2c, osMutexId_t i2c_mutex)
             if (ret != HAL_OK) { break; }
         }
 
-        log_i("Settings loaded");
+        log_i("Settings loaded in %lums", osKernelGetTickCount() - start_ticks);
     } while (0);
+
+    vPortFree(settings_boot_data);
+    settings_boot_data = NULL;
+    vPortFree(settings_boot_journal);
+    settings_boot_journal = NULL;
     osMutexRelease(eeprom_i2c_mutex);
 
     return ret;
@@ -280,7 +602,7 @@ HAL_StatusTypeDef settings_read_header(bool *valid)
 
     do {
         /* Read the header into a buffer */
-        ret = m24m01_read_buffer(eeprom_i2c, PAGE_HEADER, data, sizeof(data));
+        ret = settings_read_buffer(PAGE_HEADER, data, sizeof(data));
         if (ret != HAL_OK) {
             log_e("Unable to read settings header: %d", ret);
             break;
@@ -335,6 +657,10 @@ bool settings_init_config(bool force_clear)
 {
     HAL_StatusTypeDef ret = HAL_OK;
 
+    /* Find the journal pages first, as a new config page has to supersede them */
+    ret = settings_config_journal_scan();
+    if (ret != HAL_OK) { return false; }
+
     if (force_clear) {
         log_i("Clearing config page");
         ret = settings_init_default_config();
@@ -343,7 +669,7 @@ bool settings_init_config(bool force_clear)
         uint8_t data[PAGE_CONFIG_SIZE];
 
         log_i("Loading config page");
-        ret = m24m01_read_buffer(eeprom_i2c, PAGE_CONFIG, data, sizeof(data));
+        ret = settings_read_buffer(PAGE_CONFIG, data, sizeof(data));
         if (ret != HAL_OK) { return false; }
 
         uint32_t config_version = copy_to_u32(data + CONFIG_VERSION);
@@ -352,6 +678,8 @@ bool settings_init_config(bool force_clear)
             ret = settings_init_default_config();
             if (ret != HAL_OK) { return false; }
         } else {
+            ret = settings_config_journal_replay(data);
+            if (ret != HAL_OK) { return false; }
             settings_init_parse_config_page(data);
         }
     }
@@ -376,7 +704,211 @@ HAL_StatusTypeDef settings_init_default_config()
     copy_from_u32(data + CONFIG_TESTSTRIP_PATCHES,      DEFAULT_TESTSTRIP_PATCHES);
     copy_from_u32(data + CONFIG_ENLARGER_CONFIG,        DEFAULT_ENLARGER_CONFIG);
     copy_from_u32(data + CONFIG_PAPER_PROFILE,          DEFAULT_PAPER_PROFILE);
-    return m24m01_write_page(eeprom_i2c, PAGE_CONFIG, data, sizeof(data));
+    copy_from_u32(data + CONFIG_JOURNAL_SEQUENCE,       journal_sequence);
+    copy_from_u32(data + CONFIG_SECONDARY_ENLARGER_CONFIG, 0);
+
+    /* Any existing journal pages are now stale */
+    journal_base_sequence = journal_sequence;
+    journal_record = JOURNAL_RECORD_COUNT;
+
+    return settings_write_buffer(PAGE_CONFIG, data, sizeof(data));
+}
+
+HAL_StatusTypeDef settings_config_journal_scan()
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    uint8_t data[JOURNAL_RECORD_0];
+
+    journal_sequence = 0;
+    journal_page = JOURNAL_PAGE_COUNT - 1;
+    journal_record = JOURNAL_RECORD_COUNT;
+
+    for (uint8_t i = 0; i < JOURNAL_PAGE_COUNT; i++) {
+        ret = settings_read_buffer(PAGE_CONFIG_JOURNAL_BASE + (PAGE_SIZE * i), data, sizeof(data));
+        if (ret != HAL_OK) { break; }
+
+        if (memcmp(data + JOURNAL_MAGIC, "JRNL", 4) != 0) {
+            journal_page_sequence[i] = UINT32_MAX;
+            continue;
+        }
+
+        journal_page_sequence[i] = copy_to_u32(data + JOURNAL_SEQUENCE);
+        if (journal_page_sequence[i] >= journal_sequence) {
+            journal_sequence = journal_page_sequence[i];
+            journal_page = i;
+        }
+    }
+
+    return ret;
+}
+
+HAL_StatusTypeDef settings_config_journal_replay(uint8_t *config_data)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    uint8_t data[PAGE_SIZE];
+    uint8_t check[3];
+    size_t replayed = 0;
+
+    journal_base_sequence = copy_to_u32(config_data + CONFIG_JOURNAL_SEQUENCE);
+    if (journal_base_sequence >= journal_sequence) {
+        /* Nothing newer than the config page, so the next change starts a new page */
+        journal_sequence = journal_base_sequence;
+        journal_record = JOURNAL_RECORD_COUNT;
+        return HAL_OK;
+    }
+
+    /* Replay pages in sequence order, starting with the oldest that is still newer than the config page */
+    for (uint32_t sequence = journal_base_sequence + 1; sequence <= journal_sequence; sequence++) {
+        uint8_t page = JOURNAL_PAGE_COUNT;
+        for (uint8_t i = 0; i < JOURNAL_PAGE_COUNT; i++) {
+            if (journal_page_sequence[i] == sequence) {
+                page = i;
+                break;
+            }
+        }
+        if (page == JOURNAL_PAGE_COUNT) { continue; }
+
+        ret = settings_read_buffer(PAGE_CONFIG_JOURNAL_BASE + (PAGE_SIZE * page), data, sizeof(data));
+        if (ret != HAL_OK) { break; }
+
+        uint8_t record_index;
+        for (record_index = 0; record_index < JOURNAL_RECORD_COUNT; record_index++) {
+            const uint8_t *record = data + JOURNAL_RECORD_0 + (JOURNAL_RECORD_SIZE * record_index);
+            uint8_t offset = record[JOURNAL_RECORD_OFFSET];
+            if (offset == 0xFF) { break; }
+
+            /* Skip anything left incomplete by an interrupted write */
+            settings_config_journal_record_check(record, check);
+            if (memcmp(record + JOURNAL_RECORD_CHECK, check, sizeof(check)) != 0
+                || offset < CONFIG_EXPOSURE_TIME || offset == CONFIG_JOURNAL_SEQUENCE
+                || offset > CONFIG_SECONDARY_ENLARGER_CONFIG || (offset % 4) != 0) {
+                log_w("Skipping invalid journal record: %d/%d", page, record_index);
+                continue;
+            }
+
+            memcpy(config_data + offset, record + JOURNAL_RECORD_VALUE, 4);
+            replayed++;
+        }
+
+        if (page == journal_page) {
+            journal_record = record_index;
+        }
+    }
+
+    log_i("Replayed %d journal records", replayed);
+    return ret;
+}
+
+void settings_config_journal_record_check(const uint8_t *record, uint8_t *check)
+{
+    uint32_t crc = settings_crc32(record, JOURNAL_RECORD_CHECK);
+    check[0] = (uint8_t)((crc >> 16) & 0xFF);
+    check[1] = (uint8_t)((crc >> 8) & 0xFF);
+    check[2] = (uint8_t)(crc & 0xFF);
+}
+
+bool settings_config_journal_append(uint32_t offset, uint32_t val)
+{
+    uint8_t record[JOURNAL_RECORD_SIZE];
+    bool result = false;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    do {
+        if (journal_record >= JOURNAL_RECORD_COUNT) {
+            if (!settings_config_journal_next_page()) { break; }
+        }
+
+        record[JOURNAL_RECORD_OFFSET] = (uint8_t)offset;
+        copy_from_u32(record + JOURNAL_RECORD_VALUE, val);
+        settings_config_journal_record_check(record, record + JOURNAL_RECORD_CHECK);
+
+        if (settings_write_buffer(PAGE_CONFIG_JOURNAL_BASE + (PAGE_SIZE * journal_page)
+            + JOURNAL_RECORD_0 + (JOURNAL_RECORD_SIZE * journal_record),
+            record, sizeof(record)) != HAL_OK) {
+            break;
+        }
+        journal_record++;
+        result = true;
+    } while (0);
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return result;
+}
+
+bool settings_config_journal_next_page()
+{
+    uint8_t data[PAGE_SIZE];
+    uint8_t next_page = (journal_page + 1) % JOURNAL_PAGE_COUNT;
+
+    /* Fold the current values into the config page before replacing changes it does not have */
+    if (journal_page_sequence[next_page] != UINT32_MAX
+        && journal_page_sequence[next_page] > journal_base_sequence) {
+        settings_page_edit_t edit;
+        settings_page_edit_begin(&edit, PAGE_CONFIG);
+        if (!settings_config_journal_compact(&edit)) {
+            return false;
+        }
+    }
+
+    /* Start the page with all of its records blank */
+    memset(data, 0xFF, sizeof(data));
+    memcpy(data + JOURNAL_MAGIC, "JRNL", 4);
+    copy_from_u32(data + JOURNAL_SEQUENCE, journal_sequence + 1);
+
+    if (settings_write_buffer(PAGE_CONFIG_JOURNAL_BASE + (PAGE_SIZE * next_page), data, sizeof(data)) != HAL_OK) {
+        return false;
+    }
+
+    journal_sequence++;
+    journal_page = next_page;
+    journal_page_sequence[next_page] = journal_sequence;
+    journal_record = 0;
+    return true;
+}
+
+/**
+ * Write all the current config values into the config page, marking
+ * every journal page written so far as folded into it.
+ *
+ * @param edit Page edit to commit, which may already contain some of the values
+ */
+bool settings_config_journal_compact(settings_page_edit_t *edit)
+{
+    bool result;
+
+    /* Only fields set by the caller count towards the write cycles saved */
+    const uint16_t field_count = edit->field_count;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    settings_page_edit_set_u32(edit, CONFIG_VERSION,                LATEST_CONFIG_VERSION);
+    settings_page_edit_set_u32(edit, CONFIG_EXPOSURE_TIME,          setting_default_exposure_time);
+    settings_page_edit_set_u32(edit, CONFIG_CONTRAST_GRADE,         setting_default_contrast_grade);
+    settings_page_edit_set_u32(edit, CONFIG_STEP_SIZE,              setting_default_step_size);
+    settings_page_edit_set_u32(edit, CONFIG_MENU_TIMEOUT,           setting_menu_timeout);
+    settings_page_edit_set_u32(edit, CONFIG_ENLARGER_FOCUS_TIMEOUT, setting_enlarger_focus_timeout);
+    settings_page_edit_set_u32(edit, CONFIG_DISPLAY_BRIGHTNESS,     setting_display_brightness);
+    settings_page_edit_set_u32(edit, CONFIG_LED_BRIGHTNESS,         setting_led_brightness);
+    settings_page_edit_set_u32(edit, CONFIG_BUZZER_VOLUME,          setting_buzzer_volume);
+    settings_page_edit_set_u32(edit, CONFIG_TESTSTRIP_MODE,         setting_teststrip_mode);
+    settings_page_edit_set_u32(edit, CONFIG_TESTSTRIP_PATCHES,      setting_teststrip_patches);
+    settings_page_edit_set_u32(edit, CONFIG_ENLARGER_CONFIG,        setting_enlarger_config);
+    settings_page_edit_set_u32(edit, CONFIG_PAPER_PROFILE,          setting_paper_profile);
+    settings_page_edit_set_u32(edit, CONFIG_JOURNAL_SEQUENCE,       journal_sequence);
+    settings_page_edit_set_u32(edit, CONFIG_SECONDARY_ENLARGER_CONFIG,
+        (setting_secondary_enlarger_config < MAX_ENLARGER_CONFIGS) ? setting_secondary_enlarger_config + 1 : 0);
+    edit->field_count = field_count;
+
+    result = settings_page_edit_commit(edit);
+    if (result) {
+        log_i("Compacted config journal at sequence %lu", journal_sequence);
+        journal_base_sequence = journal_sequence;
+
+        /* Later changes must go into a page newer than the config page */
+        journal_record = JOURNAL_RECORD_COUNT;
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return result;
 }
 
 void settings_init_parse_config_page(const uint8_t *data)
@@ -465,6 +997,13 @@ void settings_init_parse_config_page(const uint8_t *data)
     } else {
         setting_paper_profile = UINT8_MAX;
     }
+
+    val = copy_to_u32(data + CONFIG_SECONDARY_ENLARGER_CONFIG);
+    if (val > 0 && val <= MAX_ENLARGER_CONFIGS) {
+        setting_secondary_enlarger_config = val - 1;
+    } else {
+        setting_secondary_enlarger_config = UINT8_MAX;
+    }
 }
 
 bool settings_init_config2(bool force_clear)
@@ -522,119 +1061,533 @@ bool settings_clear_config2()
     return true;
 }
 
-HAL_StatusTypeDef settings_clear(I2C_HandleTypeDef *hi2c)
+bool settings_init_profile_index(bool force_clear)
 {
     HAL_StatusTypeDef ret = HAL_OK;
+    uint32_t version = 0;
 
-    if (!hi2c) {
-        return HAL_ERROR;
+    if (!force_clear) {
+        if (!read_u32(PAGE_PROFILE_INDEX + PROFILE_INDEX_VERSION, &version)) {
+            return false;
+        }
+        if (version != LATEST_PROFILE_INDEX_VERSION) {
+            log_w("Unexpected profile index version: %d != %d", version, LATEST_PROFILE_INDEX_VERSION);
+        }
     }
 
-    uint8_t data[PAGE_SIZE];
-    memset(data, 0xFF, sizeof(data));
+    if (!force_clear && version == LATEST_PROFILE_INDEX_VERSION) {
+        log_i("Loading profile index");
+        ret = settings_load_profile_index(enlarger_config_index, PAGE_ENLARGER_INDEX_BASE, MAX_ENLARGER_CONFIGS);
+        if (ret != HAL_OK) { return false; }
 
-    do {
-        log_i("settings_clear");
+        ret = settings_load_profile_index(paper_profile_index, PAGE_PAPER_INDEX_BASE, MAX_PAPER_PROFILES);
+        if (ret != HAL_OK) { return false; }
+    } else {
+        log_i("Profile index needs rebuilding");
 
-        ret = m24m01_write_page(hi2c, PAGE_HEADER, data, sizeof(data));
-        if (ret != HAL_OK) { break; }
+        /* Zero the page version, so an interrupted rebuild is repeated */
+        if (!write_u32(PAGE_PROFILE_INDEX + PROFILE_INDEX_VERSION, 0UL)) {
+            return false;
+        }
 
-        ret = m24m01_write_page(hi2c, PAGE_CONFIG, data, sizeof(data));
-        if (ret != HAL_OK) { break; }
+        /*
+         * Rebuilding requires reading every profile record, so it is left
+         * to the settings task. Until then, lookups load the record itself.
+         */
+        memset(enlarger_config_index, 0, sizeof(enlarger_config_index));
+        memset(paper_profile_index, 0, sizeof(paper_profile_index));
+        settings_profile_index_pending = true;
+    }
+    return true;
+}
 
-        ret = m24m01_write_page(hi2c, PAGE_CONFIG2, data, sizeof(data));
+HAL_StatusTypeDef settings_load_profile_index(profile_index_entry_t *index_list, uint32_t index_base, size_t count)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    uint8_t data[PAGE_SIZE];
+    const size_t entries_per_page = PAGE_SIZE / PROFILE_INDEX_ENTRY_SIZE;
+
+    for (size_t i = 0; i < count; i += entries_per_page) {
+        ret = settings_read_buffer(index_base + (PROFILE_INDEX_ENTRY_SIZE * i), data, sizeof(data));
         if (ret != HAL_OK) { break; }
 
-    } while (0);
+        for (size_t j = 0; j < entries_per_page && (i + j) < count; j++) {
+            const uint8_t *entry_data = data + (PROFILE_INDEX_ENTRY_SIZE * j);
+            profile_index_entry_t *entry = &index_list[i + j];
+            entry->version = copy_to_u32(entry_data + PROFILE_INDEX_ENTRY_VERSION);
+            entry->crc = copy_to_u32(entry_data + PROFILE_INDEX_ENTRY_CRC);
+            strncpy(entry->name, (const char *)(entry_data + PROFILE_INDEX_ENTRY_NAME), PROFILE_NAME_LEN);
+            entry->name[PROFILE_NAME_LEN - 1] = '\0';
+        }
+    }
 
     return ret;
 }
 
-uint32_t settings_get_default_exposure_time()
+HAL_StatusTypeDef settings_rebuild_profile_index(profile_index_entry_t *index_list, uint32_t index_base,
+    settings_record_state_t *record_list, uint32_t page_base, uint32_t alt_page_base, size_t count)
 {
-    return setting_default_exposure_time;
-}
+    HAL_StatusTypeDef ret = HAL_OK;
+    uint8_t data[PAGE_SIZE];
 
-void settings_set_default_exposure_time(uint32_t exposure_time)
-{
-    if (setting_default_exposure_time != exposure_time
-        && exposure_time > 1000 && exposure_time <= 999000) {
-        if (write_u32(PAGE_CONFIG + CONFIG_EXPOSURE_TIME, exposure_time)) {
-            setting_default_exposure_time = exposure_time;
-        }
-    }
-}
+    for (size_t i = 0; i < count; i++) {
+        /* Release the mutex between entries, so other bus users are not held off */
+        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+        do {
+            ret = settings_record_read(page_base + (PAGE_SIZE * i), alt_page_base + (PAGE_SIZE * i),
+                PAGE_SIZE, &record_list[i], data);
+            if (ret != HAL_OK) { break; }
 
-contrast_grade_t settings_get_default_contrast_grade()
-{
-    return setting_default_contrast_grade;
-}
+            /* Force the entry to be written, regardless of what it held before */
+            index_list[i].version = 0;
+            index_list[i].crc = 0;
 
-void settings_set_default_contrast_grade(contrast_grade_t contrast_grade)
-{
-    if (setting_default_contrast_grade != contrast_grade
-        && contrast_grade >= CONTRAST_GRADE_00 && contrast_grade <= CONTRAST_GRADE_5) {
-        if (write_u32(PAGE_CONFIG + CONFIG_CONTRAST_GRADE, contrast_grade)) {
-            setting_default_contrast_grade = contrast_grade;
-        }
+            ret = settings_update_profile_index(&index_list[i], index_base, i, data);
+        } while (0);
+        osMutexRelease(eeprom_i2c_mutex);
+        if (ret != HAL_OK) { break; }
     }
-}
 
-exposure_adjustment_increment_t settings_get_default_step_size()
-{
-    return setting_default_step_size;
+    return ret;
 }
 
-void settings_set_default_step_size(exposure_adjustment_increment_t step_size)
+/**
+ * Update a profile index entry to match the provided profile page,
+ * writing it out if anything has changed.
+ *
+ * @param entry Index entry to update
+ * @param index_base Base address of the index entries for this profile type
+ * @param index Slot of the profile page
+ * @param data Contents of the profile page, or NULL if it has been erased
+ */
+HAL_StatusTypeDef settings_update_profile_index(profile_index_entry_t *entry, uint32_t index_base, uint8_t index, const uint8_t *data)
 {
-    if (setting_default_step_size != step_size
-        && step_size >= EXPOSURE_ADJ_TWELFTH && step_size <=  EXPOSURE_ADJ_WHOLE) {
-        if (write_u32(PAGE_CONFIG + CONFIG_STEP_SIZE, step_size)) {
-            setting_default_step_size = step_size;
-        }
+    uint8_t blank[PAGE_SIZE];
+    uint8_t buf[PROFILE_INDEX_ENTRY_SIZE];
+
+    if (!data) {
+        memset(blank, 0xFF, sizeof(blank));
+        data = blank;
     }
-}
 
-uint32_t settings_get_menu_timeout()
-{
-    return setting_menu_timeout;
-}
+    uint32_t crc = settings_crc32(data, PAGE_SIZE);
+    if (entry->crc == crc && entry->version == copy_to_u32(data)) {
+        return HAL_OK;
+    }
 
-void settings_set_menu_timeout(uint32_t timeout)
-{
-    if (setting_menu_timeout != timeout
-        && timeout <= (10 * 60000)) {
-        if (write_u32(PAGE_CONFIG + CONFIG_MENU_TIMEOUT, timeout)) {
-            setting_menu_timeout = timeout;
-        }
+    /* The name field is at the same offset in every profile page type */
+    entry->version = copy_to_u32(data);
+    entry->crc = crc;
+    strncpy(entry->name, (const char *)(data + ENLARGER_CONFIG_NAME), PROFILE_NAME_LEN);
+    entry->name[PROFILE_NAME_LEN - 1] = '\0';
+
+    memset(buf, 0xFF, sizeof(buf));
+    copy_from_u32(buf + PROFILE_INDEX_ENTRY_VERSION, entry->version);
+    copy_from_u32(buf + PROFILE_INDEX_ENTRY_CRC, entry->crc);
+    memcpy(buf + PROFILE_INDEX_ENTRY_NAME, entry->name, PROFILE_NAME_LEN);
+
+    HAL_StatusTypeDef ret = settings_write_buffer(
+        index_base + (PROFILE_INDEX_ENTRY_SIZE * index),
+        buf, sizeof(buf));
+    if (ret != HAL_OK) {
+        log_e("Unable to write profile index entry: %d", ret);
     }
+    return ret;
 }
 
-uint32_t settings_get_enlarger_focus_timeout()
+bool settings_profile_index_is_valid(const profile_index_entry_t *entry, uint32_t latest_version)
 {
-    return setting_enlarger_focus_timeout;
+    return entry->version != 0 && entry->version <= latest_version;
 }
 
-void settings_set_enlarger_focus_timeout(uint32_t timeout)
+/**
+ * Read the current copy of a profile record.
+ *
+ * Both slots are read and checked once, and the newer of the valid
+ * copies is returned. If the current copy is an erased record, or
+ * neither slot holds anything usable, the returned record is blank.
+ *
+ * @param address Address of the first slot
+ * @param alt_address Address of the second slot
+ * @param length Size of each slot, including the trailer
+ * @param state Slot state of the record, updated from what was read
+ * @param data Buffer of 'length' bytes to read the record into
+ */
+HAL_StatusTypeDef settings_record_read(uint32_t address, uint32_t alt_address, size_t length,
+    settings_record_state_t *state, uint8_t *data)
 {
-    if (setting_enlarger_focus_timeout != timeout
-        && timeout <= (10 * 60000)) {
-        if (write_u32(PAGE_CONFIG + CONFIG_ENLARGER_FOCUS_TIMEOUT, timeout)) {
-            setting_enlarger_focus_timeout = timeout;
+    HAL_StatusTypeDef ret = HAL_OK;
+    uint8_t alt_page[PAGE_SIZE];
+    uint8_t *alt_data = alt_page;
+
+    /* Records that span multiple pages need a second buffer from the heap */
+    if (length > sizeof(alt_page)) {
+        alt_data = pvPortMalloc(length);
+        if (!alt_data) {
+            log_e("Unable to allocate record buffer");
+            return HAL_ERROR;
         }
     }
-}
 
-uint8_t settings_get_display_brightness()
-{
-    return setting_display_brightness;
-}
+    do {
+        ret = settings_read_buffer(address, data, length);
+        if (ret != HAL_OK) { break; }
+
+        ret = settings_read_buffer(alt_address, alt_data, length);
+        if (ret != HAL_OK) { break; }
+
+        bool valid = settings_record_is_valid(data, length);
+        bool alt_valid = settings_record_is_valid(alt_data, length);
+
+        if (valid && alt_valid) {
+            /* Sequence numbers wrap, but the two copies are always adjacent */
+            if ((int8_t)(alt_data[RECORD_SEQUENCE(length)] - data[RECORD_SEQUENCE(length)]) > 0) {
+                valid = false;
+            } else {
+                alt_valid = false;
+            }
+        }
+
+        if (alt_valid) {
+            memcpy(data, alt_data, length);
+            state->slot = 1;
+            state->sequence = data[RECORD_SEQUENCE(length)];
+        } else if (valid) {
+            state->slot = 0;
+            state->sequence = data[RECORD_SEQUENCE(length)];
+        } else {
+            state->slot = RECORD_SLOT_NONE;
+            state->sequence = 0;
+
+            /* Keep pages written before the trailer was added, otherwise treat as empty */
+            bool is_legacy = length == PAGE_SIZE
+                && data[RECORD_SEQUENCE(length)] == 0 && data[RECORD_CHECK(length)] == 0
+                && data[RECORD_CHECK(length) + 1] == 0 && data[RECORD_CHECK(length) + 2] == 0;
+            if (!is_legacy) {
+                if (copy_to_u32(data) != UINT32_MAX || copy_to_u32(alt_data) != UINT32_MAX) {
+                    log_w("No valid record at 0x%05lX", address);
+                }
+                memset(data, 0xFF, length);
+            }
+        }
+
+        if (copy_to_u32(data) == UINT32_MAX) {
+            /* Erased record, so return it as blank */
+            memset(data, 0xFF, length);
+        }
+
+        state->known = true;
+    } while (0);
+
+    if (alt_data != alt_page) {
+        vPortFree(alt_data);
+    }
+    return ret;
+}
+
+/**
+ * Write a new copy of a profile record into whichever slot does not
+ * hold the current copy.
+ *
+ * @param address Address of the first slot
+ * @param alt_address Address of the second slot
+ * @param length Size of each slot, including the trailer
+ * @param state Slot state of the record, updated if the write succeeds
+ * @param data Record contents, which get the trailer filled in
+ */
+HAL_StatusTypeDef settings_record_write(uint32_t address, uint32_t alt_address, size_t length,
+    settings_record_state_t *state, uint8_t *data)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    if (!state->known) {
+        uint8_t current_page[PAGE_SIZE];
+        uint8_t *current = (length > sizeof(current_page)) ? pvPortMalloc(length) : current_page;
+        if (!current) {
+            log_e("Unable to allocate record buffer");
+            return HAL_ERROR;
+        }
+        ret = settings_record_read(address, alt_address, length, state, current);
+        if (current != current_page) {
+            vPortFree(current);
+        }
+        if (ret != HAL_OK) { return ret; }
+    }
+
+    /* With no valid copy, the first slot may still hold a page from before the trailer */
+    uint8_t slot = (state->slot == 1) ? 0 : 1;
+
+    data[RECORD_SEQUENCE(length)] = state->sequence + 1;
+    settings_record_check(data, length, data + RECORD_CHECK(length));
+
+    /*
+     * The trailer is at the end, and pages are written in order, so it always lands last.
+     * The record is written straight through, as the slot state must only move on
+     * once the new copy is actually on the device.
+     */
+    ret = settings_write_through((slot == 1) ? alt_address : address, data, length);
+    if (ret == HAL_OK) {
+        state->slot = slot;
+        state->sequence = data[RECORD_SEQUENCE(length)];
+    } else {
+        /* The slot contents are no longer certain */
+        state->known = false;
+    }
+    return ret;
+}
+
+bool settings_record_is_valid(const uint8_t *data, size_t length)
+{
+    uint8_t check[3];
+    settings_record_check(data, length, check);
+    return memcmp(data + RECORD_CHECK(length), check, sizeof(check)) == 0;
+}
+
+void settings_record_check(const uint8_t *data, size_t length, uint8_t *check)
+{
+    uint32_t crc = settings_crc32(data, RECORD_CHECK(length));
+    check[0] = (uint8_t)((crc >> 16) & 0xFF);
+    check[1] = (uint8_t)((crc >> 8) & 0xFF);
+    check[2] = (uint8_t)(crc & 0xFF);
+}
+
+HAL_StatusTypeDef settings_clear(I2C_HandleTypeDef *hi2c)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    if (!hi2c) {
+        return HAL_ERROR;
+    }
+
+    uint8_t data[PAGE_SIZE];
+    memset(data, 0xFF, sizeof(data));
+
+    do {
+        log_i("settings_clear");
+
+        ret = m24m01_write_page(hi2c, PAGE_HEADER, data, sizeof(data));
+        if (ret != HAL_OK) { break; }
+
+        ret = m24m01_write_page(hi2c, PAGE_CONFIG, data, sizeof(data));
+        if (ret != HAL_OK) { break; }
+
+        ret = m24m01_write_page(hi2c, PAGE_CONFIG2, data, sizeof(data));
+        if (ret != HAL_OK) { break; }
+
+        ret = m24m01_write_page(hi2c, PAGE_PROFILE_INDEX, data, sizeof(data));
+        if (ret != HAL_OK) { break; }
+
+    } while (0);
+
+    return ret;
+}
+
+void settings_begin_config_edit()
+{
+    if (config_edit_open) {
+        log_w("Config edit already open");
+        return;
+    }
+    settings_page_edit_begin(&config_edit, PAGE_CONFIG);
+    config_edit_owner = osThreadGetId();
+    config_edit_open = true;
+}
+
+bool settings_commit_config_edit()
+{
+    if (!config_edit_open || config_edit_owner != osThreadGetId()) {
+        return false;
+    }
+    config_edit_open = false;
+    config_edit_owner = NULL;
+
+    /* The whole page is rewritten, so this also compacts the journal */
+    if (!settings_config_journal_compact(&config_edit)) {
+        /*
+         * Setters update their values as soon as the change is buffered,
+         * so restore them from whatever actually made it to the EEPROM.
+         */
+        log_w("Config edit not saved, reloading values");
+        settings_init_config(false);
+        return false;
+    }
+    return true;
+}
+
+uint32_t settings_get_write_cycles_saved()
+{
+    return settings_write_cycles_saved;
+}
+
+void settings_page_edit_begin(settings_page_edit_t *edit, uint32_t page_address)
+{
+    memset(edit->dirty, 0, sizeof(edit->dirty));
+    edit->address = page_address;
+    edit->field_count = 0;
+}
+
+void settings_page_edit_set(settings_page_edit_t *edit, uint32_t offset, const uint8_t *data, size_t data_len)
+{
+    if (offset + data_len > PAGE_SIZE) {
+        log_e("Page edit exceeds page boundary: %d+%d", offset, data_len);
+        return;
+    }
+
+    memcpy(edit->data + offset, data, data_len);
+    for (size_t i = offset; i < offset + data_len; i++) {
+        edit->dirty[i / 32] |= (1UL << (i % 32));
+    }
+    edit->field_count++;
+}
+
+void settings_page_edit_set_u32(settings_page_edit_t *edit, uint32_t offset, uint32_t val)
+{
+    uint8_t data[4];
+    copy_from_u32(data, val);
+    settings_page_edit_set(edit, offset, data, sizeof(data));
+}
+
+bool settings_page_edit_commit(settings_page_edit_t *edit)
+{
+    size_t start = PAGE_SIZE;
+    size_t end = 0;
+    bool has_gaps = false;
+
+    /* Find the span covering all the modified bytes */
+    for (size_t i = 0; i < PAGE_SIZE; i++) {
+        if (edit->dirty[i / 32] & (1UL << (i % 32))) {
+            if (start == PAGE_SIZE) {
+                start = i;
+            } else if (i > end + 1) {
+                has_gaps = true;
+            }
+            end = i;
+        }
+    }
+    if (start == PAGE_SIZE) {
+        return true;
+    }
+
+    /* Fill any unmodified bytes within the span from the current page contents */
+    if (has_gaps) {
+        uint8_t current[PAGE_SIZE];
+        if (settings_read_buffer(edit->address + start, current + start, end - start + 1) != HAL_OK) {
+            return false;
+        }
+        for (size_t i = start; i <= end; i++) {
+            if (!(edit->dirty[i / 32] & (1UL << (i % 32)))) {
+                edit->data[i] = current[i];
+            }
+        }
+    }
+
+    if (settings_write_buffer(edit->address + start, edit->data + start, end - start + 1) != HAL_OK) {
+        return false;
+    }
+
+    if (edit->field_count > 1) {
+        settings_write_cycles_saved += edit->field_count - 1;
+        log_d("Page 0x%05lX: %d fields in one write, %lu write cycles saved overall",
+            edit->address, edit->field_count, settings_write_cycles_saved);
+    }
+    return true;
+}
+
+bool settings_config_write_u32(uint32_t offset, uint32_t val)
+{
+    if (config_edit_open && config_edit_owner == osThreadGetId()) {
+        settings_page_edit_set_u32(&config_edit, offset, val);
+        return true;
+    } else {
+        return settings_config_journal_append(offset, val);
+    }
+}
+
+uint32_t settings_get_default_exposure_time()
+{
+    return setting_default_exposure_time;
+}
+
+void settings_set_default_exposure_time(uint32_t exposure_time)
+{
+    if (setting_default_exposure_time != exposure_time
+        && exposure_time > 1000 && exposure_time <= 999000) {
+        if (settings_config_write_u32(CONFIG_EXPOSURE_TIME, exposure_time)) {
+            setting_default_exposure_time = exposure_time;
+        }
+    }
+}
+
+contrast_grade_t settings_get_default_contrast_grade()
+{
+    return setting_default_contrast_grade;
+}
+
+void settings_set_default_contrast_grade(contrast_grade_t contrast_grade)
+{
+    if (setting_default_contrast_grade != contrast_grade
+        && contrast_grade >= CONTRAST_GRADE_00 && contrast_grade <= CONTRAST_GRADE_5) {
+        if (settings_config_write_u32(CONFIG_CONTRAST_GRADE, contrast_grade)) {
+            setting_default_contrast_grade = contrast_grade;
+        }
+    }
+}
+
+exposure_adjustment_increment_t settings_get_default_step_size()
+{
+    return setting_default_step_size;
+}
+
+void settings_set_default_step_size(exposure_adjustment_increment_t step_size)
+{
+    if (setting_default_step_size != step_size
+        && step_size >= EXPOSURE_ADJ_TWELFTH && step_size <=  EXPOSURE_ADJ_WHOLE) {
+        if (settings_config_write_u32(CONFIG_STEP_SIZE, step_size)) {
+            setting_default_step_size = step_size;
+        }
+    }
+}
+
+uint32_t settings_get_menu_timeout()
+{
+    return setting_menu_timeout;
+}
+
+void settings_set_menu_timeout(uint32_t timeout)
+{
+    if (setting_menu_timeout != timeout
+        && timeout <= (10 * 60000)) {
+        if (settings_config_write_u32(CONFIG_MENU_TIMEOUT, timeout)) {
+            setting_menu_timeout = timeout;
+        }
+    }
+}
+
+uint32_t settings_get_enlarger_focus_timeout()
+{
+    return setting_enlarger_focus_timeout;
+}
+
+void settings_set_enlarger_focus_timeout(uint32_t timeout)
+{
+    if (setting_enlarger_focus_timeout != timeout
+        && timeout <= (10 * 60000)) {
+        if (settings_config_write_u32(CONFIG_ENLARGER_FOCUS_TIMEOUT, timeout)) {
+            setting_enlarger_focus_timeout = timeout;
+        }
+    }
+}
+
+uint8_t settings_get_display_brightness()
+{
+    return setting_display_brightness;
+}
 
 void settings_set_display_brightness(uint8_t brightness)
 {
     if (setting_display_brightness != brightness
         && brightness <= 0x0F) {
-        if (write_u32(PAGE_CONFIG + CONFIG_DISPLAY_BRIGHTNESS, brightness)) {
+        if (settings_config_write_u32(CONFIG_DISPLAY_BRIGHTNESS, brightness)) {
             setting_display_brightness = brightness;
         }
     }
@@ -648,7 +1601,7 @@ uint8_t settings_get_led_brightness()
 void settings_set_led_brightness(uint8_t brightness)
 {
     if (setting_led_brightness != brightness) {
-        if (write_u32(PAGE_CONFIG + CONFIG_LED_BRIGHTNESS, brightness)) {
+        if (settings_config_write_u32(CONFIG_LED_BRIGHTNESS, brightness)) {
             setting_led_brightness = brightness;
         }
     }
@@ -663,7 +1616,7 @@ void settings_set_buzzer_volume(buzzer_volume_t volume)
 {
     if (setting_buzzer_volume != volume
         && volume >= BUZZER_VOLUME_OFF && volume <= BUZZER_VOLUME_HIGH) {
-        if (write_u32(PAGE_CONFIG + CONFIG_BUZZER_VOLUME, volume)) {
+        if (settings_config_write_u32(CONFIG_BUZZER_VOLUME, volume)) {
             setting_buzzer_volume = volume;
         }
     }
@@ -678,7 +1631,7 @@ void settings_set_teststrip_mode(teststrip_mode_t mode)
 {
     if (setting_teststrip_mode != mode
         && mode >= TESTSTRIP_MODE_INCREMENTAL && mode <= TESTSTRIP_MODE_SEPARATE) {
-        if (write_u32(PAGE_CONFIG + CONFIG_TESTSTRIP_MODE, mode)) {
+        if (settings_config_write_u32(CONFIG_TESTSTRIP_MODE, mode)) {
             setting_teststrip_mode = mode;
         }
     }
@@ -693,7 +1646,7 @@ void settings_set_teststrip_patches(teststrip_patches_t patches)
 {
     if (setting_teststrip_patches != patches
         && patches >= TESTSTRIP_PATCHES_7 && patches <= TESTSTRIP_PATCHES_5) {
-        if (write_u32(PAGE_CONFIG + CONFIG_TESTSTRIP_PATCHES, patches)) {
+        if (settings_config_write_u32(CONFIG_TESTSTRIP_PATCHES, patches)) {
             setting_teststrip_patches = patches;
         }
     }
@@ -707,12 +1660,26 @@ uint8_t settings_get_default_enlarger_config_index()
 void settings_set_default_enlarger_config_index(uint8_t index)
 {
     if (setting_enlarger_config != index && index < MAX_ENLARGER_CONFIGS) {
-        if (write_u32(PAGE_CONFIG + CONFIG_ENLARGER_CONFIG, index)) {
+        if (settings_config_write_u32(CONFIG_ENLARGER_CONFIG, index)) {
             setting_enlarger_config = index;
         }
     }
 }
 
+uint8_t settings_get_secondary_enlarger_config_index()
+{
+    return setting_secondary_enlarger_config;
+}
+
+void settings_set_secondary_enlarger_config_index(uint8_t index)
+{
+    if (setting_secondary_enlarger_config != index && (index < MAX_ENLARGER_CONFIGS || index == UINT8_MAX)) {
+        if (settings_config_write_u32(CONFIG_SECONDARY_ENLARGER_CONFIG, (index < MAX_ENLARGER_CONFIGS) ? index + 1 : 0)) {
+            setting_secondary_enlarger_config = index;
+        }
+    }
+}
+
 uint8_t settings_get_default_paper_profile_index()
 {
     return setting_paper_profile;
@@ -721,7 +1688,7 @@ uint8_t settings_get_default_paper_profile_index()
 void settings_set_default_paper_profile_index(uint8_t index)
 {
     if (setting_paper_profile != index && (index < MAX_PAPER_PROFILES || index == UINT8_MAX)) {
-        if (write_u32(PAGE_CONFIG + CONFIG_PAPER_PROFILE, index)) {
+        if (settings_config_write_u32(CONFIG_PAPER_PROFILE, index)) {
             setting_paper_profile = index;
         }
     }
@@ -767,7 +1734,7 @@ bool settings_load_safelight_config()
 {
     uint8_t buf[CONFIG2_SAFELIGHT_CONTROL_SIZE];
 
-    if (m24m01_read_buffer(eeprom_i2c, PAGE_CONFIG2 + CONFIG2_SAFELIGHT_CONTROL, buf, sizeof(buf)) != HAL_OK) {
+    if (settings_read_buffer(PAGE_CONFIG2 + CONFIG2_SAFELIGHT_CONTROL, buf, sizeof(buf)) != HAL_OK) {
         return false;
     }
 
@@ -811,7 +1778,7 @@ bool settings_set_safelight_config(const safelight_config_t *safelight_config)
     copy_from_u32(&buf[8], safelight_config->turn_off_delay);
 
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    ret = m24m01_write_buffer(eeprom_i2c, PAGE_CONFIG2 + CONFIG2_SAFELIGHT_CONTROL, buf, sizeof(buf));
+    ret = settings_write_buffer(PAGE_CONFIG2 + CONFIG2_SAFELIGHT_CONTROL, buf, sizeof(buf));
     osMutexRelease(eeprom_i2c_mutex);
 
     if (ret == HAL_OK) {
@@ -865,114 +1832,120 @@ bool settings_get_enlarger_config_name(char *name, uint8_t index)
 {
     if (!name || index >= MAX_ENLARGER_CONFIGS) { return false; }
 
-    log_i("Load enlarger config name: %d", index);
-
-    HAL_StatusTypeDef ret = HAL_OK;
-    uint8_t data[4 + PROFILE_NAME_LEN] = {0};
-
-    do {
-        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-        ret = m24m01_read_buffer(eeprom_i2c,
-            PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
-            data, sizeof(data));
-        osMutexRelease(eeprom_i2c_mutex);
-        if (ret != HAL_OK) { break; }
-
-        uint32_t config_version = copy_to_u32(data + ENLARGER_CONFIG_VERSION);
-        if (config_version == UINT32_MAX) {
-            log_d("Config index is empty");
-            ret = HAL_ERROR;
-            break;
-        }
-        if (config_version == 0 || config_version > LATEST_ENLARGER_CONFIG_VERSION) {
-            log_w("Invalid config version %ld", config_version);
-            ret = HAL_ERROR;
-            break;
-        }
+    bool result = false;
 
-        strncpy(name, (const char *)(data + ENLARGER_CONFIG_NAME), PROFILE_NAME_LEN);
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (settings_profile_index_pending) {
+        /* Loading the record also repairs its index entry */
+        settings_enlarger_config_cache_load(index);
+    }
+    if (settings_profile_index_is_valid(&enlarger_config_index[index], LATEST_ENLARGER_CONFIG_VERSION)) {
+        strncpy(name, enlarger_config_index[index].name, PROFILE_NAME_LEN);
         name[PROFILE_NAME_LEN - 1] = '\0';
+        result = true;
+    }
+    osMutexRelease(eeprom_i2c_mutex);
 
-    } while (0);
-
-    return (ret == HAL_OK);
+    return result;
 }
 
 bool settings_get_enlarger_config_dmx_control(bool *dmx_control, uint8_t index)
 {
     if (!dmx_control || index >= MAX_ENLARGER_CONFIGS) { return false; }
 
-    log_i("Load enlarger config dmx_mode: %d", index);
+    bool result = false;
 
-    HAL_StatusTypeDef ret = HAL_OK;
-    uint8_t data[5] = {0};
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (settings_enlarger_config_cache_load(index) == HAL_OK && enlarger_config_cache[index]) {
+        *dmx_control = enlarger_config_cache[index]->control.dmx_control;
+        result = true;
+    }
+    osMutexRelease(eeprom_i2c_mutex);
 
-    do {
-        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-        ret = m24m01_read_buffer(eeprom_i2c,
-            PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
-            data, 4);
-        if (ret == HAL_OK) {
-            ret = m24m01_read_buffer(eeprom_i2c,
-                PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index)
-                + ENLARGER_CONFIG_CONTROL_DMX_ENABLED,
-                data + 4, 1);
-        }
-        osMutexRelease(eeprom_i2c_mutex);
-        if (ret != HAL_OK) { break; }
-
-        uint32_t config_version = copy_to_u32(data + ENLARGER_CONFIG_VERSION);
-        if (config_version == UINT32_MAX) {
-            log_d("Config index is empty");
-            ret = HAL_ERROR;
-            break;
-        }
-        if (config_version == 0 || config_version > LATEST_ENLARGER_CONFIG_VERSION) {
-            log_w("Invalid config version %ld", config_version);
-            ret = HAL_ERROR;
-            break;
-        }
-
-        *dmx_control = (bool)data[4];
-    } while (0);
-
-    return (ret == HAL_OK);
-}
+    return result;
+}
 
 bool settings_get_enlarger_config(enlarger_config_t *config, uint8_t index)
 {
     if (!config || index >= MAX_ENLARGER_CONFIGS) { return false; }
 
-    log_i("Load enlarger config: %d", index);
+    bool result = false;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (settings_enlarger_config_cache_load(index) == HAL_OK && enlarger_config_cache[index]) {
+        memcpy(config, enlarger_config_cache[index], sizeof(enlarger_config_t));
+        result = true;
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return result;
+}
 
+HAL_StatusTypeDef settings_enlarger_config_cache_load(uint8_t index)
+{
     HAL_StatusTypeDef ret = HAL_OK;
     uint8_t data[PAGE_SIZE] = {0};
 
+    if (enlarger_config_cache_loaded & (1UL << index)) {
+        return HAL_OK;
+    }
+
+    log_i("Load enlarger config: %d", index);
+
     do {
-        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-        ret = m24m01_read_buffer(eeprom_i2c,
+        ret = settings_record_read(
             PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
-            data, sizeof(data));
-        osMutexRelease(eeprom_i2c_mutex);
+            PAGE_ENLARGER_CONFIG_ALT_BASE + (PAGE_SIZE * index),
+            PAGE_SIZE, &enlarger_config_record[index], data);
         if (ret != HAL_OK) { break; }
 
+        /* Repair the index entry if it has fallen out of sync with the page */
+        settings_update_profile_index(&enlarger_config_index[index], PAGE_ENLARGER_INDEX_BASE, index, data);
+
         uint32_t config_version = copy_to_u32(data + ENLARGER_CONFIG_VERSION);
         if (config_version == UINT32_MAX) {
             log_d("Config index is empty");
-            ret = HAL_ERROR;
+            settings_enlarger_config_cache_store(index, NULL);
             break;
         }
         if (config_version == 0 || config_version > LATEST_ENLARGER_CONFIG_VERSION) {
-            log_w("Invalid profile version %ld", config_version);
-            ret = HAL_ERROR;
+            log_w("Invalid config version %ld", config_version);
+            settings_enlarger_config_cache_store(index, NULL);
             break;
         }
 
-        settings_enlarger_config_parse_page(config, data);
-        enlarger_config_recalculate(config);
+        settings_enlarger_config_cache_store(index, data);
     } while (0);
 
-    return (ret == HAL_OK);
+    return ret;
+}
+
+void settings_enlarger_config_cache_store(uint8_t index, const uint8_t *data)
+{
+    enlarger_config_t *config = enlarger_config_cache[index];
+
+    if (!data) {
+        /* Slot is known to be empty */
+        vPortFree(config);
+        enlarger_config_cache[index] = NULL;
+        enlarger_config_cache_loaded |= (1UL << index);
+        return;
+    }
+
+    if (!config) {
+        config = pvPortMalloc(sizeof(enlarger_config_t));
+        if (!config) {
+            /* Leave the slot unloaded, so the next access tries again */
+            log_w("Unable to allocate enlarger config cache entry");
+            enlarger_config_cache_loaded &= ~(1UL << index);
+            return;
+        }
+        enlarger_config_cache[index] = config;
+    }
+
+    settings_enlarger_config_parse_page(config, data);
+    enlarger_config_recalculate(config);
+    enlarger_config_cache_loaded |= (1UL << index);
 }
 
 void settings_enlarger_config_parse_page(enlarger_config_t *config, const uint8_t *data)
@@ -1015,6 +1988,10 @@ void settings_enlarger_config_parse_page(enlarger_config_t *config, const uint8_
         config->control.grade_values[CONTRAST_WHOLE_GRADES[i]].channel_white = copy_to_u16(data + offset);
         offset += 2;
     }
+
+    /* Fade settings, which are zero on pages saved before they existed */
+    config->control.ramp_time = copy_to_u16(data + ENLARGER_CONFIG_CONTROL_RAMP_TIME);
+    config->control.ramp_curve = (enlarger_ramp_curve_t)data[ENLARGER_CONFIG_CONTROL_RAMP_CURVE];
 }
 
 bool settings_set_enlarger_config(const enlarger_config_t *config, uint8_t index)
@@ -1028,9 +2005,17 @@ bool settings_set_enlarger_config(const enlarger_config_t *config, uint8_t index
     settings_enlarger_config_populate_page(config, data);
 
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    HAL_StatusTypeDef ret = m24m01_write_page(eeprom_i2c,
+    HAL_StatusTypeDef ret = settings_record_write(
         PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
-        data, sizeof(data));
+        PAGE_ENLARGER_CONFIG_ALT_BASE + (PAGE_SIZE * index),
+        PAGE_SIZE, &enlarger_config_record[index], data);
+    if (ret == HAL_OK) {
+        /* Cache from the written page, so the entry matches what a read would return */
+        settings_enlarger_config_cache_store(index, data);
+        settings_update_profile_index(&enlarger_config_index[index], PAGE_ENLARGER_INDEX_BASE, index, data);
+    } else {
+        enlarger_config_cache_loaded &= ~(1UL << index);
+    }
     osMutexRelease(eeprom_i2c_mutex);
     return (ret == HAL_OK);
 }
@@ -1074,6 +2059,9 @@ void settings_enlarger_config_populate_page(const enlarger_config_t *config, uin
         copy_from_u16(data + offset, config->control.grade_values[CONTRAST_WHOLE_GRADES[i]].channel_white);
         offset += 2;
     }
+
+    copy_from_u16(data + ENLARGER_CONFIG_CONTROL_RAMP_TIME, config->control.ramp_time);
+    data[ENLARGER_CONFIG_CONTROL_RAMP_CURVE] = (uint8_t)config->control.ramp_curve;
 }
 
 void settings_clear_enlarger_config(uint8_t index)
@@ -1082,30 +2070,34 @@ void settings_clear_enlarger_config(uint8_t index)
 
     uint8_t data[PAGE_SIZE];
 
-    /* Read the config page, and abort if it is already blank */
-    if (m24m01_read_buffer(eeprom_i2c,
-        PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
-        data, sizeof(data)) == HAL_OK) {
-        bool is_empty = true;
-        for (size_t i = 0; i < PAGE_SIZE; i++) {
-            if (data[i] != 0xFF) {
-                is_empty = false;
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    do {
+        /* Read the config record, and abort if it is already blank */
+        if (settings_record_read(
+            PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
+            PAGE_ENLARGER_CONFIG_ALT_BASE + (PAGE_SIZE * index),
+            PAGE_SIZE, &enlarger_config_record[index], data) == HAL_OK) {
+            if (copy_to_u32(data + ENLARGER_CONFIG_VERSION) == UINT32_MAX) {
+                settings_enlarger_config_cache_store(index, NULL);
+                settings_update_profile_index(&enlarger_config_index[index], PAGE_ENLARGER_INDEX_BASE, index, NULL);
                 break;
             }
         }
-        if (is_empty) {
-            return;
-        }
-    }
 
-    memset(data, 0xFF, sizeof(data));
+        memset(data, 0xFF, sizeof(data));
 
-    log_i("Clear enlarger profile: %d", index);
+        log_i("Clear enlarger profile: %d", index);
 
-    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    m24m01_write_page(eeprom_i2c,
-        PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
-        data, sizeof(data));
+        if (settings_record_write(
+            PAGE_ENLARGER_CONFIG_BASE + (PAGE_SIZE * index),
+            PAGE_ENLARGER_CONFIG_ALT_BASE + (PAGE_SIZE * index),
+            PAGE_SIZE, &enlarger_config_record[index], data) == HAL_OK) {
+            settings_enlarger_config_cache_store(index, NULL);
+            settings_update_profile_index(&enlarger_config_index[index], PAGE_ENLARGER_INDEX_BASE, index, NULL);
+        } else {
+            enlarger_config_cache_loaded &= ~(1UL << index);
+        }
+    } while (0);
     osMutexRelease(eeprom_i2c_mutex);
 }
 
@@ -1113,37 +2105,104 @@ bool settings_get_paper_profile(paper_profile_t *profile, uint8_t index)
 {
     if (!profile || index >= MAX_PAPER_PROFILES) { return false; }
 
-    log_i("Load paper profile: %d", index);
+    bool result = false;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (settings_paper_profile_cache_load(index) == HAL_OK && paper_profile_cache[index]) {
+        memcpy(profile, paper_profile_cache[index], sizeof(paper_profile_t));
+        result = true;
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return result;
+}
+
+bool settings_get_paper_profile_name(char *name, uint8_t index)
+{
+    if (!name || index >= MAX_PAPER_PROFILES) { return false; }
+
+    bool result = false;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (settings_profile_index_pending) {
+        /* Loading the record also repairs its index entry */
+        settings_paper_profile_cache_load(index);
+    }
+    if (settings_profile_index_is_valid(&paper_profile_index[index], LATEST_PAPER_PROFILE_VERSION)) {
+        strncpy(name, paper_profile_index[index].name, PROFILE_NAME_LEN);
+        name[PROFILE_NAME_LEN - 1] = '\0';
+        result = true;
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return result;
+}
 
+HAL_StatusTypeDef settings_paper_profile_cache_load(uint8_t index)
+{
     HAL_StatusTypeDef ret = HAL_OK;
     uint8_t data[PAGE_SIZE] = {0};
 
+    if (paper_profile_cache_loaded & (1UL << index)) {
+        return HAL_OK;
+    }
+
+    log_i("Load paper profile: %d", index);
+
     do {
-        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-        ret = m24m01_read_buffer(eeprom_i2c,
+        ret = settings_record_read(
             PAGE_PAPER_PROFILE_BASE + (PAGE_SIZE * index),
-            data, sizeof(data));
-        osMutexRelease(eeprom_i2c_mutex);
+            PAGE_PAPER_PROFILE_ALT_BASE + (PAGE_SIZE * index),
+            PAGE_SIZE, &paper_profile_record[index], data);
         if (ret != HAL_OK) { break; }
 
+        /* Repair the index entry if it has fallen out of sync with the page */
+        settings_update_profile_index(&paper_profile_index[index], PAGE_PAPER_INDEX_BASE, index, data);
+
         uint32_t profile_version = copy_to_u32(data + PAPER_PROFILE_VERSION);
         if (profile_version == UINT32_MAX) {
             log_d("Profile index is empty");
-            ret = HAL_ERROR;
+            settings_paper_profile_cache_store(index, NULL, 0);
             break;
         }
         if (profile_version == 0 || profile_version > LATEST_PAPER_PROFILE_VERSION) {
             log_w("Invalid profile version %ld", profile_version);
-            ret = HAL_ERROR;
+            settings_paper_profile_cache_store(index, NULL, 0);
             break;
         }
 
-        settings_paper_profile_parse_page(profile, data, profile_version);
-        paper_profile_recalculate(profile);
-
+        settings_paper_profile_cache_store(index, data, profile_version);
     } while (0);
 
-    return (ret == HAL_OK);
+    return ret;
+}
+
+void settings_paper_profile_cache_store(uint8_t index, const uint8_t *data, uint32_t version)
+{
+    paper_profile_t *profile = paper_profile_cache[index];
+
+    if (!data) {
+        /* Slot is known to be empty */
+        vPortFree(profile);
+        paper_profile_cache[index] = NULL;
+        paper_profile_cache_loaded |= (1UL << index);
+        return;
+    }
+
+    if (!profile) {
+        profile = pvPortMalloc(sizeof(paper_profile_t));
+        if (!profile) {
+            /* Leave the slot unloaded, so the next access tries again */
+            log_w("Unable to allocate paper profile cache entry");
+            paper_profile_cache_loaded &= ~(1UL << index);
+            return;
+        }
+        paper_profile_cache[index] = profile;
+    }
+
+    settings_paper_profile_parse_page(profile, data, version);
+    paper_profile_recalculate(profile);
+    paper_profile_cache_loaded |= (1UL << index);
 }
 
 static void settings_paper_profile_parse_page(paper_profile_t *profile, const uint8_t *data, uint32_t version)
@@ -1254,9 +2313,17 @@ bool settings_set_paper_profile(const paper_profile_t *profile, uint8_t index)
     settings_paper_profile_populate_page(profile, data);
 
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    HAL_StatusTypeDef ret = m24m01_write_page(eeprom_i2c,
+    HAL_StatusTypeDef ret = settings_record_write(
         PAGE_PAPER_PROFILE_BASE + (PAGE_SIZE * index),
-        data, sizeof(data));
+        PAGE_PAPER_PROFILE_ALT_BASE + (PAGE_SIZE * index),
+        PAGE_SIZE, &paper_profile_record[index], data);
+    if (ret == HAL_OK) {
+        /* Cache from the written page, so the entry matches what a read would return */
+        settings_paper_profile_cache_store(index, data, LATEST_PAPER_PROFILE_VERSION);
+        settings_update_profile_index(&paper_profile_index[index], PAGE_PAPER_INDEX_BASE, index, data);
+    } else {
+        paper_profile_cache_loaded &= ~(1UL << index);
+    }
     osMutexRelease(eeprom_i2c_mutex);
     return (ret == HAL_OK);
 }
@@ -1305,30 +2372,34 @@ void settings_clear_paper_profile(uint8_t index)
 
     uint8_t data[PAGE_SIZE];
 
-    /* Read the profile page, and abort if it is already blank */
-    if (m24m01_read_buffer(eeprom_i2c,
-        PAGE_PAPER_PROFILE_BASE + (PAGE_SIZE * index),
-        data, sizeof(data)) == HAL_OK) {
-        bool is_empty = true;
-        for (size_t i = 0; i < PAGE_SIZE; i++) {
-            if (data[i] != 0xFF) {
-                is_empty = false;
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    do {
+        /* Read the profile record, and abort if it is already blank */
+        if (settings_record_read(
+            PAGE_PAPER_PROFILE_BASE + (PAGE_SIZE * index),
+            PAGE_PAPER_PROFILE_ALT_BASE + (PAGE_SIZE * index),
+            PAGE_SIZE, &paper_profile_record[index], data) == HAL_OK) {
+            if (copy_to_u32(data + PAPER_PROFILE_VERSION) == UINT32_MAX) {
+                settings_paper_profile_cache_store(index, NULL, 0);
+                settings_update_profile_index(&paper_profile_index[index], PAGE_PAPER_INDEX_BASE, index, NULL);
                 break;
             }
         }
-        if (is_empty) {
-            return;
-        }
-    }
 
-    memset(data, 0xFF, sizeof(data));
+        memset(data, 0xFF, sizeof(data));
 
-    log_i("Clear paper profile: %d", index);
+        log_i("Clear paper profile: %d", index);
 
-    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    m24m01_write_page(eeprom_i2c,
-        PAGE_PAPER_PROFILE_BASE + (PAGE_SIZE * index),
-        data, sizeof(data));
+        if (settings_record_write(
+            PAGE_PAPER_PROFILE_BASE + (PAGE_SIZE * index),
+            PAGE_PAPER_PROFILE_ALT_BASE + (PAGE_SIZE * index),
+            PAGE_SIZE, &paper_profile_record[index], data) == HAL_OK) {
+            settings_paper_profile_cache_store(index, NULL, 0);
+            settings_update_profile_index(&paper_profile_index[index], PAGE_PAPER_INDEX_BASE, index, NULL);
+        } else {
+            paper_profile_cache_loaded &= ~(1UL << index);
+        }
+    } while (0);
     osMutexRelease(eeprom_i2c_mutex);
 }
 
@@ -1336,34 +2407,104 @@ bool settings_get_step_wedge(step_wedge_t **wedge)
 {
     if (!wedge) { return false; }
 
-    log_i("Load step wedge");
+    bool result = false;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (settings_step_wedge_cache_load() == HAL_OK && step_wedge_cache) {
+        *wedge = step_wedge_copy(step_wedge_cache, step_wedge_cache->step_count);
+        result = (*wedge != NULL);
+    }
+    osMutexRelease(eeprom_i2c_mutex);
 
+    return result;
+}
+
+HAL_StatusTypeDef settings_step_wedge_cache_load()
+{
     HAL_StatusTypeDef ret = HAL_OK;
-    uint8_t data[PAGE_SIZE] = {0};
+    uint8_t *data;
+
+    if (step_wedge_cache_loaded) {
+        return HAL_OK;
+    }
+
+    log_i("Load step wedge");
+
+    data = pvPortMalloc(STEP_WEDGE_SLOT_SIZE);
+    if (!data) {
+        log_e("Unable to allocate step wedge buffer");
+        return HAL_ERROR;
+    }
 
     do {
-        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-        ret = m24m01_read_buffer(eeprom_i2c, PAGE_STEP_WEDGE_BASE, data, sizeof(data));
-        osMutexRelease(eeprom_i2c_mutex);
+        /*
+         * Version 1 profiles have no trailer at the end of the slot, so
+         * only read the whole slot if either copy is in the newer format.
+         */
+        bool multi_page = false;
+        const uint32_t slot_base[] = { PAGE_STEP_WEDGE_BASE, PAGE_STEP_WEDGE_ALT_BASE };
+        for (size_t i = 0; i < 2; i++) {
+            ret = settings_read_buffer(slot_base[i] + STEP_WEDGE_VERSION, data, 4);
+            if (ret != HAL_OK) { break; }
+            const uint32_t slot_version = copy_to_u32(data);
+            if (slot_version > 1 && slot_version != UINT32_MAX) {
+                multi_page = true;
+            }
+        }
         if (ret != HAL_OK) { break; }
 
+        if (multi_page) {
+            ret = settings_record_read(PAGE_STEP_WEDGE_BASE, PAGE_STEP_WEDGE_ALT_BASE,
+                STEP_WEDGE_SLOT_SIZE, &step_wedge_record, data);
+            if (ret != HAL_OK) { break; }
+        } else {
+            /* Neither slot holds a current format copy, so the next save can go in either */
+            step_wedge_record.known = true;
+            step_wedge_record.slot = RECORD_SLOT_NONE;
+            step_wedge_record.sequence = 0;
+            memset(data, 0xFF, STEP_WEDGE_SLOT_SIZE);
+        }
+
+        if (copy_to_u32(data + STEP_WEDGE_VERSION) == UINT32_MAX) {
+            /* Fall back to a version 1 profile, which only used the first page of each slot */
+            settings_record_state_t page_state = {0};
+            ret = settings_record_read(PAGE_STEP_WEDGE_BASE, PAGE_STEP_WEDGE_ALT_BASE,
+                PAGE_SIZE, &page_state, data);
+            if (ret != HAL_OK) { break; }
+
+            if (copy_to_u32(data + STEP_WEDGE_VERSION) != 1) {
+                memset(data, 0xFF, PAGE_SIZE);
+            }
+        }
+
         uint32_t wedge_version = copy_to_u32(data + STEP_WEDGE_VERSION);
         if (wedge_version == UINT32_MAX) {
             log_d("Step wedge is empty");
-            ret = HAL_ERROR;
+            settings_step_wedge_cache_store(NULL);
             break;
         }
         if (wedge_version == 0 || wedge_version > LATEST_STEP_WEDGE_VERSION) {
             log_w("Invalid step wedge version %ld", wedge_version);
-            ret = HAL_ERROR;
+            settings_step_wedge_cache_store(NULL);
             break;
         }
 
-        settings_step_wedge_parse_page(wedge, data);
-
+        settings_step_wedge_cache_store(data);
     } while (0);
 
-    return (ret == HAL_OK) && *wedge;
+    vPortFree(data);
+    return ret;
+}
+
+void settings_step_wedge_cache_store(const uint8_t *data)
+{
+    step_wedge_free(step_wedge_cache);
+    step_wedge_cache = NULL;
+
+    if (data) {
+        settings_step_wedge_parse_page(&step_wedge_cache, data);
+    }
+    step_wedge_cache_loaded = true;
 }
 
 void settings_step_wedge_parse_page(step_wedge_t **wedge, const uint8_t *data)
@@ -1403,17 +2544,30 @@ void settings_step_wedge_parse_page(step_wedge_t **wedge, const uint8_t *data)
 
 bool settings_set_step_wedge(const step_wedge_t *wedge)
 {
-    if (!wedge) { return false; }
+    if (!wedge || wedge->step_count > MAX_STEP_WEDGE_STEP_COUNT) { return false; }
 
     log_i("Save step wedge");
 
-    uint8_t data[PAGE_SIZE] = {0};
+    uint8_t *data = pvPortMalloc(STEP_WEDGE_SLOT_SIZE);
+    if (!data) {
+        log_e("Unable to allocate step wedge buffer");
+        return false;
+    }
+    memset(data, 0, STEP_WEDGE_SLOT_SIZE);
 
     settings_step_wedge_populate_page(wedge, data);
 
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    HAL_StatusTypeDef ret = m24m01_write_page(eeprom_i2c, PAGE_STEP_WEDGE_BASE, data, sizeof(data));
+    HAL_StatusTypeDef ret = settings_record_write(PAGE_STEP_WEDGE_BASE, PAGE_STEP_WEDGE_ALT_BASE,
+        STEP_WEDGE_SLOT_SIZE, &step_wedge_record, data);
+    if (ret == HAL_OK) {
+        settings_step_wedge_cache_store(data);
+    } else {
+        step_wedge_cache_loaded = false;
+    }
     osMutexRelease(eeprom_i2c_mutex);
+
+    vPortFree(data);
     return (ret == HAL_OK);
 }
 
@@ -1432,11 +2586,272 @@ void settings_step_wedge_populate_page(const step_wedge_t *wedge, uint8_t *data)
     }
 }
 
+bool settings_snapshot_save(FIL *fp)
+{
+    FRESULT res;
+    UINT bytes_written;
+    uint8_t header[SNAPSHOT_HEADER_SIZE];
+    uint32_t section_crc[SNAPSHOT_SECTIONS] = {0};
+    uint8_t *buf = NULL;
+    bool success = false;
+
+    if (!fp) { return false; }
+
+    log_i("Save settings snapshot");
+    uint32_t start_ticks = osKernelGetTickCount();
+
+    do {
+        buf = pvPortMalloc(SNAPSHOT_SECTION_MAX_LENGTH);
+        if (!buf) {
+            log_e("Unable to allocate snapshot buffer");
+            break;
+        }
+
+        /* Write a placeholder header, to be replaced once the section CRCs are known */
+        memset(header, 0xFF, sizeof(header));
+        res = f_write(fp, header, sizeof(header), &bytes_written);
+        if (res != FR_OK || bytes_written != sizeof(header)) {
+            log_e("Unable to write snapshot header: %d", res);
+            break;
+        }
+
+        size_t i;
+        for (i = 0; i < SNAPSHOT_SECTIONS; i++) {
+            const settings_snapshot_section_t *section = &settings_snapshot_sections[i];
+
+            if (settings_read_buffer(section->address, buf, section->length) != HAL_OK) {
+                log_e("Unable to read snapshot section: 0x%05lX", section->address);
+                break;
+            }
+            section_crc[i] = settings_crc32(buf, section->length);
+
+            res = f_write(fp, buf, section->length, &bytes_written);
+            if (res != FR_OK || bytes_written != section->length) {
+                log_e("Unable to write snapshot section: %d", res);
+                break;
+            }
+        }
+        if (i < SNAPSHOT_SECTIONS) { break; }
+
+        settings_snapshot_populate_header(header, section_crc);
+
+        res = f_lseek(fp, 0);
+        if (res != FR_OK) { break; }
+
+        res = f_write(fp, header, sizeof(header), &bytes_written);
+        if (res != FR_OK || bytes_written != sizeof(header)) {
+            log_e("Unable to write snapshot header: %d", res);
+            break;
+        }
+
+        success = true;
+    } while (0);
+
+    vPortFree(buf);
+
+    if (success) {
+        log_i("Settings snapshot saved in %lums", osKernelGetTickCount() - start_ticks);
+    }
+    return success;
+}
+
+bool settings_snapshot_restore(FIL *fp)
+{
+    FRESULT res;
+    UINT bytes_read;
+    uint8_t header[SNAPSHOT_HEADER_SIZE];
+    uint32_t section_crc[SNAPSHOT_SECTIONS];
+    uint8_t *buf = NULL;
+    bool success = false;
+    bool eeprom_modified = false;
+
+    if (!fp) { return false; }
+
+    log_i("Restore settings snapshot");
+    uint32_t start_ticks = osKernelGetTickCount();
+
+    do {
+        res = f_read(fp, header, sizeof(header), &bytes_read);
+        if (res != FR_OK || bytes_read != sizeof(header)) {
+            log_e("Unable to read snapshot header: %d", res);
+            break;
+        }
+
+        if (!settings_snapshot_validate_header(header, section_crc)) {
+            break;
+        }
+
+        buf = pvPortMalloc(SNAPSHOT_SECTION_MAX_LENGTH);
+        if (!buf) {
+            log_e("Unable to allocate snapshot buffer");
+            break;
+        }
+
+        /* Check every section before touching the EEPROM */
+        size_t i;
+        for (i = 0; i < SNAPSHOT_SECTIONS; i++) {
+            const settings_snapshot_section_t *section = &settings_snapshot_sections[i];
+
+            res = f_read(fp, buf, section->length, &bytes_read);
+            if (res != FR_OK || bytes_read != section->length) {
+                log_e("Unable to read snapshot section: %d", res);
+                break;
+            }
+            if (settings_crc32(buf, section->length) != section_crc[i]) {
+                log_w("Snapshot section CRC mismatch: 0x%05lX", section->address);
+                break;
+            }
+        }
+        if (i < SNAPSHOT_SECTIONS) { break; }
+
+        res = f_lseek(fp, sizeof(header));
+        if (res != FR_OK) { break; }
+
+        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+
+        /*
+         * Let any page that is part way through being written out finish
+         * first, since its writer releases the bus between write cycles
+         * and would otherwise resume on top of the restored contents.
+         */
+        while (settings_write_slot_any(true)) {
+            osMutexRelease(eeprom_i2c_mutex);
+            osDelay(1);
+            osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+        }
+
+        /* Pending writes would only land on top of the restored contents */
+        for (i = 0; i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+            settings_write_slots[i].pending = false;
+        }
+
+        for (i = 0; i < SNAPSHOT_SECTIONS; i++) {
+            const settings_snapshot_section_t *section = &settings_snapshot_sections[i];
+
+            res = f_read(fp, buf, section->length, &bytes_read);
+            if (res != FR_OK || bytes_read != section->length
+                || settings_crc32(buf, section->length) != section_crc[i]) {
+                log_e("Snapshot changed while restoring");
+                break;
+            }
+
+            eeprom_modified = true;
+            if (m24m01_write_buffer(eeprom_i2c, section->address, buf, section->length) != HAL_OK) {
+                log_e("Unable to write snapshot section: 0x%05lX", section->address);
+                break;
+            }
+        }
+        success = (i == SNAPSHOT_SECTIONS);
+
+        /* Anything held in memory may no longer match the EEPROM */
+        if (eeprom_modified) {
+            settings_reload();
+        }
+
+        osMutexRelease(eeprom_i2c_mutex);
+    } while (0);
+
+    vPortFree(buf);
+
+    if (success) {
+        log_i("Settings snapshot restored in %lums", osKernelGetTickCount() - start_ticks);
+    }
+    return success;
+}
+
+void settings_snapshot_populate_header(uint8_t *header, const uint32_t *section_crc)
+{
+    memset(header, 0, SNAPSHOT_HEADER_SIZE);
+    memcpy(header + SNAPSHOT_MAGIC, "PZSNAPSH", 8);
+    copy_from_u32(header + SNAPSHOT_VERSION, LATEST_SNAPSHOT_VERSION);
+    copy_from_u32(header + SNAPSHOT_SECTION_COUNT, SNAPSHOT_SECTIONS);
+
+    for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++) {
+        uint8_t *entry = header + SNAPSHOT_SECTION_TABLE + (SNAPSHOT_SECTION_ENTRY_SIZE * i);
+        copy_from_u32(entry + SNAPSHOT_SECTION_ADDRESS, settings_snapshot_sections[i].address);
+        copy_from_u32(entry + SNAPSHOT_SECTION_LENGTH, settings_snapshot_sections[i].length);
+        copy_from_u32(entry + SNAPSHOT_SECTION_CRC, section_crc[i]);
+    }
+
+    copy_from_u32(header + SNAPSHOT_HEADER_SIZE - 4,
+        settings_crc32(header, SNAPSHOT_HEADER_SIZE - 4));
+}
+
+bool settings_snapshot_validate_header(const uint8_t *header, uint32_t *section_crc)
+{
+    if (memcmp(header + SNAPSHOT_MAGIC, "PZSNAPSH", 8) != 0) {
+        log_w("Invalid snapshot magic");
+        return false;
+    }
+
+    uint32_t version = copy_to_u32(header + SNAPSHOT_VERSION);
+    if (version != LATEST_SNAPSHOT_VERSION) {
+        log_w("Unsupported snapshot version: %lu", version);
+        return false;
+    }
+
+    uint32_t section_count = copy_to_u32(header + SNAPSHOT_SECTION_COUNT);
+    if (section_count != SNAPSHOT_SECTIONS) {
+        log_w("Unexpected snapshot section count: %lu", section_count);
+        return false;
+    }
+
+    if (copy_to_u32(header + SNAPSHOT_HEADER_SIZE - 4) != settings_crc32(header, SNAPSHOT_HEADER_SIZE - 4)) {
+        log_w("Snapshot header CRC mismatch");
+        return false;
+    }
+
+    /* Only restore sections that match the current EEPROM layout */
+    for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++) {
+        const uint8_t *entry = header + SNAPSHOT_SECTION_TABLE + (SNAPSHOT_SECTION_ENTRY_SIZE * i);
+        if (copy_to_u32(entry + SNAPSHOT_SECTION_ADDRESS) != settings_snapshot_sections[i].address
+            || copy_to_u32(entry + SNAPSHOT_SECTION_LENGTH) != settings_snapshot_sections[i].length) {
+            log_w("Unexpected snapshot section: %d", i);
+            return false;
+        }
+        section_crc[i] = copy_to_u32(entry + SNAPSHOT_SECTION_CRC);
+    }
+
+    return true;
+}
+
+/**
+ * Discard all cached state and load it again from the EEPROM,
+ * for use after the EEPROM contents have been replaced.
+ */
+void settings_reload()
+{
+    for (uint8_t i = 0; i < MAX_ENLARGER_CONFIGS; i++) {
+        settings_enlarger_config_cache_store(i, NULL);
+    }
+    enlarger_config_cache_loaded = 0;
+    memset(enlarger_config_record, 0, sizeof(enlarger_config_record));
+
+    for (uint8_t i = 0; i < MAX_PAPER_PROFILES; i++) {
+        settings_paper_profile_cache_store(i, NULL, 0);
+    }
+    paper_profile_cache_loaded = 0;
+    memset(paper_profile_record, 0, sizeof(paper_profile_record));
+
+    settings_step_wedge_cache_store(NULL);
+    step_wedge_cache_loaded = false;
+    memset(&step_wedge_record, 0, sizeof(step_wedge_record));
+
+    settings_init_config(false);
+    settings_init_config2(false);
+    settings_init_profile_index(false);
+}
+
 bool settings_set_bootloader_firmware(const char *dev_serial, uint32_t checksum, const char *file_path)
 {
     HAL_StatusTypeDef ret = HAL_OK;
     uint8_t data[PAGE_SIZE] = {0};
 
+    /* Make sure nothing is still pending before the device is reset */
+    if (settings_flush() != HAL_OK) {
+        log_w("Some settings changes were not saved");
+    }
+
     data[BOOTLOADER_COMMAND] = 0xBB;
 
     strncpy((char *)(data + BOOTLOADER_FW_DEVICE), dev_serial, 21);
@@ -1509,7 +2924,7 @@ bool read_u32(uint32_t address, uint32_t *val)
 {
     uint8_t data[4];
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    bool result = m24m01_read_buffer(eeprom_i2c, address, data, sizeof(data)) == HAL_OK;
+    bool result = settings_read_buffer(address, data, sizeof(data)) == HAL_OK;
     osMutexRelease(eeprom_i2c_mutex);
     if (result && val) {
         *val = copy_to_u32(data);
@@ -1522,7 +2937,7 @@ bool write_u32(uint32_t address, uint32_t val)
     uint8_t data[4];
     copy_from_u32(data, val);
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    bool result = m24m01_write_buffer(eeprom_i2c, address, data, sizeof(data)) == HAL_OK;
+    bool result = settings_write_buffer(address, data, sizeof(data)) == HAL_OK;
     osMutexRelease(eeprom_i2c_mutex);
     return result;
 }
@@ -1532,7 +2947,455 @@ bool write_f32(uint32_t address, float val)
     uint8_t data[4];
     copy_from_f32(data, val);
     osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
-    bool result = m24m01_write_buffer(eeprom_i2c, address, data, sizeof(data)) == HAL_OK;
+    bool result = settings_write_buffer(address, data, sizeof(data)) == HAL_OK;
     osMutexRelease(eeprom_i2c_mutex);
     return result;
 }
+
+void task_settings_run(void *argument)
+{
+    osSemaphoreId_t task_start_semaphore = argument;
+
+    /* Create the semaphore used to wake the task when writes are staged */
+    settings_write_semaphore = osSemaphoreNew(1, 0, &settings_write_semaphore_attributes);
+    if (!settings_write_semaphore) {
+        return;
+    }
+
+    /* Writes are only deferred once there is a task to perform them */
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    settings_writer_running = true;
+    osMutexRelease(eeprom_i2c_mutex);
+
+    /* Release the startup semaphore */
+    if (osSemaphoreRelease(task_start_semaphore) != osOK) {
+        log_e("Unable to release task_start_semaphore");
+        return;
+    }
+
+    /* Finish the parts of startup that are not needed to show the home screen */
+    settings_init_deferred();
+
+    /* Start the main task loop */
+    settings_task_loop();
+}
+
+void settings_init_deferred()
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    /* Cleanup the bootloader instruction page */
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    settings_cleanup_bootloader_firmware();
+    osMutexRelease(eeprom_i2c_mutex);
+
+    if (settings_profile_index_pending) {
+        log_i("Rebuilding profile index");
+        uint32_t start_ticks = osKernelGetTickCount();
+
+        do {
+            ret = settings_rebuild_profile_index(enlarger_config_index, PAGE_ENLARGER_INDEX_BASE,
+                enlarger_config_record, PAGE_ENLARGER_CONFIG_BASE, PAGE_ENLARGER_CONFIG_ALT_BASE, MAX_ENLARGER_CONFIGS);
+            if (ret != HAL_OK) { break; }
+
+            ret = settings_rebuild_profile_index(paper_profile_index, PAGE_PAPER_INDEX_BASE,
+                paper_profile_record, PAGE_PAPER_PROFILE_BASE, PAGE_PAPER_PROFILE_ALT_BASE, MAX_PAPER_PROFILES);
+            if (ret != HAL_OK) { break; }
+
+            osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+            if (write_u32(PAGE_PROFILE_INDEX + PROFILE_INDEX_VERSION, LATEST_PROFILE_INDEX_VERSION)) {
+                settings_profile_index_pending = false;
+            }
+            osMutexRelease(eeprom_i2c_mutex);
+        } while (0);
+
+        if (settings_profile_index_pending) {
+            log_w("Unable to rebuild profile index");
+        } else {
+            log_i("Profile index rebuilt in %lums", osKernelGetTickCount() - start_ticks);
+        }
+    }
+
+    /* Load the profiles selected at startup, so their first use does not wait on the bus */
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (setting_enlarger_config < MAX_ENLARGER_CONFIGS) {
+        settings_enlarger_config_cache_load(setting_enlarger_config);
+    }
+    if (setting_paper_profile < MAX_PAPER_PROFILES) {
+        settings_paper_profile_cache_load(setting_paper_profile);
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+}
+
+[[noreturn]] void settings_task_loop()
+{
+    for (;;) {
+        if (osSemaphoreAcquire(settings_write_semaphore, portMAX_DELAY) != osOK) {
+            continue;
+        }
+
+        /* Let further changes to the same pages accumulate */
+        osDelay(SETTINGS_WRITE_DELAY_MS);
+
+        settings_flush();
+    }
+}
+
+HAL_StatusTypeDef settings_flush()
+{
+    bool flushed;
+    bool pending;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    const uint32_t discarded = settings_write_discarded;
+    osMutexRelease(eeprom_i2c_mutex);
+
+    do {
+        /* Release the mutex between pages, so other bus users are not held off */
+        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+        flushed = settings_write_slot_flush_oldest(true);
+        pending = flushed || settings_write_slot_any(false);
+        osMutexRelease(eeprom_i2c_mutex);
+
+        if (!flushed && pending) {
+            /* The remaining pages are being written out by another task */
+            osDelay(1);
+        }
+    } while (pending);
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    const bool result = settings_write_discarded == discarded;
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return result ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * Read a span of the EEPROM into a newly allocated buffer, in a single
+ * transfer. This must be called with the EEPROM mutex held.
+ *
+ * @return The buffer, or NULL if it could not be allocated or read
+ */
+uint8_t *settings_boot_read_span(uint32_t address, uint32_t length)
+{
+    uint8_t *buf = pvPortMalloc(length);
+    if (buf && m24m01_read_buffer(eeprom_i2c, address, buf, length) != HAL_OK) {
+        vPortFree(buf);
+        buf = NULL;
+    }
+    return buf;
+}
+
+/**
+ * Serve a read from the boot read spans, if it falls entirely within one.
+ */
+bool settings_boot_read(uint32_t address, uint8_t *data, size_t data_len)
+{
+    if (settings_boot_data && address + data_len <= SETTINGS_BOOT_READ_SIZE) {
+        memcpy(data, settings_boot_data + address, data_len);
+        return true;
+    }
+    if (settings_boot_journal && address >= PAGE_CONFIG_JOURNAL_BASE
+        && address + data_len <= PAGE_CONFIG_JOURNAL_BASE + SETTINGS_BOOT_JOURNAL_SIZE) {
+        memcpy(data, settings_boot_journal + (address - PAGE_CONFIG_JOURNAL_BASE), data_len);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Keep the boot read spans consistent with what is being written.
+ */
+void settings_boot_mirror(uint32_t address, const uint8_t *data, size_t data_len)
+{
+    if (settings_boot_data && address < SETTINGS_BOOT_READ_SIZE) {
+        memcpy(settings_boot_data + address, data, MIN(data_len, SETTINGS_BOOT_READ_SIZE - address));
+    }
+    if (settings_boot_journal && address < PAGE_CONFIG_JOURNAL_BASE + SETTINGS_BOOT_JOURNAL_SIZE
+        && address + data_len > PAGE_CONFIG_JOURNAL_BASE) {
+        const uint32_t start = MAX(address, PAGE_CONFIG_JOURNAL_BASE);
+        const uint32_t end = MIN(address + data_len, PAGE_CONFIG_JOURNAL_BASE + SETTINGS_BOOT_JOURNAL_SIZE);
+        memcpy(settings_boot_journal + (start - PAGE_CONFIG_JOURNAL_BASE), data + (start - address), end - start);
+    }
+}
+
+HAL_StatusTypeDef settings_read_buffer(uint32_t address, uint8_t *data, size_t data_len)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    if (!settings_boot_read(address, data, data_len)) {
+        ret = m24m01_read_buffer(eeprom_i2c, address, data, data_len);
+    }
+    if (ret == HAL_OK) {
+        /* Overlay any changes that have not been written out yet */
+        for (size_t i = 0; i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+            const settings_write_slot_t *slot = &settings_write_slots[i];
+            if (!slot->pending
+                || slot->address + PAGE_SIZE <= address
+                || slot->address >= address + data_len) {
+                continue;
+            }
+            for (size_t j = 0; j < PAGE_SIZE; j++) {
+                uint32_t byte_address = slot->address + j;
+                if (byte_address >= address && byte_address < address + data_len
+                    && (slot->dirty[j / 32] & (1UL << (j % 32)))) {
+                    data[byte_address - address] = slot->data[j];
+                }
+            }
+        }
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+    return ret;
+}
+
+HAL_StatusTypeDef settings_write_buffer(uint32_t address, const uint8_t *data, size_t data_len)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    if (!data || data_len == 0 || data_len > PAGE_LIMIT - address) {
+        return HAL_ERROR;
+    }
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    settings_boot_mirror(address, data, data_len);
+
+    if (!settings_writer_running) {
+        ret = m24m01_write_buffer(eeprom_i2c, address, data, data_len);
+    } else {
+        size_t offset = 0;
+        do {
+            uint32_t page_address = (address + offset) & ~(PAGE_SIZE - 1);
+            size_t page_offset = (address + offset) - page_address;
+            size_t write_len = MIN(PAGE_SIZE - page_offset, data_len - offset);
+
+            settings_write_slot_t *slot = settings_write_slot_acquire(page_address);
+            for (size_t i = 0; !slot && i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+                /*
+                 * Make room by writing out the oldest pending page now.
+                 * The caller may already hold the mutex, so the bus is
+                 * kept for the whole write cycle.
+                 */
+                if (!settings_write_slot_flush_oldest(false)) {
+                    break;
+                }
+                slot = settings_write_slot_acquire(page_address);
+            }
+            if (!slot) {
+                log_e("No write slot available for 0x%05lX", page_address);
+                ret = HAL_ERROR;
+                break;
+            }
+
+            memcpy(slot->data + page_offset, data + offset, write_len);
+            for (size_t i = page_offset; i < page_offset + write_len; i++) {
+                slot->dirty[i / 32] |= (1UL << (i % 32));
+            }
+            slot->generation++;
+
+            offset += write_len;
+        } while (offset < data_len);
+
+        osSemaphoreRelease(settings_write_semaphore);
+    }
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return ret;
+}
+
+/**
+ * Write directly to the EEPROM, bypassing the write-behind slots, for
+ * callers that need to know the data has reached the device. Pending
+ * changes to the same bytes are superseded, and dropped from their slots.
+ */
+HAL_StatusTypeDef settings_write_through(uint32_t address, const uint8_t *data, size_t data_len)
+{
+    HAL_StatusTypeDef ret;
+
+    if (!data || data_len == 0 || data_len > PAGE_LIMIT - address) {
+        return HAL_ERROR;
+    }
+
+    osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+    settings_boot_mirror(address, data, data_len);
+
+    for (size_t i = 0; i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+        settings_write_slot_t *slot = &settings_write_slots[i];
+        if (!slot->pending
+            || slot->address + PAGE_SIZE <= address
+            || slot->address >= address + data_len) {
+            continue;
+        }
+
+        /* A slot being written out by another task stops once nothing is left */
+        bool dirty = false;
+        for (size_t j = 0; j < PAGE_SIZE; j++) {
+            uint32_t byte_address = slot->address + j;
+            if (byte_address >= address && byte_address < address + data_len) {
+                slot->dirty[j / 32] &= ~(1UL << (j % 32));
+            } else if (slot->dirty[j / 32] & (1UL << (j % 32))) {
+                dirty = true;
+            }
+        }
+        slot->generation++;
+        if (!dirty) {
+            slot->pending = false;
+            slot->failures = 0;
+        }
+    }
+
+    ret = m24m01_write_buffer(eeprom_i2c, address, data, data_len);
+    osMutexRelease(eeprom_i2c_mutex);
+
+    return ret;
+}
+
+settings_write_slot_t *settings_write_slot_acquire(uint32_t page_address)
+{
+    settings_write_slot_t *free_slot = NULL;
+
+    for (size_t i = 0; i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+        settings_write_slot_t *slot = &settings_write_slots[i];
+        if (slot->pending) {
+            if (slot->address == page_address) {
+                return slot;
+            }
+        } else if (!slot->flushing && !free_slot) {
+            free_slot = slot;
+        }
+    }
+
+    if (free_slot) {
+        memset(free_slot->dirty, 0, sizeof(free_slot->dirty));
+        free_slot->address = page_address;
+        free_slot->sequence = settings_write_sequence++;
+        free_slot->failures = 0;
+        free_slot->pending = true;
+    }
+    return free_slot;
+}
+
+/**
+ * Write out the oldest pending page that is not already being written
+ * by another task.
+ *
+ * This must be called with the EEPROM mutex held. If release_bus is set,
+ * the mutex is released during each write cycle, which is only effective
+ * if the caller holds it exactly once.
+ *
+ * If the write fails, the page stays pending so that it is tried again.
+ * Once it has failed SETTINGS_WRITE_ATTEMPTS times in a row, its changes
+ * are discarded and counted, so settings_flush() can report the loss.
+ *
+ * @return true if a page write was attempted
+ */
+bool settings_write_slot_flush_oldest(bool release_bus)
+{
+    settings_write_slot_t *slot = NULL;
+
+    /* Pages are written in the order they were first changed */
+    for (size_t i = 0; i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+        if (settings_write_slots[i].pending && !settings_write_slots[i].flushing
+            && (!slot || (int32_t)(settings_write_slots[i].sequence - slot->sequence) < 0)) {
+            slot = &settings_write_slots[i];
+        }
+    }
+    if (!slot) {
+        return false;
+    }
+
+    /*
+     * The bus may be released during each write cycle, so changes may be
+     * merged into this slot while it is being written out. The flushing
+     * mark keeps other tasks from writing or reusing it in the meantime.
+     */
+    const uint32_t generation = slot->generation;
+    slot->flushing = true;
+
+    /* Write each contiguous run of changed bytes */
+    bool failed = false;
+    size_t start = 0;
+    while (start < PAGE_SIZE && slot->pending) {
+        if (!(slot->dirty[start / 32] & (1UL << (start % 32)))) {
+            start++;
+            continue;
+        }
+        size_t end = start + 1;
+        while (end < PAGE_SIZE && (slot->dirty[end / 32] & (1UL << (end % 32)))) {
+            end++;
+        }
+
+        HAL_StatusTypeDef ret = m24m01_write_page_start(eeprom_i2c, slot->address + start, slot->data + start, end - start);
+        if (ret != HAL_OK) {
+            log_e("Unable to write settings at 0x%05lX+%d: %d", slot->address + start, end - start, ret);
+            failed = true;
+            break;
+        }
+        settings_wait_write_cycle(release_bus);
+        start = end;
+    }
+    slot->flushing = false;
+
+    if (failed && slot->pending) {
+        /* Runs already written are simply written again on the next attempt */
+        if (++slot->failures < SETTINGS_WRITE_ATTEMPTS) {
+            return true;
+        }
+        log_e("Discarding settings changes at 0x%05lX", slot->address);
+        slot->pending = false;
+        slot->failures = 0;
+        settings_write_discarded++;
+        return true;
+    }
+
+    /* If anything changed along the way, the slot is written again next time */
+    if (slot->generation == generation) {
+        slot->pending = false;
+        slot->failures = 0;
+    }
+    return true;
+}
+
+/**
+ * Check for pending write slots, or only those being written out.
+ * This must be called with the EEPROM mutex held.
+ */
+bool settings_write_slot_any(bool flushing_only)
+{
+    for (size_t i = 0; i < SETTINGS_WRITE_SLOT_COUNT; i++) {
+        if (flushing_only ? settings_write_slots[i].flushing : settings_write_slots[i].pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Wait for the EEPROM to finish its internal write cycle. This must be
+ * called with the EEPROM mutex held, and returns with it held again.
+ *
+ * If release_bus is set, the bus is not held while waiting. The mutex is
+ * recursive, so this is only done when the caller is known to hold it
+ * exactly once.
+ */
+void settings_wait_write_cycle(bool release_bus)
+{
+    bool busy;
+
+    if (!release_bus) {
+        while (m24m01_is_busy(eeprom_i2c)) {
+            osDelay(1);
+        }
+        return;
+    }
+
+    osMutexRelease(eeprom_i2c_mutex);
+    do {
+        osDelay(1);
+        osMutexAcquire(eeprom_i2c_mutex, portMAX_DELAY);
+        busy = m24m01_is_busy(eeprom_i2c);
+        if (busy) {
+            osMutexRelease(eeprom_i2c_mutex);
+        }
+    } while (busy);
+}
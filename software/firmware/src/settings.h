@@ -8,6 +8,7 @@
 #include <stm32f4xx_hal.h>
 #include <cmsis_os.h>
 #include <stdint.h>
+#include <ff.h>
 #include "buzzer.h"
 #include "exposure_state.h"
 #include "enlarger_config.h"
@@ -57,6 +58,31 @@ typedef enum : uint8_t {
  */
 HAL_StatusTypeDef settings_init(I2C_HandleTypeDef *hi2c, osMutexId_t i2c_mutex);
 
+/**
+ * Start the settings persistence task.
+ *
+ * Once this task is running, changes made through the settings setters
+ * are staged in memory and written to the EEPROM shortly afterwards,
+ * with changes to the same page merged into a single write.
+ *
+ * @param argument The osSemaphoreId_t used to synchronize task startup.
+ */
+void task_settings_run(void *argument);
+
+/**
+ * Write out any settings changes that are still pending.
+ *
+ * This must be called before anything that could interrupt the
+ * persistence task, such as a system reset.
+ *
+ * Pages that fail to write are retried a few times before their
+ * changes are given up on.
+ *
+ * @return HAL_OK if everything was written, or HAL_ERROR if any
+ *         pending changes had to be discarded
+ */
+HAL_StatusTypeDef settings_flush();
+
 /**
  * Clear the settings store to factory blank
  *
@@ -64,6 +90,30 @@ HAL_StatusTypeDef settings_init(I2C_HandleTypeDef *hi2c, osMutexId_t i2c_mutex);
  */
 HAL_StatusTypeDef settings_clear(I2C_HandleTypeDef *hi2c);
 
+/**
+ * Begin an edit of the basic configuration values.
+ *
+ * Until the edit is committed, setters called from the same thread only
+ * buffer their changes, so they can be saved with a single page write.
+ */
+void settings_begin_config_edit();
+
+/**
+ * Commit the changes buffered since settings_begin_config_edit().
+ *
+ * If the changes could not be saved, the configuration values are
+ * reloaded so they match what is stored.
+ *
+ * @return True if the changes were successfully saved
+ */
+bool settings_commit_config_edit();
+
+/**
+ * Get the number of EEPROM write cycles avoided by committing multiple
+ * configuration changes together.
+ */
+uint32_t settings_get_write_cycles_saved();
+
 /**
  * Default exposure time displayed at startup and reset
  *
@@ -153,6 +203,16 @@ uint8_t settings_get_default_enlarger_config_index();
 
 void settings_set_default_enlarger_config_index(uint8_t index);
 
+/**
+ * Index of the enlarger configuration for a secondary head, which is
+ * driven together with the default enlarger on the same DMX line.
+ *
+ * @return An index value from 0 to 15, or UINT8_MAX if there is no secondary head
+ */
+uint8_t settings_get_secondary_enlarger_config_index();
+
+void settings_set_secondary_enlarger_config_index(uint8_t index);
+
 /**
  * Get the index of the default paper profile.
  *
@@ -241,6 +301,18 @@ void settings_clear_enlarger_config(uint8_t index);
  */
 bool settings_get_paper_profile(paper_profile_t *profile, uint8_t index);
 
+/**
+ * Get the name of the paper profile saved at the specified index
+ *
+ * This function is intended to provide an more efficient way of building
+ * a list of saved profiles than loading all of them into memory.
+ *
+ * @param name Pointer to a buffer with at least 32 bytes.
+ * @param index An index value from 0 to 15
+ * @return True if the profile name was successfully loaded, false otherwise
+ */
+bool settings_get_paper_profile_name(char *name, uint8_t index);
+
 /**
  * Save a paper profile at the specified index
  *
@@ -277,6 +349,28 @@ bool settings_get_step_wedge(step_wedge_t **wedge);
  */
 bool settings_set_step_wedge(const step_wedge_t *wedge);
 
+/**
+ * Save a binary snapshot of all the settings to a file.
+ *
+ * The snapshot is an exact copy of the settings regions of the EEPROM,
+ * so it can only be restored onto a device using the same layout.
+ *
+ * @param fp File opened for writing, positioned at its start
+ * @return True if the snapshot was successfully written
+ */
+bool settings_snapshot_save(FIL *fp);
+
+/**
+ * Replace all the settings with the contents of a binary snapshot file.
+ *
+ * The whole file is checked before anything is written, so a damaged
+ * or incompatible snapshot leaves the current settings untouched.
+ *
+ * @param fp File opened for reading, positioned at its start
+ * @return True if the snapshot was successfully restored
+ */
+bool settings_snapshot_restore(FIL *fp);
+
 /**
  * Set the firmware file to install on next boot.
  *
@@ -62,3 +62,26 @@ uint16_t copy_to_u16(const uint8_t *buf)
     return (uint32_t)buf[0] << 8
         | (uint32_t)buf[1];
 }
+
+/*
+ * Standard reflected CRC-32 (IEEE 802.3), computed a nibble at a time
+ * from a small table. This avoids contending with other users of the
+ * hardware CRC unit, while staying fast enough to check every profile
+ * page as it is loaded.
+ */
+uint32_t settings_crc32(const uint8_t *buf, size_t len)
+{
+    static const uint32_t crc_table[16] = {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+    };
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+    }
+    return ~crc;
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 void copy_from_u32(uint8_t *buf, uint32_t val);
 uint32_t copy_to_u32(const uint8_t *buf);
@@ -13,4 +14,6 @@ float copy_to_f32(const uint8_t *buf);
 void copy_from_u16(uint8_t *buf, uint16_t val);
 uint16_t copy_to_u16(const uint8_t *buf);
 
+uint32_t settings_crc32(const uint8_t *buf, size_t len);
+
 #endif /* SETTINGS_UTIL_H */
@@ -39,6 +39,9 @@ struct __state_controller_t {
     uint32_t next_state_param;
     exposure_state_t *exposure_state;
     enlarger_config_t enlarger_config;
+    enlarger_config_t secondary_config;
+    bool secondary_enabled;
+    enlarger_control_frames_t head_frames[ENLARGER_CONTROL_MAX_HEADS];
     bool enlarger_focus_mode;
     bool enable_meter_probe;
     TickType_t focus_start_ticks;
@@ -70,6 +73,12 @@ void state_controller_init()
         abort();
     }
 
+#ifdef DEBUG
+    if (!enlarger_control_check_prepared_frames()) {
+        log_w("Prepared enlarger frames do not match");
+    }
+#endif
+
     state_controller_reload_enlarger_config(&state_controller);
 
     state_map[STATE_HOME] = state_home();
@@ -171,7 +180,12 @@ void state_controller_set_enlarger_focus(state_controller_t *controller, bool en
 {
     if (!controller) { return; }
 
-    if (enabled) {
+    if (controller->secondary_enabled) {
+        /* Both heads change together, in the same frame */
+        const enlarger_control_state_t state = enabled ? ENLARGER_CONTROL_STATE_FOCUS : ENLARGER_CONTROL_STATE_OFF;
+        const enlarger_control_state_t states[] = { state, state };
+        enlarger_control_set_prepared_heads(controller->head_frames, states, 2, CONTRAST_GRADE_MAX, 0, 0, 0, false);
+    } else if (enabled) {
         enlarger_control_set_state_focus(&(controller->enlarger_config.control), false);
     } else {
         enlarger_control_set_state_off(&(controller->enlarger_config.control), false);
@@ -208,6 +222,33 @@ void state_controller_reload_enlarger_config(state_controller_t *controller)
     if (!(result && enlarger_config_is_valid(&controller->enlarger_config))) {
         enlarger_config_set_defaults(&controller->enlarger_config);
     }
+
+    /*
+     * The secondary head is only usable if both heads are under DMX
+     * control without fades, and do not share any frame slots, so that
+     * both heads can always be changed in a single frame update.
+     */
+    controller->secondary_enabled = false;
+    uint8_t secondary_index = settings_get_secondary_enlarger_config_index();
+    if (secondary_index != UINT8_MAX && secondary_index != profile_index
+        && controller->enlarger_config.control.dmx_control
+        && settings_get_enlarger_config(&controller->secondary_config, secondary_index)
+        && enlarger_config_is_valid(&controller->secondary_config)) {
+        if (!controller->secondary_config.control.dmx_control) {
+            log_w("Secondary enlarger is not under DMX control");
+        } else if (controller->enlarger_config.control.ramp_time > 0
+            || controller->secondary_config.control.ramp_time > 0) {
+            log_w("Secondary enlarger cannot be used with fades");
+        } else if (enlarger_control_heads_overlap(&controller->enlarger_config.control, &controller->secondary_config.control)) {
+            log_w("Secondary enlarger overlaps the default enlarger");
+        } else {
+            controller->secondary_enabled = true;
+            enlarger_control_prepare_frames(&controller->head_frames[0], &controller->enlarger_config.control);
+            enlarger_control_prepare_frames(&controller->head_frames[1], &controller->secondary_config.control);
+        }
+    }
+    exposure_timer_set_secondary_enlarger(controller->secondary_enabled ? &controller->secondary_config : NULL);
+
     exposure_set_min_exposure_time(controller->exposure_state, enlarger_config_min_exposure(&controller->enlarger_config) / 1000.0F);
     exposure_set_channel_wide_mode(controller->exposure_state, controller->enlarger_config.control.dmx_wide_mode);
 
@@ -305,16 +305,15 @@ bool state_home_process_printing(state_home_t *state, state_controller_t *contro
         state->display_dirty = false;
         state->tone_dirty = false;
     } else if (state->tone_dirty) {
-        if (exposure_get_active_paper_profile_index(exposure_state) >= 0 && !exposure_has_tone_graph(exposure_state)) {
-            display_redraw_tone_graph(UINT32_MAX, 0);
-        } else {
-            uint32_t overlay_marks = 0;
-            uint32_t tone_graph = exposure_get_tone_graph(exposure_state);
+        uint32_t tone_graph = UINT32_MAX;
+        uint32_t overlay_marks = 0;
+        if (exposure_get_active_paper_profile_index(exposure_state) < 0 || exposure_has_tone_graph(exposure_state)) {
+            tone_graph = exposure_get_tone_graph(exposure_state);
             if (tone_graph && state->live_tone_element) {
                 overlay_marks = state->live_tone_element;
             }
-            display_redraw_tone_graph(tone_graph, overlay_marks);
         }
+        display_post_tone_graph(tone_graph, overlay_marks);
         state->tone_dirty = false;
     }
 
@@ -601,10 +600,10 @@ bool state_home_process_calibration(state_home_t *state, state_controller_t *con
 void state_home_select_paper_profile(state_controller_t *controller)
 {
     exposure_state_t *exposure_state = state_controller_get_exposure_state(controller);
-    paper_profile_t *profile_list;
-    profile_list = pvPortMalloc(sizeof(paper_profile_t) * MAX_PAPER_PROFILES);
-    if (!profile_list) {
-        log_e("Unable to allocate memory for profile list");
+    char *profile_name_list;
+    profile_name_list = pvPortMalloc(PROFILE_NAME_LEN * MAX_PAPER_PROFILES);
+    if (!profile_name_list) {
+        log_e("Unable to allocate memory for profile name list");
         return;
     }
 
@@ -617,7 +616,7 @@ void state_home_select_paper_profile(state_controller_t *controller)
     profile_count = 0;
     profile_index = exposure_get_active_paper_profile_index(exposure_state);
     for (size_t i = 0; i < MAX_PAPER_PROFILES; i++) {
-        if (!settings_get_paper_profile(&profile_list[i], i)) {
+        if (!settings_get_paper_profile_name(profile_name_list + (i * PROFILE_NAME_LEN), i)) {
             break;
         } else {
             profile_count = i + 1;
@@ -626,6 +625,7 @@ void state_home_select_paper_profile(state_controller_t *controller)
     log_i("Loaded %d profiles, selected is %d", profile_count, profile_index);
     if (profile_count == 0) {
         log_w("No profiles available");
+        vPortFree(profile_name_list);
         return;
     }
 
@@ -638,11 +638,12 @@ void state_home_select_paper_profile(state_controller_t *controller)
 
     offset = 0;
     for (size_t i = 0; i < profile_count; i++) {
-        if (strlen(profile_list[i].name) > 0) {
+        const char *profile_name = profile_name_list + (i * PROFILE_NAME_LEN);
+        if (strlen(profile_name) > 0) {
             sprintf(buf + offset, "%c[%02d] %s",
                 (i == profile_index) ? 187 : ' ',
                 i + 1,
-                profile_list[i].name);
+                profile_name);
         } else {
             sprintf(buf + offset, "%c[%02d] Paper profile %d",
                 (i == profile_index) ? 187 : ' ',
@@ -668,7 +669,7 @@ void state_home_select_paper_profile(state_controller_t *controller)
         }
     } while (option != 0 && option != UINT8_MAX);
 
-    vPortFree(profile_list);
+    vPortFree(profile_name_list);
 }
 
 void state_home_check_meter_probe(state_home_t *state, const state_controller_t *controller)
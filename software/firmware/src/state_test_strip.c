@@ -291,7 +291,7 @@ static bool state_test_strip_exposure_callback(exposure_timer_state_t state, uin
     display_exposure_timer_t *elements = user_data;
 
     update_display_timer(elements, time_ms);
-    display_redraw_test_strip_timer(elements);
+    display_post_test_strip_timer(elements);
 
     /* Handle the next keypad event without blocking */
     keypad_event_t keypad_event;
@@ -126,12 +126,10 @@ bool state_timer_main_exposure(exposure_state_t *exposure_state, const enlarger_
 bool state_timer_main_exposure_callback(exposure_timer_state_t state, uint32_t time_ms, void *user_data)
 {
     display_exposure_timer_t *elements = user_data;
-    display_exposure_timer_t prev_elements;
 
     if (time_ms != UINT32_MAX) {
-        memcpy(&prev_elements, elements, sizeof(display_exposure_timer_t));
         update_display_timer(elements, time_ms);
-        display_draw_exposure_timer(elements, &prev_elements);
+        display_post_exposure_timer(elements);
     }
 
     /* Handle the next keypad event without blocking */
@@ -289,7 +287,7 @@ bool state_timer_burn_dodge_exposure_callback(exposure_timer_state_t state, uint
 
     if (time_ms != UINT32_MAX) {
         update_display_timer(time_elements, time_ms);
-        display_redraw_adjustment_exposure_timer(time_elements);
+        display_post_adjustment_exposure_timer(time_elements);
     }
 
     /* Handle the next keypad event without blocking */
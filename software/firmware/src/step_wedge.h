@@ -62,7 +62,14 @@ typedef struct {
 /**
  * Maximum number of steps that are supported for a step wedge.
  */
-#define MAX_STEP_WEDGE_STEP_COUNT 51
+#define MAX_STEP_WEDGE_STEP_COUNT 256
+
+/**
+ * Number of steps shown at once by menus that list every step as a
+ * separate entry, keeping their option numbers within 8 bits.
+ * Wedges with more steps are shown across several pages.
+ */
+#define STEP_WEDGE_MENU_PAGE_STEP_COUNT 50
 
 /**
  * Get the name of a particular stock step wedge profile.
@@ -18,6 +18,7 @@
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_it.h"
 #include "board_config.h"
+#include "dmx.h"
 
 extern SMBUS_HandleTypeDef hsmbus2;
 extern TIM_HandleTypeDef htim1;
@@ -129,7 +130,9 @@ void TIM1_CC_IRQHandler(void)
  */
 void TIM4_IRQHandler(void)
 {
+    const uint32_t cycles = DWT->CYCCNT;
     HAL_TIM_IRQHandler(&htim4);
+    dmx_isr_record(DWT->CYCCNT - cycles);
 }
 
 /**
@@ -169,7 +172,9 @@ void TIM8_CC_IRQHandler(void)
  */
 void DMA2_Stream6_IRQHandler(void)
 {
+    const uint32_t cycles = DWT->CYCCNT;
     HAL_DMA_IRQHandler(&hdma_usart6_tx);
+    dmx_isr_record(DWT->CYCCNT - cycles);
 }
 
 /**
@@ -177,5 +182,7 @@ void DMA2_Stream6_IRQHandler(void)
  */
 void USART6_IRQHandler(void)
 {
+    const uint32_t cycles = DWT->CYCCNT;
     HAL_UART_IRQHandler(&huart6);
+    dmx_isr_record(DWT->CYCCNT - cycles);
 }
@@ -474,3 +474,14 @@ bool scrub_export_filename(char *filename, const char *ext)
 
     return changed;
 }
+
+void cycle_counter_enable()
+{
+    taskENTER_CRITICAL();
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    taskEXIT_CRITICAL();
+}
@@ -154,6 +154,14 @@ HAL_StatusTypeDef os_to_hal_status(osStatus_t os_status);
 HAL_StatusTypeDef usb_to_hal_status(int usb_status);
 osStatus_t usb_to_os_status(int usb_status);
 
+/**
+ * Enable the DWT cycle counter, which is used for timing measurements.
+ *
+ * This may be called by every module that reads the counter, and only
+ * resets the count the first time it is enabled.
+ */
+void cycle_counter_enable();
+
 /**
  * Scrub a user-provided file name to ensure it meets requirements.
  *